@@ -0,0 +1,227 @@
+// ==============================================================================
+//                      Benchmark Echo Server, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This program provides the reference echo server of the
+// benchmarks, built on as_poll(). Every byte received from a client is sent
+// back on the same connection, so the load generator measures the cost of the
+// event loop, the ring buffers and the system calls rather than application
+// work. The backend and the server options are selected on the command line and
+// the metrics of the server are printed once it is interrupted.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // For the command line options, e.g. getopt(3).
+#endif // _GNU_SOURCE
+
+#include <stdio.h>      // For printing the metrics, e.g. fputs(3).
+#include <stdlib.h>     // For the exit status and parsing the options, e.g. strtoul(3).
+#include <string.h>     // For comparing the backend names, e.g. strcmp(3).
+#include <signal.h>     // For stopping the server, e.g. sigaction(2).
+#include <unistd.h>     // For the command line options, e.g. getopt(3).
+
+#include "as_server.h"
+
+// --- Constants and Macros --- //
+
+#define ECHO_TIMEOUT 100    // Timeout of the poll in milliseconds, the stop flag is checked in between.
+#define ECHO_ZEROCOPY_BUFFER (64UL * 1024UL) // Initial size of the client buffers with -z, so that a read reaches zerocopy_min.
+
+// --- Static Variables --- //
+
+static struct server_context server;
+static volatile sig_atomic_t stopped = 0;
+
+// --- Static Function Definitions --- //
+
+/// @brief Stop the loop of the server.
+static void on_signal (int signal) {
+    (void) signal;
+    stopped = 1;
+}
+
+/// @brief Echo the received data back to the client.
+static void client_handler (void *context, int event, void *data) {
+
+    (void) data;
+
+    struct client_context *client = (struct client_context *) context;
+
+    if (event & (POLLHUP | POLLERR)) {
+        as_disconnect(&server, client);
+        return;
+    }
+
+    // A drained output takes the input that did not fit before, e.g. into a pinned buffer.
+    if (!(event & (AS_EVENT_DATA | POLLOUT))) {
+        return;
+    }
+
+    struct io_buffer *input = client->input;
+    struct iovec iov[2];
+    const int count = iobuff_data_iov(input, iov);
+
+    // Only the appended part is consumed, the rest is echoed on the next POLLOUT.
+    for (int i = 0; i < count; i++) {
+
+        const size_t appended = iobuff_append(client->output, iov[i].iov_base, iov[i].iov_len, true);
+
+        input->tail += appended;
+
+        if (appended < iov[i].iov_len) {
+            break;
+        }
+    }
+
+    if (iobuff_send(client, client->output) < 0) {
+        as_disconnect(&server, client);
+    }
+}
+
+/// @brief Echo the received data of all ready clients, called once per iteration.
+static void batch_handler (struct server_context *context, struct client_event *events, size_t count, void *data) {
+
+    (void) context;
+
+    for (size_t i = 0; i < count; i++) {
+
+        // A client might have been disconnected by an earlier entry of the batch.
+        if (!(events[i].client->flags & CLIENT_CLOSING)) {
+            client_handler(events[i].client, events[i].events, data);
+        }
+    }
+}
+
+/// @brief Accept all pending connections.
+static void server_handler (void *context, int event, void *data) {
+
+    (void) data;
+
+    if (event & POLLIN) {
+        (void) as_accept_batch((struct server_context *) context, client_handler, 0);
+    }
+}
+
+/// @brief Print the usage of the program.
+static void usage (const char *name) {
+    fprintf(stderr, "Usage: %s [-a address] [-b poll|epoll|uring] [-m max_clients] [-w watermark] [-dcltNzB]\n", name);
+    fprintf(stderr, "  -w  stop reading from clients with this many bytes of unsent output\n");
+    fprintf(stderr, "  -d  defer the flushes to the end of the iteration (AS_OPT_DEFER_FLUSH)\n");
+    fprintf(stderr, "  -c  cork the written sockets (AS_OPT_CORK)\n");
+    fprintf(stderr, "  -l  attach the buffer storage lazily (AS_OPT_LAZY_BUFFERS)\n");
+    fprintf(stderr, "  -t  record the handler latencies (AS_OPT_LATENCY)\n");
+    fprintf(stderr, "  -N  coalesce small segments (no TCP_NODELAY)\n");
+    fprintf(stderr, "  -z  send large output without copying it (AS_OPT_ZEROCOPY), with 64 KiB client buffers\n");
+    fprintf(stderr, "  -B  dispatch the ready clients to a single batch handler\n");
+}
+
+// --- Main --- //
+
+int main (int argc, char **argv) {
+
+    const char *address = "127.0.0.1:8080";
+    struct server_config config = { 0 };
+    int option;
+
+    server.options = AS_OPT_RECV;
+    server.backend = POLL_BACKEND_AUTO;
+
+    // Request-response traffic would wait for the delayed acknowledgements with Nagle's algorithm.
+    config.sockets.no_delay = 1;
+
+    while ((option = getopt(argc, argv, "a:b:m:w:dcltNzBh")) != -1) {
+        switch (option) {
+            case 'a':
+                address = optarg;
+                break;
+            case 'b':
+                server.backend = !strcmp(optarg, "poll") ? POLL_BACKEND_POLL
+                               : !strcmp(optarg, "epoll") ? POLL_BACKEND_EPOLL
+                               : !strcmp(optarg, "uring") ? POLL_BACKEND_IO_URING : POLL_BACKEND_AUTO;
+                break;
+            case 'm':
+                config.max_clients = strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                config.output_high = strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                server.options |= AS_OPT_DEFER_FLUSH;
+                break;
+            case 'c':
+                server.options |= AS_OPT_CORK;
+                break;
+            case 'l':
+                server.options |= AS_OPT_LAZY_BUFFERS;
+                break;
+            case 't':
+                server.options |= AS_OPT_LATENCY;
+                break;
+            case 'N':
+                config.sockets.no_delay = 0;
+                break;
+            case 'z':
+                server.options |= AS_OPT_ZEROCOPY;
+                config.buffer_size = ECHO_ZEROCOPY_BUFFER;
+                break;
+            case 'B':
+                server.batch_handler = batch_handler;
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    const struct sigaction action = { .sa_handler = on_signal };
+
+    (void) sigaction(SIGINT, &action, NULL);
+    (void) sigaction(SIGTERM, &action, NULL);
+    (void) signal(SIGPIPE, SIG_IGN);
+
+    if (as_bind_config(&server, address, server_handler, &config) < 0) {
+        fprintf(stderr, "Error binding the server to %s\n", address);
+        return EXIT_FAILURE;
+    }
+
+    set_timeout(server.polled, ECHO_TIMEOUT);
+
+    while (!stopped) {
+        if (as_poll(&server, NULL) < 0) {
+            break;
+        }
+    }
+
+    struct as_metrics_snapshot snapshot;
+    char text[4096];
+
+    as_metrics_snapshot(&server, &snapshot);
+    (void) metrics_format(&snapshot, text, sizeof(text));
+    fputs(text, stdout);
+
+    as_cleanup(&server);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+// ==============================================================================
+//                     Framing Benchmark, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This program provides the microbenchmark of the framing stage.
+// The delimiter search of frame_scan() is compared with a byte loop and with
+// memchr(3) for a range of distances to the delimiter, then a ring buffer of
+// lines and of length-prefixed messages is framed in place, the throughput is
+// reported in bytes per nanosecond.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#include <stdio.h>      // For the report, e.g. printf(3).
+#include <stdlib.h>     // For the exit status and parsing the arguments, e.g. strtoul(3).
+#include <string.h>     // For the reference search, e.g. memchr(3).
+#include <stdint.h>     // For fixed-width integer types, e.g. uint64_t.
+
+#include "as_server.h"
+#include "as_frame.h"
+#include "as_metrics.h"
+
+// --- Constants and Macros --- //
+
+#define FRAME_BENCH_BYTES   (64UL << 20)    // Default number of bytes searched per variant.
+#define FRAME_BENCH_BUFFER  65536UL         // Size of the ring buffer framed in place.
+#define FRAME_BENCH_LINE    80UL            // Length of the framed messages.
+
+// --- Static Function Definitions --- //
+
+/// @brief Find a byte one byte at a time, the baseline of the searches.
+static const char *scan_bytes (const char *data, size_t length, unsigned char byte) {
+
+    for (size_t i = 0; i < length; i++) {
+        if ((unsigned char) data[i] == byte) {
+            return data + i;
+        }
+    }
+
+    return NULL;
+}
+
+/// @brief Find a byte with the C library.
+static const char *scan_memchr (const char *data, size_t length, unsigned char byte) {
+    return memchr(data, byte, length);
+}
+
+/// @brief Print the throughput of a variant.
+static void report (const char *variant, size_t distance, uint64_t start, size_t bytes) {
+    printf("%-8s %6zu %8.2f B/ns\n", variant, distance, (double) bytes / (double) (metrics_now() - start));
+}
+
+/// @brief Search segments ending with the delimiter until the given number of bytes is searched.
+/// @return 0 on success, -1 if the delimiter was missed.
+static int bench_scan (const char *variant, const char *(*scan)(const char *, size_t, unsigned char), const char *data, size_t distance, size_t bytes) {
+
+    // Called through a volatile pointer, the compiler would hoist the search of the same data out of the loop.
+    const char *(*volatile search)(const char *, size_t, unsigned char) = scan;
+    const size_t rounds = bytes / (distance + 1) + 1;
+    const uint64_t start = metrics_now();
+    size_t missed = 0;
+
+    for (size_t i = 0; i < rounds; i++) {
+        missed += search(data, distance + 1, '\n') != data + distance;
+    }
+
+    report(variant, distance, start, rounds * (distance + 1));
+
+    return (missed == 0) ? 0 : -1;
+}
+
+/// @brief Fill the ring with messages and frame them until the given number of bytes is framed.
+/// @return 0 on success, -1 if a message was not framed.
+static int bench_framer (const char *variant, enum frame_mode mode, unsigned int param, size_t bytes) {
+
+    struct io_buffer *buffer = iobuff_alloc(FRAME_BENCH_BUFFER);
+    struct framer framer;
+    struct frame frame;
+    char message[FRAME_BENCH_LINE + 8];
+    size_t length = 0;
+    size_t framed = 0;
+    int result = 0;
+
+    if (buffer == NULL || frame_init(&framer, mode, param, 0) < 0) {
+        iobuff_free(buffer);
+        return -1;
+    }
+
+    // A length prefix or a delimiter, followed by the printable payload.
+    if (mode == FRAME_LENGTH) {
+        message[length++] = (char) (FRAME_BENCH_LINE >> 8);
+        message[length++] = (char) (FRAME_BENCH_LINE & 0xFF);
+    }
+
+    for (size_t i = 0; i < FRAME_BENCH_LINE; i++) {
+        message[length++] = (char) ('a' + i % 26);
+    }
+
+    if (mode != FRAME_LENGTH) {
+        message[length++] = '\n';
+    }
+
+    const uint64_t start = metrics_now();
+
+    while (framed < bytes && result == 0) {
+
+        while (iobuff_append(buffer, message, length, false) == length) {
+            continue;
+        }
+
+        while ((result = frame_next(&framer, buffer, &frame)) == 1) {
+            framed += frame.consumed;
+            frame_consume(&framer, buffer, &frame);
+        }
+
+        // The ring keeps a partial message, the next fill completes it.
+        buffer->head = buffer->tail + ((buffer->head - buffer->tail) / length) * length;
+    }
+
+    report(variant, FRAME_BENCH_LINE, start, framed);
+    iobuff_free(buffer);
+
+    return (result == 0) ? 0 : -1;
+}
+
+// --- Main --- //
+
+int main (int argc, char **argv) {
+
+    static char data[4096 + 1];
+    const size_t bytes = (argc > 1) ? strtoul(argv[1], NULL, 10) : FRAME_BENCH_BYTES;
+    const size_t distances[] = {8, 32, 80, 256, 1024, 4096};
+
+    if (bytes == 0) {
+        fprintf(stderr, "Usage: %s [bytes]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    memset(data, 'a', sizeof(data));
+
+    printf("bytes %zu\n", bytes);
+
+    for (size_t i = 0; i < sizeof(distances) / sizeof(distances[0]); i++) {
+
+        data[distances[i]] = '\n';
+
+        if (bench_scan("bytes", scan_bytes, data, distances[i], bytes) < 0
+            || bench_scan("memchr", scan_memchr, data, distances[i], bytes) < 0
+            || bench_scan("frame", frame_scan, data, distances[i], bytes) < 0) {
+            fprintf(stderr, "Error: delimiter search failed\n");
+            return EXIT_FAILURE;
+        }
+
+        data[distances[i]] = 'a';
+    }
+
+    if (bench_framer("line", FRAME_LINE, 0, bytes) < 0 || bench_framer("length", FRAME_LENGTH, 2, bytes) < 0) {
+        fprintf(stderr, "Error: framing failed\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
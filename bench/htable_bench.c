@@ -0,0 +1,180 @@
+// ==============================================================================
+//                      Hash Table Benchmark, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This program provides the microbenchmark of the hash tables.
+// The chained, the pooled chained and the open addressing variants of the
+// generic htable_t are compared with a table generated by HTABLE_GEN(), the
+// one used for the client contexts. Each variant is filled with descriptor-like
+// integer keys, looked up with hits and misses and emptied again, the average
+// time per operation is reported in nanoseconds.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#include <stdio.h>      // For the report, e.g. printf(3).
+#include <stdlib.h>     // For the exit status and parsing the arguments, e.g. strtoul(3).
+#include <stdint.h>     // For the integer keys stored as pointers, e.g. uintptr_t.
+
+#include "htable.h"
+#include "htable_gen.h"
+#include "as_metrics.h"
+
+// --- Constants and Macros --- //
+
+#define HTABLE_BENCH_KEYS   100000UL    // Default number of keys.
+#define HTABLE_BENCH_CHUNK  1024UL      // Nodes per slab of the pooled table.
+
+// --- Type Definitions --- //
+
+HTABLE_GEN(bench_table, int, uintptr_t, htable_gen_hash_int, htable_gen_eq_int)
+
+/// @brief Generate the key of the given index, consecutive like the descriptors of a process.
+#define BENCH_KEY(idx) ((uintptr_t) (idx) + 1)
+
+// --- Static Function Definitions --- //
+
+/// @brief Hash of the integer keys stored as pointers.
+static unsigned long hash_key (const void *key) {
+    return htable_gen_hash_int((int) (uintptr_t) key);
+}
+
+/// @brief Comparison of the integer keys stored as pointers.
+static int equal_keys (const void *keyA, const void *keyB) {
+    return keyA == keyB;
+}
+
+/// @brief Print the time per operation of a phase.
+static void report (const char *variant, const char *phase, uint64_t start, size_t count) {
+    printf("%-10s %-8s %8.1f ns/op\n", variant, phase, (double) (metrics_now() - start) / (double) count);
+}
+
+/// @brief Run the phases on a generic table.
+/// @return 0 on success, -1 if the table misbehaved.
+static int bench_generic (const char *variant, htable_t *table, size_t count) {
+
+    uint64_t start;
+    size_t found = 0;
+
+    if (table == NULL) {
+        return -1;
+    }
+
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        if (htable_insert(table, (const void *) BENCH_KEY(i), (const void *) BENCH_KEY(i)) < 0) {
+            return -1;
+        }
+    }
+    report(variant, "insert", start, count);
+
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        found += htable_get(table, (const void *) BENCH_KEY(i)) != NULL;
+    }
+    report(variant, "get", start, count);
+
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        found += htable_get(table, (const void *) (uintptr_t) (count + 1 + i)) != NULL;
+    }
+    report(variant, "miss", start, count);
+
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        found -= htable_remove(table, (const void *) BENCH_KEY(i)) == 0;
+    }
+    report(variant, "remove", start, count);
+
+    htable_destroy(table);
+
+    return (found == 0) ? 0 : -1;
+}
+
+/// @brief Run the phases on a generated table.
+/// @return 0 on success, -1 if the table misbehaved.
+static int bench_generated (const char *variant, size_t count) {
+
+    struct bench_table table;
+    uint64_t start;
+    size_t found = 0;
+
+    if (bench_table_init(&table, 16) < 0) {
+        return -1;
+    }
+
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        if (bench_table_insert(&table, (int) BENCH_KEY(i), BENCH_KEY(i)) < 0) {
+            return -1;
+        }
+    }
+    report(variant, "insert", start, count);
+
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        found += bench_table_get(&table, (int) BENCH_KEY(i)) != NULL;
+    }
+    report(variant, "get", start, count);
+
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        found += bench_table_get(&table, (int) (count + 1 + i)) != NULL;
+    }
+    report(variant, "miss", start, count);
+
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        found -= bench_table_remove(&table, (int) BENCH_KEY(i)) == 0;
+    }
+    report(variant, "remove", start, count);
+
+    bench_table_destroy(&table);
+
+    return (found == 0) ? 0 : -1;
+}
+
+// --- Main --- //
+
+int main (int argc, char **argv) {
+
+    const size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : HTABLE_BENCH_KEYS;
+
+    if (count == 0) {
+        fprintf(stderr, "Usage: %s [keys]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    printf("keys %zu\n", count);
+
+    // The chained tables are sized for the keys, the open addressing tables grow from a small size.
+    if (bench_generic("chained", htable_create(count, hash_key, equal_keys, NULL), count) < 0
+        || bench_generic("pooled", htable_create_pooled(count, hash_key, equal_keys, NULL, HTABLE_BENCH_CHUNK), count) < 0
+        || bench_generic("open", htable_create_mode(16, hash_key, equal_keys, NULL, HTABLE_OPEN), count) < 0
+        || bench_generated("generated", count) < 0) {
+        fprintf(stderr, "Error: hash table benchmark failed\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+// ==============================================================================
+//                      Ring Buffer Benchmark, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This program provides the microbenchmark of the ring buffers.
+// Messages are appended to an io_buffer with iobuff_append() and either
+// consumed in place or sent with iobuff_send() over a local socket pair. The
+// message size either divides the ring size, so the data never wraps, or does
+// not, so that about half of the messages are split across the end of the
+// storage. Mirrored buffers, whose data never wraps, are measured as well.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#include <stdio.h>      // For the report, e.g. printf(3).
+#include <stdlib.h>     // For memory allocation and parsing the arguments, e.g. malloc(3), strtoul(3).
+#include <string.h>     // For memory operations, e.g. memset(3).
+#include <unistd.h>     // For draining the socket pair, e.g. read(2).
+#include <fcntl.h>      // For the non-blocking sockets, e.g. fcntl(2).
+
+#include <sys/socket.h> // For the socket pair, e.g. socketpair(2).
+
+#include "as_server.h"
+
+// --- Constants and Macros --- //
+
+#define IOBUFF_BENCH_SIZE       4096UL      // Default size of the rings.
+#define IOBUFF_BENCH_ITERATIONS 1000000UL   // Default number of messages per case.
+
+// --- Static Function Definitions --- //
+
+/// @brief Print the time and bandwidth per message of a case.
+static void report (const char *name, size_t message, uint64_t start, size_t iterations) {
+
+    const double elapsed = (double) (metrics_now() - start);
+
+    printf("%-14s %6zu B %8.1f ns/op %8.2f GiB/s\n", name, message, elapsed / (double) iterations,
+           (double) message * (double) iterations / elapsed * 1e9 / (1024.0 * 1024.0 * 1024.0));
+}
+
+/// @brief Append the messages to the buffer and consume them in place.
+static void bench_append (const char *name, struct io_buffer *buffer, const char *data, size_t message, size_t iterations) {
+
+    const uint64_t start = metrics_now();
+
+    for (size_t i = 0; i < iterations; i++) {
+        (void) iobuff_append(buffer, data, message, false);
+        buffer->tail = buffer->head;
+    }
+
+    report(name, message, start, iterations);
+}
+
+/// @brief Append the messages to the buffer and send them to the peer, which drains them.
+/// @return 0 on success, -1 on failure.
+static int bench_send (const char *name, struct client_context *client, struct io_buffer *buffer, const char *data,
+                       size_t message, size_t iterations, int peer, char *scratch, size_t length) {
+
+    const uint64_t start = metrics_now();
+
+    for (size_t i = 0; i < iterations; i++) {
+
+        (void) iobuff_append(buffer, data, message, false);
+
+        if (iobuff_send(client, buffer) < 0) {
+            return -1;
+        }
+
+        // Drain the peer so the socket never fills, the data left behind is sent with the next message.
+        while (read(peer, scratch, length) > 0) {}
+    }
+
+    report(name, message, start, iterations);
+
+    return 0;
+}
+
+// --- Main --- //
+
+int main (int argc, char **argv) {
+
+    const size_t size = (argc > 1) ? strtoul(argv[1], NULL, 10) : IOBUFF_BENCH_SIZE;
+    const size_t iterations = (argc > 2) ? strtoul(argv[2], NULL, 10) : IOBUFF_BENCH_ITERATIONS;
+
+    if (size < 4 || (size & (size - 1)) != 0 || iterations == 0) {
+        fprintf(stderr, "Usage: %s [ring size, power of two] [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Half of the ring never wraps, three quarters wrap every other message.
+    const size_t aligned = size / 2;
+    const size_t wrapped = size / 4 * 3;
+
+    int status = EXIT_FAILURE;
+    int pair[2] = { -1, -1 };
+    char *data = malloc(size);
+    char *scratch = malloc(size);
+    struct io_buffer *ring = iobuff_alloc(size);
+    struct io_buffer *mirrored = iobuff_alloc_mirrored(size);
+
+    if (data == NULL || scratch == NULL || ring == NULL || mirrored == NULL) {
+        fprintf(stderr, "Error allocating buffers\n");
+        goto cleanup;
+    }
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0 || fcntl(pair[0], F_SETFL, O_NONBLOCK) < 0 || fcntl(pair[1], F_SETFL, O_NONBLOCK) < 0) {
+        fprintf(stderr, "Error creating socket pair\n");
+        goto cleanup;
+    }
+
+    memset(data, 'x', size);
+
+    // A client context detached from any server, iobuff_send() then writes the buffer directly.
+    struct client_info info = { .fd = pair[0] };
+    struct client_context client = { .info = &info, .output = ring };
+
+    printf("ring %zu B, %zu iterations\n", size, iterations);
+
+    bench_append("append", ring, data, aligned, iterations);
+    bench_append("append wrap", ring, data, wrapped, iterations);
+    bench_append("append mirror", mirrored, data, wrapped, iterations);
+
+    ring->head = ring->tail = 0;
+
+    if (bench_send("send", &client, ring, data, aligned, iterations, pair[1], scratch, size) < 0
+        || bench_send("send wrap", &client, ring, data, wrapped, iterations, pair[1], scratch, size) < 0) {
+        fprintf(stderr, "Error sending data\n");
+        goto cleanup;
+    }
+
+    client.output = mirrored;
+
+    if (bench_send("send mirror", &client, mirrored, data, wrapped, iterations, pair[1], scratch, size) < 0) {
+        fprintf(stderr, "Error sending data\n");
+        goto cleanup;
+    }
+
+    status = EXIT_SUCCESS;
+
+cleanup:
+    if (pair[0] >= 0) {
+        (void) close(pair[0]);
+        (void) close(pair[1]);
+    }
+
+    if (ring != NULL) {
+        iobuff_free(ring);
+    }
+
+    if (mirrored != NULL) {
+        iobuff_free(mirrored);
+    }
+
+    free(scratch);
+    free(data);
+
+    return status;
+}
@@ -0,0 +1,397 @@
+// ==============================================================================
+//                     Benchmark Load Generator, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This program provides the load generator of the benchmarks. It
+// opens a number of connections to an echo server, spread over several
+// threads, and keeps a fixed number of messages in flight on each of them for
+// the duration of the run. The round trip of every message is recorded in a
+// log-linear histogram, the throughput and the 50th, 99th and 99.9th
+// percentiles of the latency are reported at the end. The connections are
+// driven by the pollfds wrapper of the library.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // For the command line options, e.g. getopt(3).
+#endif // _GNU_SOURCE
+
+#include <stdio.h>      // For the report, e.g. printf(3).
+#include <stdlib.h>     // For memory allocation and parsing the options, e.g. calloc(3), strtoul(3).
+#include <string.h>     // For memory operations, e.g. memset(3).
+#include <errno.h>      // For the error codes of the non-blocking sockets, e.g. EAGAIN.
+#include <signal.h>     // For ignoring broken connections, e.g. SIGPIPE.
+#include <unistd.h>     // For the command line options, e.g. getopt(3).
+#include <fcntl.h>      // For the non-blocking sockets, e.g. fcntl(2).
+#include <pthread.h>    // For the load threads, e.g. pthread_create(3).
+
+#include <sys/socket.h> // For the connections, e.g. connect(2).
+#include <netinet/in.h> // For the address structure, e.g. sockaddr_in.
+#include <netinet/tcp.h> // For sending the messages immediately, e.g. TCP_NODELAY.
+#include <arpa/inet.h>  // For the byte order conversions, e.g. htons(3).
+
+#include "as_server.h"
+
+// --- Constants and Macros --- //
+
+#define LOADGEN_DEPTH_MAX   64U     // Maximum number of messages in flight per connection.
+#define LOADGEN_TIMEOUT     10      // Timeout of the poll in milliseconds, the deadline is checked in between.
+#define LOADGEN_SCRATCH     65536U  // Size of the receive buffer of a thread.
+
+// --- Type Definitions --- //
+
+/// @brief State of a single connection.
+struct connection {
+    int         fd;                         // The socket of the connection.
+    short       events;                     // The events being polled.
+    size_t      queued;                     // Number of messages not written completely.
+    size_t      offset;                     // Bytes of the current message already written.
+    size_t      received;                   // Bytes of the current message already echoed.
+    uint64_t    sent[LOADGEN_DEPTH_MAX];    // Times the messages in flight were queued, in ns.
+    unsigned    head;                       // Next entry of the sent times to fill.
+    unsigned    tail;                       // Oldest entry of the sent times.
+};
+
+/// @brief State and results of a load thread.
+struct load_thread {
+    pthread_t           thread;                         // The thread.
+    struct connection   *connections;                   // The connections driven by the thread.
+    size_t              count;                          // The number of connections.
+    uint64_t            requests;                       // Number of completed round trips.
+    uint64_t            latency[AS_HISTOGRAM_BUCKETS];  // Round trip times in ns.
+    int                 error;                          // Set if the thread failed.
+};
+
+// --- Static Variables --- //
+
+static struct sockaddr_in address;
+static size_t message_size = 64;
+static unsigned depth = 1;
+static char *payload = NULL;
+static uint64_t deadline = 0;
+
+// --- Static Function Definitions --- //
+
+/// @brief Parse an address of the form "a.b.c.d:port".
+static int parse_address (const char *text, struct sockaddr_in *saddr) {
+
+    unsigned int octA, octB, octC, octD, port;
+
+    if (sscanf(text, "%u.%u.%u.%u:%u", &octA, &octB, &octC, &octD, &port) != 5) {
+        return -1;
+    }
+
+    memset(saddr, 0, sizeof(*saddr));
+    saddr->sin_family = AF_INET;
+    saddr->sin_addr.s_addr = htonl((octA << 24) | (octB << 16) | (octC << 8) | octD);
+    saddr->sin_port = htons((unsigned short) port);
+
+    return 0;
+}
+
+/// @brief Open a non-blocking connection to the server.
+/// @return The socket, -1 on failure.
+static int open_connection (void) {
+
+    const int enable = 1;
+    int fd;
+
+    if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+        return -1;
+    }
+
+    if (connect(fd, (const struct sockaddr *) &address, sizeof(address)) < 0
+        || setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)) < 0
+        || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+        (void) close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/// @brief Queue a new message on the connection.
+static void queue_message (struct connection *conn, uint64_t now) {
+    conn->sent[conn->head++ % LOADGEN_DEPTH_MAX] = now;
+    conn->queued++;
+}
+
+/// @brief Write the queued messages as far as the socket accepts them.
+/// @return 0 on success, -1 on failure.
+static int write_messages (struct connection *conn) {
+
+    while (conn->queued > 0) {
+
+        const ssize_t sent = send(conn->fd, payload + conn->offset, message_size - conn->offset, MSG_NOSIGNAL);
+
+        if (sent < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+
+        conn->offset += (size_t) sent;
+
+        if (conn->offset == message_size) {
+            conn->offset = 0;
+            conn->queued--;
+        }
+    }
+
+    return 0;
+}
+
+/// @brief Consume the echoed data, record the completed round trips and queue the next messages.
+/// @return 0 on success, -1 on failure or if the server closed the connection.
+static int read_messages (struct load_thread *load, struct connection *conn, char *scratch) {
+
+    for (;;) {
+
+        const ssize_t received = recv(conn->fd, scratch, LOADGEN_SCRATCH, 0);
+
+        if (received == 0) {
+            return -1;
+        }
+
+        if (received < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+
+        const uint64_t now = metrics_now();
+
+        conn->received += (size_t) received;
+
+        while (conn->received >= message_size) {
+
+            const uint64_t start = conn->sent[conn->tail++ % LOADGEN_DEPTH_MAX];
+
+            conn->received -= message_size;
+            load->latency[histogram_index(now - start)]++;
+            load->requests++;
+
+            queue_message(conn, now);
+        }
+
+        if ((size_t) received < LOADGEN_SCRATCH) {
+            return 0;
+        }
+    }
+}
+
+/// @brief Drive the connections of the thread until the deadline.
+static void *run_thread (void *arg) {
+
+    struct load_thread *load = (struct load_thread *) arg;
+    struct pollfds *pollfds = NULL;
+    char *scratch = NULL;
+
+    if ((pollfds = create_pollfds(load->count, POLL_BACKEND_AUTO)) == NULL || (scratch = malloc(LOADGEN_SCRATCH)) == NULL) {
+        load->error = 1;
+        goto cleanup;
+    }
+
+    set_timeout(pollfds, LOADGEN_TIMEOUT);
+
+    for (size_t i = 0; i < load->count; i++) {
+
+        struct connection *conn = &load->connections[i];
+
+        for (unsigned m = 0; m < depth; m++) {
+            queue_message(conn, metrics_now());
+        }
+
+        conn->events = POLLIN | POLLOUT;
+
+        if (add_event(pollfds, conn->fd, conn->events) < 0 || set_event_data(pollfds, conn->fd, conn) < 0) {
+            load->error = 1;
+            goto cleanup;
+        }
+    }
+
+    while (metrics_now() < deadline) {
+
+        const int ready = poll_events(pollfds);
+
+        if (ready < 0) {
+            load->error = 1;
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+
+            const struct poll_event *event = ready_event(pollfds, (size_t) i);
+            struct connection *conn = (struct connection *) event->data;
+
+            if ((event->revents & (POLLERR | POLLHUP)) || read_messages(load, conn, scratch) < 0 || write_messages(conn) < 0) {
+                fprintf(stderr, "Error: connection closed by the server\n");
+                load->error = 1;
+                goto cleanup;
+            }
+
+            // Poll for writability only while a message is stuck in the socket.
+            const short events = (short) (POLLIN | ((conn->queued > 0) ? POLLOUT : 0));
+
+            if (events != conn->events) {
+                conn->events = events;
+                (void) add_event(pollfds, conn->fd, events);
+            }
+        }
+    }
+
+cleanup:
+    free(scratch);
+
+    if (pollfds != NULL) {
+        destroy_pollfds(pollfds);
+    }
+
+    return NULL;
+}
+
+/// @brief Print the usage of the program.
+static void usage (const char *name) {
+    fprintf(stderr, "Usage: %s [-a address] [-c connections] [-t threads] [-s size] [-p depth] [-d seconds]\n", name);
+}
+
+// --- Main --- //
+
+int main (int argc, char **argv) {
+
+    const char *target = "127.0.0.1:8080";
+    size_t connections = 64;
+    size_t threads = 1;
+    double duration = 5.0;
+    int option;
+
+    while ((option = getopt(argc, argv, "a:c:t:s:p:d:h")) != -1) {
+        switch (option) {
+            case 'a':
+                target = optarg;
+                break;
+            case 'c':
+                connections = strtoul(optarg, NULL, 10);
+                break;
+            case 't':
+                threads = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                message_size = strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                depth = (unsigned) strtoul(optarg, NULL, 10);
+                break;
+            case 'd':
+                duration = strtod(optarg, NULL);
+                break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (parse_address(target, &address) < 0 || connections == 0 || threads == 0 || message_size == 0
+        || depth == 0 || depth > LOADGEN_DEPTH_MAX || duration <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    threads = (threads > connections) ? connections : threads;
+
+    (void) signal(SIGPIPE, SIG_IGN);
+
+    int status = EXIT_FAILURE;
+    struct connection *conns = calloc(connections, sizeof(*conns));
+    struct load_thread *loads = calloc(threads, sizeof(*loads));
+    size_t opened = 0;
+
+    if (conns == NULL || loads == NULL || (payload = malloc(message_size)) == NULL) {
+        fprintf(stderr, "Error allocating memory\n");
+        goto cleanup;
+    }
+
+    memset(payload, 'x', message_size);
+
+    for (; opened < connections; opened++) {
+        if ((conns[opened].fd = open_connection()) < 0) {
+            fprintf(stderr, "Error connecting to %s: %s\n", target, strerror(errno));
+            goto cleanup;
+        }
+    }
+
+    deadline = metrics_now() + (uint64_t) (duration * 1e9);
+
+    // The connections are split evenly, the first threads take the remainder.
+    for (size_t t = 0, first = 0; t < threads; t++) {
+
+        loads[t].connections = &conns[first];
+        loads[t].count = connections / threads + (t < connections % threads);
+        first += loads[t].count;
+
+        if (pthread_create(&loads[t].thread, NULL, run_thread, &loads[t]) != 0) {
+            fprintf(stderr, "Error creating load thread\n");
+            threads = t;
+            goto cleanup;
+        }
+    }
+
+    uint64_t latency[AS_HISTOGRAM_BUCKETS] = { 0 };
+    uint64_t requests = 0;
+    int error = 0;
+
+    for (size_t t = 0; t < threads; t++) {
+
+        (void) pthread_join(loads[t].thread, NULL);
+
+        requests += loads[t].requests;
+        error |= loads[t].error;
+
+        for (size_t i = 0; i < AS_HISTOGRAM_BUCKETS; i++) {
+            latency[i] += loads[t].latency[i];
+        }
+    }
+
+    printf("connections %zu threads %zu size %zu depth %u duration %.2f s\n", connections, threads, message_size, depth, duration);
+    printf("requests %llu, %.0f req/s, %.2f MiB/s each way\n", (unsigned long long) requests, (double) requests / duration,
+           (double) requests * (double) message_size / duration / (1024.0 * 1024.0));
+    printf("latency p50 %.1f us, p99 %.1f us, p999 %.1f us, max %.1f us\n",
+           (double) histogram_percentile(latency, 0.5) / 1e3, (double) histogram_percentile(latency, 0.99) / 1e3,
+           (double) histogram_percentile(latency, 0.999) / 1e3, (double) histogram_percentile(latency, 1.0) / 1e3);
+
+    // The threads were joined above.
+    threads = 0;
+    status = error ? EXIT_FAILURE : EXIT_SUCCESS;
+
+cleanup:
+    for (size_t t = 0; t < threads; t++) {
+        (void) pthread_join(loads[t].thread, NULL);
+    }
+
+    for (size_t i = 0; i < opened; i++) {
+        (void) close(conns[i].fd);
+    }
+
+    free(payload);
+    free(loads);
+    free(conns);
+
+    return status;
+}
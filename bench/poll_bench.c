@@ -0,0 +1,210 @@
+// ==============================================================================
+//                      Poll Set Benchmark, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This program provides the microbenchmark of the pollfds wrapper.
+// A large number of descriptors is added, updated and removed again with every
+// readiness backend, in between the set is waited on while a small fraction of
+// the descriptors is ready, which shows the cost of scanning the whole set with
+// poll(2) compared to the ready list of epoll(7). The descriptors are eventfds on
+// Linux and pipes elsewhere.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // For the eventfd descriptors, e.g. eventfd(2).
+#endif // _GNU_SOURCE
+
+#include <stdio.h>      // For the report, e.g. printf(3).
+#include <stdlib.h>     // For memory allocation and parsing the arguments, e.g. calloc(3), strtoul(3).
+#include <unistd.h>     // For closing the descriptors, e.g. close(2).
+
+#include <sys/resource.h> // For raising the descriptor limit, e.g. setrlimit(2).
+
+#ifdef __linux__
+#include <sys/eventfd.h>  // For the benchmarked descriptors, e.g. eventfd(2).
+#endif // __linux__
+
+#include "as_server.h"
+
+// --- Constants and Macros --- //
+
+#define POLL_BENCH_FDS      10000UL // Default number of descriptors.
+#define POLL_BENCH_WAITS    1000UL  // Number of waits measured per backend.
+#define POLL_BENCH_READY    100UL   // One out of this many descriptors is ready during the waits.
+
+// --- Static Function Definitions --- //
+
+/// @brief Open a descriptor that can be made readable, the write end is returned separately for pipes.
+/// @return 0 on success, -1 on failure.
+static int open_descriptor (int *rfd, int *wfd) {
+
+#ifdef __linux__
+    *rfd = *wfd = eventfd(0, EFD_NONBLOCK);
+    return (*rfd < 0) ? -1 : 0;
+#else
+    int fds[2];
+
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+
+    *rfd = fds[0];
+    *wfd = fds[1];
+
+    return 0;
+#endif // __linux__
+}
+
+/// @brief Make the descriptor readable.
+static void signal_descriptor (int wfd) {
+    const uint64_t value = 1;
+    (void) !write(wfd, &value, sizeof(value));
+}
+
+/// @brief Print the time per operation of a phase.
+static void report (const char *backend, const char *phase, uint64_t start, size_t count) {
+    printf("%-6s %-8s %10.1f ns/op\n", backend, phase, (double) (metrics_now() - start) / (double) count);
+}
+
+/// @brief Run the phases with the given backend.
+/// @return 0 on success, -1 on failure.
+static int bench_backend (const char *name, enum poll_backend backend, const int *rfds, size_t count) {
+
+    struct pollfds *pollfds = NULL;
+    uint64_t start;
+
+    // The set starts small, the additions include the growth of the arrays.
+    if ((pollfds = create_pollfds(16, backend)) == NULL) {
+        return -1;
+    }
+
+    set_poll_growth(pollfds, (unsigned int) count, 0);
+    set_timeout(pollfds, 0);
+
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        if (add_event(pollfds, rfds[i], POLLIN) < 0) {
+            destroy_pollfds(pollfds);
+            return -1;
+        }
+    }
+    report(name, "add", start, count);
+
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        (void) add_event(pollfds, rfds[i], POLLIN | POLLPRI);
+    }
+    report(name, "modify", start, count);
+
+    int ready = 0;
+
+    start = metrics_now();
+    for (size_t i = 0; i < POLL_BENCH_WAITS; i++) {
+        ready = poll_events(pollfds);
+    }
+    report(name, "wait", start, POLL_BENCH_WAITS);
+
+    // The descriptors are removed from the front, every removal moves the last entry into the hole.
+    start = metrics_now();
+    for (size_t i = 0; i < count; i++) {
+        remove_event(pollfds, rfds[i]);
+    }
+    report(name, "remove", start, count);
+
+    printf("%-6s ready    %10d of %zu\n", name, ready, count);
+
+    destroy_pollfds(pollfds);
+
+    return 0;
+}
+
+// --- Main --- //
+
+int main (int argc, char **argv) {
+
+    size_t count = (argc > 1) ? strtoul(argv[1], NULL, 10) : POLL_BENCH_FDS;
+    struct rlimit limit;
+
+    // Every descriptor of the benchmark needs an entry in the descriptor table.
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+
+        limit.rlim_cur = limit.rlim_max;
+        (void) setrlimit(RLIMIT_NOFILE, &limit);
+
+        if (count * 2 + 16 > limit.rlim_cur) {
+            count = (limit.rlim_cur - 16) / 2;
+        }
+    }
+
+    int status = EXIT_FAILURE;
+    int *rfds = calloc(count, sizeof(*rfds));
+    int *wfds = calloc(count, sizeof(*wfds));
+    size_t opened = 0;
+
+    if (count == 0 || rfds == NULL || wfds == NULL) {
+        fprintf(stderr, "Usage: %s [descriptors]\n", argv[0]);
+        goto cleanup;
+    }
+
+    for (; opened < count; opened++) {
+
+        if (open_descriptor(&rfds[opened], &wfds[opened]) < 0) {
+            fprintf(stderr, "Error opening descriptors\n");
+            goto cleanup;
+        }
+
+        if (opened % POLL_BENCH_READY == 0) {
+            signal_descriptor(wfds[opened]);
+        }
+    }
+
+    printf("descriptors %zu, one in %lu ready\n", count, POLL_BENCH_READY);
+
+    if (bench_backend("poll", POLL_BACKEND_POLL, rfds, count) < 0
+#ifdef __linux__
+        || bench_backend("epoll", POLL_BACKEND_EPOLL, rfds, count) < 0
+#endif // __linux__
+        ) {
+        fprintf(stderr, "Error: poll set benchmark failed\n");
+        goto cleanup;
+    }
+
+    status = EXIT_SUCCESS;
+
+cleanup:
+    for (size_t i = 0; i < opened; i++) {
+
+        (void) close(rfds[i]);
+
+        if (wfds[i] != rfds[i]) {
+            (void) close(wfds[i]);
+        }
+    }
+
+    free(rfds);
+    free(wfds);
+
+    return status;
+}
@@ -0,0 +1,126 @@
+// ==============================================================================
+//                      Message Framing, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides the framing of messages received into an
+// io_buffer, with length-prefixed and delimited (byte, LF and CRLF) modes. The
+// complete messages are handed out as views of one or two spans of the ring,
+// the second one if the message wraps around the end of the storage, and are
+// consumed in place, nothing is copied. The delimiters are searched with SIMD
+// instructions where available (AVX2, SSE2 or NEON, scalar otherwise) and the
+// data already scanned is not scanned again when more of the message arrives.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef AS_FRAME_H_
+#define AS_FRAME_H_
+
+    // --- Standard Libraries --- //
+
+    #include <stddef.h>     // For NULL definition and size_t type.
+    #include <stdbool.h>    // For boolean data type.
+
+    // --- POSIX Libraries --- //
+
+    #include <sys/uio.h>    // For the iovec struct of the spans.
+
+    // --- Type Definitions --- //
+
+    struct io_buffer;
+
+    /// @brief Framing modes.
+    enum frame_mode {
+        FRAME_LENGTH = 0,   // Messages are preceded by their length, big-endian of prefix bytes.
+        FRAME_DELIMITER,    // Messages end with the delimiter byte, which is not part of them.
+        FRAME_LINE,         // Messages end with LF, a CR before it is stripped as well.
+        FRAME_CRLF          // Messages end with CRLF, a lone LF is part of the message.
+    };
+
+    /// @brief Framing state of a connection, initialize it with frame_init().
+    struct framer {
+        enum frame_mode     mode;           // The framing mode.
+        unsigned char       delimiter;      // The delimiter of FRAME_DELIMITER, LF otherwise.
+        unsigned int        prefix;         // Size of the length prefix in bytes, 1, 2, 4 or 8.
+        size_t              max_length;     // Maximum length of a message, 0 for unlimited.
+        size_t              scanned;        // Bytes after the tail known not to complete a message.
+        size_t              tail;           // Tail of the buffer when the bytes were scanned.
+    };
+
+    /// @brief View of a complete message in the ring, valid until the message is consumed or more data arrives.
+    struct frame {
+        struct iovec        span[2];        // The message, the second span holds the part wrapped to the start.
+        int                 count;          // Number of non-empty spans, 0 for an empty message.
+        size_t              length;         // Length of the message without its prefix or delimiter.
+        size_t              consumed;       // Bytes of the buffer taken by the message including the framing.
+    };
+
+    #ifdef __cplusplus
+    extern "C" {
+    #endif // __cplusplus
+
+    // --- Function Prototypes --- //
+
+    /// @brief Initialize the framing state of a connection.
+    /// @param framer The framing state.
+    /// @param mode The framing mode.
+    /// @param param The delimiter byte of FRAME_DELIMITER or the prefix size of FRAME_LENGTH, ignored otherwise.
+    /// @param max_length Maximum length of a message, 0 for unlimited.
+    /// @return 0 on success, -1 with errno EINVAL if the prefix size is not supported.
+    int frame_init (struct framer *framer, enum frame_mode mode, unsigned int param, size_t max_length);
+
+    /// @brief Get the next complete message of the buffer.
+    /// @note The message stays in the buffer until frame_consume(), the next call returns the same one. A full
+    /// buffer is grown to hold the incomplete message, up to its limit, so that the rest can be received.
+    /// @param framer The framing state of the connection.
+    /// @param buffer The buffer the data is received into, e.g. client->input.
+    /// @param frame The view of the message, filled if one is complete.
+    /// @return 1 if a message is complete, 0 if more data is needed, -1 on failure (errno EMSGSIZE if the
+    /// message exceeds max_length, ENOBUFS if the buffer cannot grow to hold it).
+    int frame_next (struct framer *framer, struct io_buffer *buffer, struct frame *frame);
+
+    /// @brief Release a message returned by frame_next() from the buffer.
+    /// @param framer The framing state of the connection.
+    /// @param buffer The buffer.
+    /// @param frame The message, the oldest one of the buffer.
+    void frame_consume (struct framer *framer, struct io_buffer *buffer, const struct frame *frame);
+
+    /// @brief Copy a message into contiguous memory, e.g. to keep it beyond frame_consume().
+    /// @param frame The message.
+    /// @param destination The destination.
+    /// @param size The size of the destination.
+    /// @return The number of bytes copied, at most size.
+    size_t frame_copy (const struct frame *frame, void *destination, size_t size);
+
+    /// @brief Find the first occurrence of a byte, memchr(3) with the SIMD search of the framing.
+    /// @param data The data to search.
+    /// @param length The length of the data.
+    /// @param byte The byte to find.
+    /// @return Pointer to the byte, NULL if it does not occur.
+    const char *frame_scan (const char *data, size_t length, unsigned char byte);
+
+    #ifdef __cplusplus
+    }
+    #endif // __cplusplus
+
+#endif // AS_FRAME_H_
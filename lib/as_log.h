@@ -0,0 +1,107 @@
+// ==============================================================================
+//                     Logging Backend, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides the asynchronous backend of the logging
+// macros. Every thread formats its messages into its own lock-free ring of
+// fixed-size records, the rings are drained in batches by log_flush(), called
+// by a background thread or by the event loop while it is idle, so a message
+// costs the formatting and no system call on the logging thread. Messages are
+// dropped instead of blocking once a ring is full. Each call site is rate
+// limited, floods of the same error are reduced to a summary line.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef AS_LOG_H_
+#define AS_LOG_H_
+
+    // --- Standard Libraries --- //
+
+    #include <stddef.h>     // For NULL definition and size_t type.
+    #include <stdint.h>     // For fixed-width integer types, e.g. uint64_t.
+    #include <stdatomic.h>  // For the rate limits shared by the threads of a call site.
+
+    // --- Constants and Macros --- //
+
+    #define LOG_LEVEL_OFF       0           // No messages are compiled in.
+    #define LOG_LEVEL_ERROR     1           // Errors only, see LOG_ERROR().
+    #define LOG_LEVEL_INFO      2           // Errors and informational messages, see LOG_INFO().
+
+    #define LOG_RING_RECORDS    256U        // Records per thread, power of two.
+    #define LOG_TEXT_SIZE       208U        // Maximum length of a formatted message, longer ones are truncated.
+    #define LOG_RATE_BURST      16U         // Messages of a call site passed per interval, the rest are counted.
+    #define LOG_RATE_INTERVAL   1000U       // Interval of the rate limit in milliseconds.
+
+    // --- Type Definitions --- //
+
+    /// @brief Rate limit of a call site, a zeroed static instance per call site of the logging macros.
+    struct log_site {
+        atomic_uint_least64_t   window;     // Start of the current interval in milliseconds.
+        atomic_uint             count;      // Messages passed during the current interval.
+        atomic_uint             suppressed; // Messages dropped since the last passed one.
+    };
+
+    #ifdef __cplusplus
+    extern "C" {
+    #endif // __cplusplus
+
+    // --- Function Prototypes --- //
+
+    /// @brief Enable the asynchronous backend, the messages are written to the descriptor by log_flush().
+    /// @note Until then the messages are written synchronously, informational ones to stdout, errors to stderr.
+    /// @param fd The descriptor to write to, e.g. STDERR_FILENO.
+    /// @return 0 on success, -1 if the backend is already enabled.
+    int log_open (int fd);
+
+    /// @brief Start a background thread calling log_flush() periodically.
+    /// @param interval The period in milliseconds.
+    /// @return 0 on success, -1 on failure (e.g. the backend is not enabled or the thread already runs).
+    int log_start (unsigned int interval);
+
+    /// @brief Write the pending records of all threads, in order per thread.
+    /// @note Safe to call from any thread, concurrent calls return immediately while another one flushes.
+    /// @return The number of records written.
+    size_t log_flush (void);
+
+    /// @brief Stop the background thread, flush the pending records and disable the backend.
+    /// @note No other thread may log during the call, their rings are released.
+    void log_close (void);
+
+    /// @brief Log a formatted message, called by LOG_INFO().
+    /// @note The value of errno is preserved.
+    /// @param site The rate limit of the call site.
+    /// @param format The printf(3) format of the message.
+    void log_info (struct log_site *site, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    /// @brief Log an error message followed by the description of errno, like perror(3), called by LOG_ERROR().
+    /// @note The value of errno is preserved.
+    /// @param site The rate limit of the call site.
+    /// @param message The error message.
+    void log_error (struct log_site *site, const char *message);
+
+    #ifdef __cplusplus
+    }
+    #endif // __cplusplus
+
+#endif // AS_LOG_H_
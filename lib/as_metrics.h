@@ -0,0 +1,193 @@
+// ==============================================================================
+//                         Metrics, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides the always-on counters and the handler
+// latency histograms of a server. The event loop is the only writer, so the
+// updates are relaxed atomic loads and stores instead of read-modify-write
+// instructions and cost about as much as a plain increment. Other threads read
+// the values without locks through a snapshot, the histograms use log-linear
+// buckets with a relative error of 25% in the style of HDR histograms.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef AS_METRICS_H_
+#define AS_METRICS_H_
+
+    // --- Standard Libraries --- //
+
+    #include <stddef.h>     // For NULL definition and size_t type.
+    #include <stdbool.h>    // For boolean data type.
+    #include <stdint.h>     // For fixed-width integer types, e.g. uint64_t.
+    #include <stdatomic.h>  // For the relaxed counters read by other threads.
+
+    // --- Constants and Macros --- //
+
+    #define AS_HISTOGRAM_SUB_BITS   2U  // Sub-buckets per power of two as a power of two, 4 sub-buckets.
+    #define AS_HISTOGRAM_SUB        (1U << AS_HISTOGRAM_SUB_BITS)
+    #define AS_HISTOGRAM_MAX_BITS   40U // Values below 2^40 ns (about 18 minutes) are resolved, larger ones saturate.
+    #define AS_HISTOGRAM_BUCKETS    ((AS_HISTOGRAM_MAX_BITS - AS_HISTOGRAM_SUB_BITS + 1U) << AS_HISTOGRAM_SUB_BITS)
+
+    // --- Type Definitions --- //
+
+    /// @brief Counters of a server, see metrics_add().
+    enum as_counter {
+        AS_COUNTER_WAKEUPS = 0,     // Returns from the wait for events or completions.
+        AS_COUNTER_READY,           // Ready descriptors or completions reported by the wakeups.
+        AS_COUNTER_ACCEPTS,         // Accepted connections.
+        AS_COUNTER_DISCONNECTS,     // Disconnected clients.
+        AS_COUNTER_BYTES_IN,        // Bytes received from the clients.
+        AS_COUNTER_BYTES_OUT,       // Bytes sent to the clients.
+        AS_COUNTER_PARTIAL_SENDS,   // Sends the socket accepted only a part of.
+        AS_COUNTER_REALLOCS,        // Reallocations of grown client buffers.
+        AS_COUNTER_TIMERS,          // Expired timers and deadlines.
+        AS_COUNTER_FOREIGN_CPU,     // Accepted connections processed by another core than the listener's, see SO_INCOMING_CPU.
+        AS_COUNTER_ZEROCOPY,        // Sends of the output buffers with MSG_ZEROCOPY.
+        AS_COUNTER_ZEROCOPY_COPIED, // Zero-copy completions the kernel had to copy the data for, e.g. on loopback.
+        AS_COUNTERS
+    };
+
+    /// @brief Handlers whose run time is recorded, see metrics_record().
+    enum as_handler {
+        AS_HANDLER_SERVER = 0,      // Event handler of the listener.
+        AS_HANDLER_CLIENT,          // Event handlers of the clients.
+        AS_HANDLER_NOTIFY,          // Completions and posted messages of other threads.
+        AS_HANDLER_TIMERS,          // Expiry of the timers of an iteration.
+        AS_HANDLER_BATCH,           // Batch handler of the ready clients, see batch_callback_t.
+        AS_HANDLERS
+    };
+
+    /// @brief Metrics of a server, written by the loop thread only.
+    struct as_metrics {
+        _Atomic(uint64_t)   counters[AS_COUNTERS];                      // Counters by enum as_counter.
+        _Atomic(uint64_t)   latency[AS_HANDLERS][AS_HISTOGRAM_BUCKETS]; // Run times in ns by enum as_handler.
+        bool                timing;                                     // Whether the run times are recorded.
+    };
+
+    /// @brief Plain copy of the metrics, see metrics_snapshot().
+    struct as_metrics_snapshot {
+        uint64_t            counters[AS_COUNTERS];
+        uint64_t            latency[AS_HANDLERS][AS_HISTOGRAM_BUCKETS];
+    };
+
+    #ifdef __cplusplus
+    extern "C" {
+    #endif // __cplusplus
+
+    // --- Function Prototypes --- //
+
+    /// @brief Reset the metrics to zero.
+    /// @note Must not race with readers, call it before the loop is started.
+    /// @param metrics The metrics.
+    /// @param timing Whether metrics_clock() reads the clock, i.e. the run times are recorded.
+    void metrics_init (struct as_metrics *metrics, bool timing);
+
+    /// @brief Copy the metrics, safe to call from any thread while the loop is running.
+    /// @note The values are read one by one, the snapshot is not consistent across counters.
+    /// @param metrics The metrics.
+    /// @param snapshot The copy to fill.
+    void metrics_snapshot (const struct as_metrics *metrics, struct as_metrics_snapshot *snapshot);
+
+    /// @brief Get the current time of the monotonic clock in nanoseconds.
+    /// @return The current time in nanoseconds.
+    uint64_t metrics_now (void);
+
+    /// @brief Get the lowest value counted in a histogram bucket.
+    /// @param index The index of the bucket, less than AS_HISTOGRAM_BUCKETS.
+    /// @return The lower bound of the bucket.
+    uint64_t histogram_value (unsigned int index);
+
+    /// @brief Get the value below which the given fraction of the recorded values lies.
+    /// @param buckets The buckets of a histogram, AS_HISTOGRAM_BUCKETS entries.
+    /// @param quantile The fraction, e.g. 0.99 for the 99th percentile.
+    /// @return The upper bound of the bucket holding the quantile, 0 if the histogram is empty.
+    uint64_t histogram_percentile (const uint64_t *buckets, double quantile);
+
+    /// @brief Format the snapshot as text, one "name value" line per counter and percentile.
+    /// @param snapshot The snapshot.
+    /// @param buffer The destination, always terminated unless size is 0.
+    /// @param size The size of the destination.
+    /// @return The length of the complete text, a value of size or more means the text was truncated.
+    size_t metrics_format (const struct as_metrics_snapshot *snapshot, char *buffer, size_t size);
+
+    /// @brief Add to a counter, called by the loop thread only.
+    /// @param metrics The metrics.
+    /// @param counter The counter.
+    /// @param value The amount to add.
+    static inline void metrics_add (struct as_metrics *metrics, enum as_counter counter, uint64_t value) {
+
+        // A single writer needs no atomic read-modify-write, the readers only must not see torn values.
+        const uint64_t current = atomic_load_explicit(&metrics->counters[counter], memory_order_relaxed);
+        atomic_store_explicit(&metrics->counters[counter], current + value, memory_order_relaxed);
+    }
+
+    /// @brief Get the index of the histogram bucket counting the value.
+    /// @param value The value, e.g. a run time in ns.
+    /// @return The index of the bucket, values beyond the resolved range land in the last one.
+    static inline unsigned int histogram_index (uint64_t value) {
+
+        if (value < AS_HISTOGRAM_SUB) {
+            return (unsigned int) value;
+        }
+
+        const unsigned int exponent = 63U - (unsigned int) __builtin_clzll(value);
+
+        if (exponent >= AS_HISTOGRAM_MAX_BITS) {
+            return AS_HISTOGRAM_BUCKETS - 1U;
+        }
+
+        // The power of two selects the group, the bits following the leading one select the sub-bucket.
+        const unsigned int sub = (unsigned int) (value >> (exponent - AS_HISTOGRAM_SUB_BITS)) & (AS_HISTOGRAM_SUB - 1U);
+
+        return ((exponent - AS_HISTOGRAM_SUB_BITS + 1U) << AS_HISTOGRAM_SUB_BITS) + sub;
+    }
+
+    /// @brief Read the clock before a handler is run.
+    /// @param metrics The metrics.
+    /// @return The current time in ns, 0 if the run times are not recorded.
+    static inline uint64_t metrics_clock (const struct as_metrics *metrics) {
+
+        return metrics->timing ? metrics_now() : 0;
+    }
+
+    /// @brief Record the run time of a handler started at the given time.
+    /// @param metrics The metrics.
+    /// @param handler The kind of handler.
+    /// @param start The time returned by metrics_clock() before the handler was run.
+    static inline void metrics_record (struct as_metrics *metrics, enum as_handler handler, uint64_t start) {
+
+        if (!metrics->timing) {
+            return;
+        }
+
+        _Atomic(uint64_t) *bucket = &metrics->latency[handler][histogram_index(metrics_now() - start)];
+
+        atomic_store_explicit(bucket, atomic_load_explicit(bucket, memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    #ifdef __cplusplus
+    }
+    #endif // __cplusplus
+
+#endif // AS_METRICS_H_
@@ -0,0 +1,115 @@
+// ==============================================================================
+//                      Multi-reactor, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides a multi-reactor mode for the asynchronous
+// TCP server. Each reactor is a thread pinned to a core that owns a complete
+// server context, i.e. its listener, pollfds and client contexts, and drives it
+// with its own event loop. The listeners bind the same address with SO_REUSEPORT
+// so that the kernel load-balances the incoming connections between the loops.
+// No state is shared between the loops, the handlers remain lock-free as long as
+// they only touch the server context they were called for.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef AS_REACTOR_H_
+#define AS_REACTOR_H_
+
+    // --- Standard Libraries --- //
+
+    #include <stddef.h>     // For NULL definition and size_t type.
+    #include <stdatomic.h>  // For the atomic stop flag shared with the loops.
+
+    // --- POSIX Libraries --- //
+
+    #include <pthread.h>    // For the reactor threads, e.g. pthread_create(3).
+
+    // --- Project Libraries --- //
+
+    #include "as_server.h"
+
+    // --- Type Definitions --- //
+
+    struct as_reactor;
+
+    /// @brief Initialization callback of a loop, called by its pinned thread before as_bind_config().
+    /// @note Set e.g. server->backend, server->options or server->user_data of the loop here. The config
+    /// of the loop is zeroed and passed to as_bind_config(), e.g. set server->config.sockets.incoming_cpu
+    /// to steer the connections to the loop on the core that processes their packets.
+    /// @param server The server context of the loop.
+    /// @param index The index of the loop.
+    /// @param data User data passed to as_reactor_start().
+    typedef void (*reactor_init_t)(struct server_context *server, size_t index, void *data);
+
+    /// @brief Event loop of a single reactor thread.
+    struct reactor_loop {
+        struct server_context   server;     // Server context owned by the loop.
+        struct as_reactor       *reactor;   // Reactor the loop belongs to.
+        pthread_t               thread;     // Thread running the loop.
+        size_t                  index;      // Index of the loop.
+        int                     cpu;        // Core the thread is pinned to, -1 if not pinned.
+        int                     status;     // Startup status, 0 pending, 1 running, -1 failed.
+    };
+
+    /// @brief Set of event loops serving the same address.
+    struct as_reactor {
+        struct reactor_loop     *loops;     // The event loops.
+        size_t                  count;      // Number of event loops.
+        atomic_bool             running;    // The loops keep polling while set.
+        pthread_mutex_t         lock;       // Protects the startup state and the stop notifications.
+        pthread_cond_t          ready;      // Signaled once a loop has finished its startup.
+        size_t                  started;    // Number of loops that finished their startup.
+        const char              *ipv4;      // Address the listeners are bound to.
+        event_callback_t        handler;    // Event handler of the listeners.
+        reactor_init_t          init;       // Initialization callback of the loops (optional).
+        void                    *data;      // User data propagated to as_poll() and the callback.
+    };
+
+    #ifdef __cplusplus
+    extern "C" {
+    #endif // __cplusplus
+
+    // --- Function Prototypes --- //
+
+    /// @brief Start the event loops, each one binds its own listener to the address with SO_REUSEPORT.
+    /// @note The server handler is called with the server context of the loop, the client handlers should
+    /// use client->server instead of a global server context.
+    /// @param reactor The reactor to start.
+    /// @param count Number of event loops, 0 for one per available core.
+    /// @param ipv4 The address and port to listen on.
+    /// @param handler The event handler of the listeners.
+    /// @param init Initialization callback of the loops, NULL if not needed.
+    /// @param data User data propagated to as_poll() and to the initialization callback.
+    /// @return 0 once all loops are running, -1 on failure (the started loops are stopped).
+    int as_reactor_start (struct as_reactor *reactor, size_t count, const char *ipv4, event_callback_t handler, reactor_init_t init, void *data);
+
+    /// @brief Stop the event loops, wait for their threads and release their server contexts.
+    /// @param reactor The reactor to stop.
+    void as_reactor_stop (struct as_reactor *reactor);
+
+    #ifdef __cplusplus
+    }
+    #endif // __cplusplus
+
+#endif // AS_REACTOR_H_
@@ -41,35 +41,235 @@
     #include <string.h>     // For string operations, e.g. memset(3), memcpy(3).
     #include <assert.h>     // For debugging, e.g. assert(3).
     #include <stdbool.h>    // For boolean data type.
+    #include <stdint.h>     // For fixed-width integer types, e.g. uintptr_t.
+    #include <errno.h>      // For error codes, e.g. EAGAIN.
+    #include <stdatomic.h>  // For the state shared with other threads, e.g. the notification flag.
+
+    // --- POSIX Libraries --- //
+
+    #include <sys/uio.h>    // For scatter/gather I/O, e.g. struct iovec.
+
+    #ifdef __linux__
+    #include <sys/epoll.h>  // For the epoll(7) event backend, e.g. epoll_wait(2).
+    #endif // __linux__
 
     // --- Project Libraries --- //
 
     #include "tcpserver.h"
     #include "htable.h"
+    #include "htable_gen.h"
+    #include "as_uring.h"
+    #include "mpsc.h"
+    #include "as_timer.h"
+    #include "as_metrics.h"
 
     // --- Constants and Macros --- //
 
     #define BUFFER_SIZE 1024UL
+    #define CLIENT_POOL_SIZE 64UL   // Default number of client contexts preallocated by as_bind().
+    #define AS_RESERVED_FDS 2UL     // Poll set entries of the listener and the wakeup descriptor.
+    #define IOBUFF_SENDV_MAX 32U    // Maximum number of buffers flushed by a single iobuff_sendv().
+    #define AS_ACCEPT_BATCH 64UL    // Default maximum number of connections accepted by as_accept_batch().
+    #define AS_POST_QUEUE   1024UL  // Capacity of the cross-thread post queue of a server, power of two.
+    #define BUFFER_POOL_CLASSES 7U  // Size classes of the buffer pool, BUFFER_SIZE up to BUFFER_SIZE << 6.
+    #define BUFFER_POOL_LIMIT (4UL << 20) // Bytes of free storage cached per size class of the buffer pool.
+    #define AS_ZEROCOPY_MIN 16384UL // Default minimum length of a zero-copy send, the page pinning costs more below.
+    #define AS_ZEROCOPY_SENDS 16U   // Maximum number of zero-copy sends in flight per client, power of two.
+    #define AS_PAYLOAD_IOV  64U     // Maximum number of segments gathered by a single send of queued payloads.
+
+    #define IOBUFF_PINNED   (1U << 0)   // Storage is referenced by in-flight sends (io_uring, MSG_ZEROCOPY), kept when the buffer grows.
+    #define IOBUFF_OWNED    (1U << 1)   // Storage was allocated separately from the header, e.g. after growing.
+    #define IOBUFF_MIRRORED (1U << 2)   // Storage is mapped twice back to back, the data is never split.
+    #define IOBUFF_POOLED   (1U << 3)   // Storage was taken from the buffer pool and is returned to it.
+
+    #define CLIENT_CLOSING  (1U << 0)   // Client was disconnected, the context is released after the iteration.
+    #define CLIENT_DIRTY    (1U << 1)   // Client output is flushed at the end of the iteration, see AS_OPT_DEFER_FLUSH.
+    #define CLIENT_CORKED   (1U << 2)   // Client socket is corked until the end of the iteration, see AS_OPT_CORK.
+    #define CLIENT_PAUSED   (1U << 3)   // Client output is above its high watermark, the input is not polled.
+    #define CLIENT_PAUSE_QUEUED   (1U << 4) // Client is linked for the report of a watermark crossing.
+    #define CLIENT_PAUSE_REPORTED (1U << 5) // Client handler was called with AS_EVENT_PAUSE last.
+    #define CLIENT_ZEROCOPY (1U << 6)   // Client socket sends large output with MSG_ZEROCOPY, see AS_OPT_ZEROCOPY.
+
+    #define AS_OPT_RECV     (1U << 0)   // Server option, as_poll() receives the incoming data into client->input.
+    #define AS_OPT_REUSEPORT (1U << 1)  // Server option, the listener shares its address with other servers.
+    #define AS_OPT_DEFER_FLUSH (1U << 2) // Server option, output buffers are flushed once at the end of the iteration.
+    #define AS_OPT_CORK     (1U << 3)   // Server option, sockets written during an iteration are corked until its end.
+    #define AS_OPT_LAZY_BUFFERS (1U << 4) // Server option, client buffers hold pooled storage only while they hold data.
+    #define AS_OPT_LATENCY  (1U << 5)   // Server option, the run times of the handlers are recorded in server->metrics.
+    #define AS_OPT_ZEROCOPY (1U << 6)   // Server option, large output sends use MSG_ZEROCOPY instead of copying (Linux only).
+
+    #define AS_SENDFILE_CLOSE (1U << 0) // Sendfile flag, the source descriptor is closed once it was transmitted.
+
+    #define AS_EVENT_DATA   0x10000     // Client event, new data was received into client->input.
+    #define AS_EVENT_IDLE   0x20000     // Client event, the idle timeout expired, see as_set_deadline().
+    #define AS_EVENT_READ_TIMEOUT  0x40000  // Client event, the read deadline expired before data arrived.
+    #define AS_EVENT_WRITE_TIMEOUT 0x80000  // Client event, the write deadline expired before the output drained.
+    #define AS_EVENT_TIMEOUT (AS_EVENT_IDLE | AS_EVENT_READ_TIMEOUT | AS_EVENT_WRITE_TIMEOUT)
+    #define AS_EVENT_PAUSE  0x100000    // Client event, the output buffer crossed the high watermark, stop producing.
+    #define AS_EVENT_RESUME 0x200000    // Client event, the output buffer fell under the low watermark again.
 
     // --- Type Definitions --- //
 
     typedef void (*event_callback_t)(void *context, int event, void *data);
 
+    struct as_completion;
+
+    /// @brief Completion callback, called on the loop thread of the client.
+    /// @param completion The completed work item.
+    /// @param data User data passed to as_poll().
+    typedef void (*completion_callback_t)(struct as_completion *completion, void *data);
+
+    struct server_context;
+
+    /// @brief Callback posted to the loop by another thread, see as_post_task().
+    /// @param server The server context of the loop.
+    /// @param arg User argument passed to as_post_task().
+    typedef void (*post_callback_t)(struct server_context *server, void *arg);
+
+    struct client_context;
+
+    /// @brief Events of a ready client, see batch_callback_t.
+    struct client_event {
+        struct client_context   *client;    // The client, skip it once CLIENT_CLOSING was set by a disconnect of the batch.
+        int                     events;     // Events of the client, e.g. POLLIN or AS_EVENT_DATA.
+    };
+
+    /// @brief Batch callback, called once per iteration of as_poll() with the events of all ready clients.
+    /// @param server The server context.
+    /// @param events The events of the ready clients, in the order reported by the backend.
+    /// @param count The number of events, at least one.
+    /// @param data User data passed to as_poll().
+    typedef void (*batch_callback_t)(struct server_context *server, struct client_event *events, size_t count, void *data);
+
+    /// @brief Work item finished by another thread and handed back to the loop thread of its client.
+    /// @note Embed it in the structure describing the work, see as_complete() and as_worker.h.
+    struct as_completion {
+        struct mpsc_node        node;       // Link of the completion queue.
+        struct client_context   *client;    // The client the work belongs to.
+        completion_callback_t   done;       // Called on the loop thread once the work is completed.
+    };
+
+    /// @brief Deadlines of a client context, see as_set_deadline().
+    enum as_deadline {
+        AS_DEADLINE_IDLE = 0,       // Expires once the client was inactive for the timeout, pushed back by any event.
+        AS_DEADLINE_READ,           // Expires unless data arrives before, cancelled by the next POLLIN.
+        AS_DEADLINE_WRITE,          // Expires unless the output buffer is drained before.
+        AS_DEADLINES                // Number of deadlines.
+    };
+
+    /// @brief Event notification backends of the pollfds struct.
+    enum poll_backend {
+        POLL_BACKEND_AUTO = 0,      // Best backend available on the platform, default.
+        POLL_BACKEND_POLL,          // Portable poll(2) backend, scans every polled descriptor.
+        POLL_BACKEND_EPOLL,         // Linux epoll(7) backend, reports only the ready descriptors.
+        POLL_BACKEND_IO_URING,      // Linux io_uring completion engine, see as_uring.h.
+    };
+
+    /// @brief Structure to store a single ready event reported by the backend.
+    struct poll_event {
+        int     fd;         // File descriptor with pending events.
+        short   revents;    // Returned events, e.g. POLLIN, POLLOUT.
+        void    *data;      // Context attached to the file descriptor, see set_event_data().
+    };
+
+    /// @brief Structure to store the per-descriptor state, indexed by the file descriptor.
+    struct poll_slot {
+        int     index;      // Index in the pollfd array, -1 if not polled.
+        void    *data;      // Context attached to the file descriptor, e.g. client context.
+    };
+
+    struct pollfds;
+
+    /// @brief Backend operations of the pollfds struct.
+    /// @note The pollfd array is maintained by the wrapper, the backend only mirrors the changes.
+    struct poll_ops {
+        int  (*add)(struct pollfds *pollfds, int fd, short events, bool update);
+        void (*remove)(struct pollfds *pollfds, int fd);
+        int  (*wait)(struct pollfds *pollfds);
+        void (*destroy)(struct pollfds *pollfds);
+        int  (*resize)(struct pollfds *pollfds, unsigned int length);
+    };
+
     /// @brief Structure to track file descriptors' events.
     struct pollfds {
-        struct pollfd   *fds;       // Array of pollfd structs.
-        unsigned int    polled;     // Number of file descriptors being polled.
-        unsigned int    length;     // Total number of file descriptors.
-        int             timeout;    // Timeout for poll(2) in milliseconds.
+        struct pollfd       *fds;       // Array of pollfd structs.
+        unsigned int        polled;     // Number of file descriptors being polled.
+        unsigned int        length;     // Total number of file descriptors.
+        unsigned int        limit;      // Maximum length the arrays may grow to, see set_poll_growth().
+        unsigned int        growth;     // Number of entries added to a full pollfds struct, 0 to double it.
+        int                 timeout;    // Timeout for poll(2) in milliseconds.
+        struct poll_slot    *slots;     // Per-descriptor state, indexed by the file descriptor.
+        size_t              nslots;     // Number of entries in the descriptor index.
+        struct poll_event   *ready;     // Ready set filled by the last poll_events() call.
+        unsigned int        nready;     // Number of entries in the ready set.
+        enum poll_backend   backend;    // Backend in use, never POLL_BACKEND_AUTO.
+        const struct poll_ops *ops;     // Backend operations.
+        int                 backend_fd; // Backend file descriptor, e.g. epoll instance, -1 if unused.
+        void                *backend_data; // Backend specific storage, e.g. epoll_event array.
+    };
+
+    /// @brief Storage of a buffer replaced while an in-flight operation was reading it, see iobuff_unpin().
+    struct io_retired {
+        struct io_retired *next; // Next storage replaced during the same pin.
+        char *storage;      // The former storage.
+        size_t size;        // Size of the former storage.
+        unsigned int flags; // How the storage is released, e.g. IOBUFF_POOLED.
     };
 
     /// @brief Structure to store client incoming/outcoming data.
     /// @note The buffer is a circular buffer.
     struct io_buffer {
-        char* buffer;       // Pointer to the buffer.
+        char* buffer;       // Pointer to the buffer, NULL while no storage is attached.
         size_t size;        // Size of the buffer.
         size_t head;        // Offset to write data.
         size_t tail;        // Offset to read data.
+        unsigned int flags; // Buffer flags, e.g. IOBUFF_PINNED.
+        struct buffer_pool *pool; // Pool the storage is taken from, NULL for buffers allocated by iobuff_alloc().
+        struct as_metrics *metrics; // Metrics of the server the buffer belongs to, NULL for buffers allocated by iobuff_alloc().
+        size_t limit;       // Maximum size the buffer may grow to, 0 for unlimited.
+        struct io_retired *retired; // Storage replaced while the buffer was pinned, released by iobuff_unpin().
+    };
+
+    /// @brief Size-classed cache of buffer storage shared by the clients of a server.
+    struct buffer_pool {
+        size_t  base;                           // Size of the smallest class, the initial size of the client buffers.
+        void    *free[BUFFER_POOL_CLASSES];     // Free storage per size class, linked through its first bytes.
+        size_t  count[BUFFER_POOL_CLASSES];     // Number of free blocks per size class.
+    };
+
+    /// @brief Immutable message shared by the output queues of several clients, see as_send_payload().
+    /// @note The storage is released with the last reference, the references may be dropped by any thread.
+    struct as_payload {
+        atomic_uint         refs;       // Number of references, the creator holds the first one.
+        size_t              length;     // Length of the message in bytes.
+        char                data[];     // The message, it must not change once it was queued.
+    };
+
+    /// @brief Output queue entry transmitted without copying it into the ring, see as_sendfile() and as_send_payload().
+    struct output_chunk {
+        struct output_chunk *next;      // Next entry of the queue.
+        struct as_payload   *payload;   // Shared message, NULL for a descriptor.
+        int                 fd;         // Source descriptor, a file or the read end of a pipe, -1 for a payload.
+        off_t               offset;     // Next offset of the file or the payload, -1 for a pipe.
+        size_t              remaining;  // Number of bytes left to transmit.
+        size_t              before;     // Number of output ring bytes queued before the entry and not sent yet.
+        unsigned int        flags;      // Sendfile flags, e.g. AS_SENDFILE_CLOSE.
+    };
+
+    /// @brief Zero-copy sends of the output buffer still referenced by the kernel, see AS_OPT_ZEROCOPY.
+    /// @note The bytes stay in the ring behind its tail until the kernel reports the send as completed.
+    struct client_zerocopy {
+        uint32_t            next;       // Sequence number of the next zero-copy send, counted by the kernel.
+        uint32_t            acked;      // Sequence number of the oldest send not completed yet.
+        size_t              pending;    // Output ring bytes sent but not released yet.
+        size_t              lengths[AS_ZEROCOPY_SENDS]; // Bytes released by the completion of each send in flight.
+    };
+
+    /// @brief Additional listener of a server, see as_listen().
+    struct as_listener {
+        struct server_info  info;       // Listener socket, the accepted clients refer to it by client->info->listener.
+        event_callback_t    handler;    // Event callback of the listener, called with the server context.
+        struct as_listener  *next;      // Next listener of the server.
     };
 
     /// @brief Structure to store client context information.
@@ -80,14 +280,75 @@
         event_callback_t    event_handler;      // Event callback function.
         unsigned int        status;             // Connection status, user-defined.
         void                *user_data;         // User data (optional).
+        struct server_context *server;          // Server context the client is connected to.
+        struct client_context *next;            // Intrusive link, e.g. clients pending release.
+        struct client_context *dirty;           // Intrusive link of the clients flushed at the end of the iteration.
+        unsigned int        flags;              // Library flags, e.g. CLIENT_CLOSING.
+        short               events;             // Events currently polled for the client.
+        struct client_uring uring;              // State of the io_uring engine.
+        unsigned int        pending;            // Completions in flight, the context is busy while non-zero.
+        struct as_timer     deadlines[AS_DEADLINES]; // Deadline timers, indexed by enum as_deadline.
+        uint64_t            active;             // Time of the last event in milliseconds, see timer_now().
+        unsigned int        idle_timeout;       // Idle timeout in milliseconds, 0 if not set.
+        struct output_chunk *chunks;            // Descriptors and payloads queued for transmission, in order with the output ring.
+        struct output_chunk *chunks_last;       // Last queued entry, NULL if the queue is empty.
+        size_t              chunked;            // Output ring bytes queued before the last entry.
+        size_t              queued;             // Payload bytes queued and not sent yet, counted by the watermarks.
+        size_t              output_high;        // High watermark of the output buffer in bytes, 0 if disabled.
+        size_t              output_low;         // Low watermark of the output buffer in bytes.
+        struct client_context *paused;          // Intrusive link of the clients with an unreported watermark crossing.
+        struct client_zerocopy zerocopy;        // Zero-copy sends in flight, see AS_OPT_ZEROCOPY.
+        uint64_t            id;                 // Connection identifier, the descriptor and the generation of the connection, see as_post().
+    };
+
+    /// @brief Hash table of the client contexts keyed by their file descriptors, see htable_gen.h.
+    HTABLE_GEN(client_table, int, struct client_context *, htable_gen_hash_int, htable_gen_eq_int)
+
+    /// @brief Capacity settings of a server, see as_bind_config(). Zeroed fields select the defaults.
+    struct server_config {
+        size_t  max_clients;    // Maximum number of connected clients, 0 for MAX_CLIENTS.
+        int     backlog;        // Length of the accept queue, 0 for max_clients.
+        size_t  buffer_size;    // Initial size of the client buffers, a power of two, 0 for BUFFER_SIZE.
+        size_t  buffer_max;     // Maximum size a client buffer may grow to, 0 for unlimited.
+        size_t  poll_initial;   // Initial capacity of the poll set and the client table, 0 for max_clients.
+        size_t  poll_growth;    // Number of entries added to a full poll set, 0 to double it.
+        size_t  output_high;    // High watermark of the output buffers in bytes, 0 to disable the backpressure.
+        size_t  output_low;     // Low watermark of the output buffers in bytes, 0 for half the high watermark.
+        struct socket_options sockets; // Socket options profile of the listener and the clients, see tcpserver.h.
+        size_t  zerocopy_min;   // Minimum length of a zero-copy send in bytes with AS_OPT_ZEROCOPY, 0 for AS_ZEROCOPY_MIN.
     };
 
     struct server_context {
         struct server_info  info;           // Server information.
         struct pollfds      *polled;        // Pollfds struct to monitor file descriptors.
-        htable_t            *contexts;      // Hash table to store client contexts.
+        struct client_table contexts;       // Hash table to store client contexts.
         event_callback_t    event_handler;  // Event callback function.
         void                *user_data;     // User data (optional).
+        enum poll_backend   backend;        // Requested event backend, set before as_bind().
+        struct as_uring     *uring;         // io_uring engine, NULL unless POLL_BACKEND_IO_URING is used.
+        struct client_context *closing;     // Disconnected clients waiting to be released.
+        bool                dispatching;    // Events are being dispatched, client releases are deferred.
+        struct client_context *dirty;       // Clients flushed at the end of the iteration, linked by dirty.
+        struct client_context *paused;      // Clients with an unreported watermark crossing, linked by paused.
+        int                 notify_fd;      // Wakeup descriptor of the loop, polled for POLLIN.
+        int                 notify_wfd;     // Writable end of the wakeup descriptor, same as notify_fd for eventfd(2).
+        atomic_bool         notified;       // A wakeup is pending, further notifications are coalesced.
+        struct mpsc_queue   completions;    // Work items completed by other threads.
+        struct mpsc_ring    *posts;         // Data and callbacks posted by other threads, bounded.
+        struct timer_wheel  timers;         // Deadlines of the clients and deferred callbacks.
+        struct buffer_pool  buffers;        // Storage of the client buffers, see AS_OPT_LAZY_BUFFERS.
+        struct server_config config;        // Capacity settings in effect, defaults filled in by as_bind().
+        struct as_metrics   metrics;        // Counters and handler latencies, read them with as_metrics_snapshot().
+        unsigned int        options;        // Server options, e.g. AS_OPT_RECV, set before as_bind().
+        size_t              pool_size;      // Number of pooled client contexts, set before as_bind(), 0 for default.
+        size_t              pooled;         // Number of client contexts in the pool.
+        struct client_context *pool;        // Released client contexts ready for reuse, linked by next.
+        struct as_listener  *listeners;     // Listeners added by as_listen(), linked by next.
+        struct server_info  *accepting;     // Listener of as_accept(), the one whose handler is running.
+        batch_callback_t    batch_handler;  // Called with the ready clients instead of their handlers, NULL to call them one by one (readiness backends only).
+        struct client_event *batch;         // Events collected for the batch handler.
+        size_t              batch_length;   // Capacity of the batch in events.
+        uint32_t            generation;     // Generation of the last accepted connection, see client->id.
     };
 
     #ifdef __cplusplus
@@ -97,9 +358,11 @@
     // --- Function Prototypes, pollfd wrapper --- //
 
     /// @brief Create a pollfds struct for polling.
-    /// @param len The length of the pollfd array.
+    /// @note POLL_BACKEND_AUTO falls back to poll(2) if no better backend is available.
+    /// @param max_descs The length of the pollfd array.
+    /// @param backend The event notification backend to use.
     /// @return Pointer to the allocated pollfds struct.
-    struct pollfds *create_pollfds (size_t max_descs);
+    struct pollfds *create_pollfds (size_t max_descs, enum poll_backend backend);
 
     /// @brief Destroy the pollfd array.
     /// @param pollfds The pollfds struct to destroy, i.e. deallocate.
@@ -113,11 +376,20 @@
     int add_event (struct pollfds *pollfds, int fd, short events);
 
     /// @brief Remove a file descriptor event from the pollfd array.
-    /// @note This function does not close the file descriptor.
+    /// @note This function does not close the file descriptor. The last descriptor is moved into the
+    /// freed slot, the ready set is not affected, so it is safe to call while dispatching events.
     /// @param fds The pollfds struct to remove the event from.
     /// @param fd The file descriptor to remove.
     void remove_event (struct pollfds *pollfds, int fd);
 
+    /// @brief Attach a context pointer to a polled file descriptor.
+    /// @note The pointer is reported with each ready event of the descriptor and cleared on removal.
+    /// @param pollfds The pollfds struct.
+    /// @param fd The polled file descriptor.
+    /// @param data The context to attach.
+    /// @return 0 on success, -1 if the file descriptor is not being polled.
+    int set_event_data (struct pollfds *pollfds, int fd, void *data);
+
     // --- Function Prototypes, iobuffer --- //
 
     /// @brief Allocate memory for the iobuffer.
@@ -125,24 +397,73 @@
     /// @return Pointer to the allocated iobuffer.
     struct io_buffer *iobuff_alloc (size_t size);
 
+    /// @brief Allocate an iobuffer whose storage is mapped twice back to back in virtual memory.
+    /// @note The pending data is always contiguous, iobuff_tailptr() is valid for head - tail bytes and
+    /// iobuff_headptr() for the whole free space. The size is rounded up to a multiple of the page size.
+    /// Only supported on Linux, see memfd_create(2).
+    /// @param size Size of the iobuffer, a power of two.
+    /// @return Pointer to the allocated iobuffer, NULL on failure.
+    struct io_buffer *iobuff_alloc_mirrored (size_t size);
+
     /// @brief Free the memory allocated for the buffer.
     /// @param buffer The iobuffer struct to free.
     void iobuff_free (struct io_buffer *buffer);
 
+    /// @brief Make room for at least the given number of bytes, attaching or growing the storage if needed.
+    /// @note Pinned storage is kept for the in-flight operations until iobuff_unpin(), see IOBUFF_PINNED.
+    /// @param buffer The iobuffer struct.
+    /// @param length The number of bytes to make room for.
+    /// @return 0 on success, -1 on failure (errno is ENOBUFS if the limit of the buffer is reached).
+    int iobuff_reserve (struct io_buffer *buffer, size_t length);
+
+    /// @brief Clear the pin of the buffer and release the storage it replaced meanwhile.
+    /// @note Called once no in-flight operation references the former storage anymore.
+    /// @param buffer The iobuffer struct.
+    void iobuff_unpin (struct io_buffer *buffer);
+
+    /// @brief Return the storage of a drained buffer to its pool, the next append attaches it again.
+    /// @note Does nothing unless the buffer is pooled, empty and not pinned, see AS_OPT_LAZY_BUFFERS.
+    /// @param buffer The iobuffer struct.
+    void iobuff_release (struct io_buffer *buffer);
+
     /// @brief Append the new data to the iobuffer.
     /// @param buffer The iobuffer struct.
     /// @param data The data to append.
     /// @param length The length of the data to append.
-    /// @param can_reallocate Flag to reallocate the iobuffer if full.
-    /// @return The number of bytes appended to the iobuffer.
+    /// @param can_reallocate Flag to reallocate the iobuffer if full. A pinned buffer grows into new
+    /// storage as well, the former one is kept for the in-flight operations until iobuff_unpin().
+    /// @return The number of bytes appended to the iobuffer, less than length only if the buffer is full
+    /// and cannot grow, i.e. can_reallocate is false, the limit of the buffer is reached or the allocation failed.
     size_t iobuff_append (struct io_buffer *buffer, const char *data, size_t length, bool can_reallocate);
 
     /// @brief Send all available data to the client from the iobuffer.
+    /// @note With the io_uring engine the client's output buffer is only queued and 0 is returned,
+    /// the data is released from the buffer once the send completes. With AS_OPT_DEFER_FLUSH the
+    /// output buffer is only marked for the flush at the end of the iteration and 0 is returned.
     /// @param client The client context.
     /// @param buffer The iobuffer to send.
     /// @return The number of bytes sent, -1 on failure.
     ssize_t iobuff_send (struct client_context *client, struct io_buffer *buffer);
 
+    /// @brief Receive the available data of the client directly into the free space of the iobuffer.
+    /// @note Both free segments of the ring are filled by readv(2), until the socket is drained or the
+    /// buffer is full. The buffer is not reallocated.
+    /// @param client The client context.
+    /// @param buffer The iobuffer to receive into, e.g. client->input.
+    /// @return The number of bytes received, 0 if the peer closed the connection, -1 on failure, with
+    /// errno set to EAGAIN if no data is available or to ENOBUFS if the buffer is full.
+    ssize_t iobuff_recv (struct client_context *client, struct io_buffer *buffer);
+
+    /// @brief Send the data of several iobuffers to the client in a single system call.
+    /// @note The buffers are sent in order, each one is drained before the next one. With the io_uring
+    /// engine the client's output buffer cannot be part of the batch, use iobuff_send() for it instead.
+    /// @param client The client context.
+    /// @param buffers The iobuffers to send.
+    /// @param count The number of iobuffers, at most IOBUFF_SENDV_MAX.
+    /// @return The total number of bytes sent, -1 on failure (errno is EINVAL if the output buffer
+    /// is part of the batch while entries are queued with as_sendfile() or as_send_payload()).
+    ssize_t iobuff_sendv (struct client_context *client, struct io_buffer *const *buffers, size_t count);
+
     // --- Function Prototypes, asynchronnous server --- //
 
     /// @brief Create a listener socket on the specified port, TCP/IPv4 protocol.
@@ -150,17 +471,185 @@
     /// @return 0 on success, -1 on failure.
     int as_bind (struct server_context *server, const char* ipv4, event_callback_t handler);
 
+    /// @brief Create a listener socket with the given capacity settings, see as_bind().
+    /// @note The poll set starts at poll_initial entries and grows on demand up to max_clients.
+    /// @param server The server context, options and backend must be set already.
+    /// @param ipv4 The address to listen on, e.g. "127.0.0.1:8080".
+    /// @param handler The event handler of the listener.
+    /// @param config The capacity settings, NULL for the defaults.
+    /// @return 0 on success, -1 on failure (errno is EINVAL for an invalid configuration).
+    int as_bind_config (struct server_context *server, const char *ipv4, event_callback_t handler, const struct server_config *config);
+
+    /// @brief Bind an additional listener to the server, e.g. for a second port or protocol.
+    /// @note Connections are accepted by as_accept() called from the handler of the listener, with the
+    /// socket options profile of the server. Not supported by the io_uring engine.
+    /// @param server The bound server context.
+    /// @param ipv4 The address to listen on, e.g. "127.0.0.1:8081".
+    /// @param handler The event handler of the listener, called with the server context.
+    /// @return 0 on success, -1 on failure.
+    int as_listen (struct server_context *server, const char *ipv4, event_callback_t handler);
+
     /// @brief Accept a connection from a client for the listener socket.
     /// @param server The server struct to accept the connection on.
     /// @param handler The event handler for the client connection.
     /// @return Pointer to the client context on success, NULL on failure.
     struct client_context *as_accept (struct server_context *server, event_callback_t handler);
 
+    /// @brief Accept all pending connections of the listener socket, up to the specified cap.
+    /// @note Call it from the server's handler on POLLIN to drain a burst of connections in a single wakeup.
+    /// @param server The server struct to accept the connections on.
+    /// @param handler The event handler for the client connections.
+    /// @param max The maximum number of connections to accept, 0 for AS_ACCEPT_BATCH.
+    /// @return The number of accepted connections.
+    size_t as_accept_batch (struct server_context *server, event_callback_t handler, size_t max);
+
+    /// @brief Queue a file or a pipe for transmission, in order with the data of the output buffer.
+    /// @note Files are sent with sendfile(2) and pipes with splice(2) (Linux only), the data never enters
+    /// user space. Neither can suppress SIGPIPE, applications using them should ignore the signal. The
+    /// io_uring engine does not support the queue yet.
+    /// @param client The client context.
+    /// @param fd The source descriptor, it must stay open until the data was transmitted.
+    /// @param offset The offset in the file, negative for the read end of a pipe.
+    /// @param length The number of bytes to transmit.
+    /// @param flags Sendfile flags, e.g. AS_SENDFILE_CLOSE.
+    /// @return 0 on success, -1 on failure.
+    int as_sendfile (struct client_context *client, int fd, off_t offset, size_t length, unsigned int flags);
+
+    /// @brief Allocate a payload that can be queued to any number of clients without copying it again.
+    /// @param data The message to copy into the payload, NULL to write payload->data before queueing it.
+    /// @param length The length of the message in bytes.
+    /// @return The payload holding a single reference, NULL on failure.
+    struct as_payload *as_payload_create (const char *data, size_t length);
+
+    /// @brief Take another reference to the payload.
+    /// @param payload The payload.
+    /// @return The payload.
+    struct as_payload *as_payload_acquire (struct as_payload *payload);
+
+    /// @brief Drop a reference to the payload, the last one frees it.
+    /// @param payload The payload, NULL is ignored.
+    void as_payload_release (struct as_payload *payload);
+
+    /// @brief Queue a reference to the payload for transmission, in order with the data of the output buffer.
+    /// @note The payload is gathered into the sends of the output ring instead of being appended to it, its
+    /// reference is dropped once it was transmitted. The io_uring engine does not support the queue yet.
+    /// @param client The client context.
+    /// @param payload The payload, the caller keeps its own reference.
+    /// @return 0 on success, -1 on failure.
+    int as_send_payload (struct client_context *client, struct as_payload *payload);
+
+    /// @brief Transmit the output buffer and the queued entries in order, as much as the socket accepts.
+    /// @note iobuff_send() on the output buffer and the POLLOUT events of as_poll() flush the queue as well.
+    /// @param client The client context.
+    /// @return The number of bytes sent, -1 on failure.
+    ssize_t as_flush (struct client_context *client);
+
     /// @brief Disconnect the client and free the associated resources.
+    /// @note Inside as_poll() the context stays valid until the end of the iteration.
     /// @param server The server struct.
     /// @param client The client context to disconnect.
     void as_disconnect (struct server_context* server, struct client_context *client);
 
+    /// @brief Synchronize the polled events of the client with the state of its output buffer.
+    /// @note Write interest (POLLOUT) is only armed while the output buffer holds data. This is done
+    /// automatically after the client's handler and by iobuff_send(), call it after appending to the
+    /// output buffer of a client outside of its own handler, e.g. when broadcasting. With AS_OPT_DEFER_FLUSH
+    /// a pending output buffer is queued for the flush at the end of the iteration instead.
+    /// @param client The client context.
+    void as_sync_events (struct client_context *client);
+
+    /// @brief Set the output watermarks of the client, overriding the ones of the server configuration.
+    /// @note Once the output buffer holds high bytes or more, the input of the client is no longer polled
+    /// and the handler is called with AS_EVENT_PAUSE, once it drains to low bytes or less, the input is
+    /// polled again and the handler is called with AS_EVENT_RESUME. The events are reported after the
+    /// handlers of the iteration, producers of the client's data should hold back in between. The io_uring
+    /// engine reports the events without suspending the receive.
+    /// @param client The client context.
+    /// @param high The high watermark in bytes, 0 to disable the backpressure.
+    /// @param low The low watermark in bytes, 0 for half the high watermark.
+    /// @return 0 on success, -1 on failure (errno is EINVAL if low is not less than high).
+    int as_set_watermarks (struct client_context *client, size_t high, size_t low);
+
+    /// @brief Hand a completed work item back to the loop thread of its client, safe to call from any thread.
+    /// @note The completion->client->pending counter must have been incremented on the loop thread when
+    /// the work was started, the client context is not released until the completion is processed.
+    /// Completions of disconnected clients are still delivered, check client->flags for CLIENT_CLOSING.
+    /// @param completion The completed work item.
+    void as_complete (struct as_completion *completion);
+
+    /// @brief Append data to the output buffer of a client from any thread, the data is copied.
+    /// @note The data is appended and flushed by the loop thread in order of posting. It is dropped if the
+    /// connection was closed by then, even if a new connection reuses its descriptor.
+    /// @param server The server context of the loop the client belongs to.
+    /// @param id The connection identifier of the client, client->id.
+    /// @param data The data to send.
+    /// @param length The length of the data.
+    /// @return 0 on success, -1 on failure, errno is EAGAIN if the post queue is full.
+    int as_post (struct server_context *server, uint64_t id, const void *data, size_t length);
+
+    /// @brief Call the function on the loop thread of the server, safe to call from any thread.
+    /// @param server The server context.
+    /// @param callback The function to call.
+    /// @param arg User argument of the function.
+    /// @return 0 on success, -1 on failure, errno is EAGAIN if the post queue is full.
+    int as_post_task (struct server_context *server, post_callback_t callback, void *arg);
+
+    /// @brief Arm or cancel a deadline of the client, the handler is called with AS_EVENT_TIMEOUT once it expires.
+    /// @note Deadlines are one-shot, re-arm them from the handler if needed. The idle deadline is pushed back by
+    /// every event of the client, the read and write deadlines are cancelled by new data and a drained output.
+    /// @param client The client context.
+    /// @param kind The deadline, e.g. AS_DEADLINE_IDLE.
+    /// @param timeout The timeout in milliseconds from now, negative to cancel the deadline.
+    /// @return 0 on success, -1 on failure (e.g. the client is being disconnected).
+    int as_set_deadline (struct client_context *client, enum as_deadline kind, int timeout);
+
+    /// @brief Call the function on the loop thread once the delay elapses, the timer must stay valid until then.
+    /// @note The loop thread only, an armed timer is re-armed.
+    /// @param server The server context.
+    /// @param timer The timer, embedded in the user structure.
+    /// @param delay The delay in milliseconds.
+    /// @param callback The function to call, it receives the user data passed to as_poll().
+    /// @param arg User argument, stored in timer->arg.
+    void as_add_timer (struct server_context *server, struct as_timer *timer, int delay, timer_callback_t callback, void *arg);
+
+    /// @brief Cancel a timer armed by as_add_timer(), does nothing if it is not armed.
+    /// @param server The server context.
+    /// @param timer The timer.
+    void as_cancel_timer (struct server_context *server, struct as_timer *timer);
+
+    /// @brief Get the timeout of the next wait of the loop, i.e. the poll timeout bounded by the nearest expiry.
+    /// @param server The server context.
+    /// @return The timeout in milliseconds, -1 to wait indefinitely.
+    int as_next_timeout (struct server_context *server);
+
+    /// @brief Record an event of the client for its deadlines, called by as_poll() before the handler.
+    /// @param client The client context.
+    /// @param events The events about to be dispatched.
+    void as_touch (struct client_context *client, int events);
+
+    /// @brief Wake up the loop of the server, safe to call from any thread.
+    /// @note Notifications are coalesced until the loop processes them.
+    /// @param server The server context.
+    void as_notify (struct server_context *server);
+
+    /// @brief Process the wakeup of the loop, i.e. the completed work items and the posted messages.
+    /// @note Called by as_poll() when the wakeup descriptor becomes readable.
+    /// @param server The server context.
+    /// @param data User data propagated to the completion callbacks.
+    void as_process_notify (struct server_context *server, void *data);
+
+    /// @brief Copy the metrics of the server, safe to call from any thread while the loop is running.
+    /// @param server The server context, bound with as_bind().
+    /// @param snapshot The copy to fill.
+    void as_metrics_snapshot (const struct server_context *server, struct as_metrics_snapshot *snapshot);
+
+    /// @brief Send the formatted metrics of a server to a client, e.g. from the handler of a side listener.
+    /// @note The server may be served by another thread, its metrics are read without locks.
+    /// @param client The client context, the text is appended to client->output.
+    /// @param server The server whose metrics are sent.
+    /// @return The number of bytes sent, -1 on failure.
+    ssize_t as_metrics_send (struct client_context *client, const struct server_context *server);
+
     /// @brief Main loop to poll file descriptors for events and process connections.
     /// @return 0 on success, -1 on failure.
     int as_poll (struct server_context *server, void* data);
@@ -184,6 +673,22 @@
         return pollfds->length;
     }
 
+    /// @brief Check whether the file descriptor is being polled.
+    /// @param pollfds The pollfds struct.
+    /// @param fd The file descriptor.
+    /// @return 1 if the file descriptor is being polled, 0 if not.
+    inline int is_polled (const struct pollfds *pollfds, int fd) {
+        return fd >= 0 && (size_t) fd < pollfds->nslots && pollfds->slots[fd].index >= 0;
+    }
+
+    /// @brief Get the context attached to a polled file descriptor.
+    /// @param pollfds The pollfds struct.
+    /// @param fd The file descriptor.
+    /// @return The attached context, NULL if none is attached or the descriptor is not polled.
+    inline void *event_data (const struct pollfds *pollfds, int fd) {
+        return (fd >= 0 && (size_t) fd < pollfds->nslots) ? pollfds->slots[fd].data : NULL;
+    }
+
     /// @brief Set the timeout for poll(2) in milliseconds.
     /// @param pollfds The pollfds struct.
     /// @param timeout The timeout in milliseconds.
@@ -191,20 +696,37 @@
         pollfds->timeout = timeout;
     }
 
-    /// @brief Wrapper for the poll(2) system call.
+    /// @brief Let the pollfds struct grow on demand once all entries are in use.
+    /// @param pollfds The pollfds struct.
+    /// @param limit The maximum number of file descriptors, at least the current length.
+    /// @param growth The number of entries added at once, 0 to double the length.
+    inline void set_poll_growth (struct pollfds *pollfds, unsigned int limit, unsigned int growth) {
+        pollfds->limit = (limit > pollfds->length) ? limit : pollfds->length;
+        pollfds->growth = growth;
+    }
+
+    /// @brief Wait for events with the selected backend and fill the ready set.
     /// @param pollfds The pollfds struct to poll.
     /// @return The number of file descriptors with events, or -1 on error.
     inline int poll_events (struct pollfds *pollfds) {
-        return poll(pollfds->fds, pollfds->polled, pollfds->timeout);
+        return pollfds->ops->wait(pollfds);
     }
 
-    /// @brief Check if a polled file descriptor has a specific event flag set.
+    /// @brief Get a ready event reported by the last poll_events() call.
     /// @param pollfds The pollfds struct.
-    /// @param idx The index of the pollfd array.
+    /// @param idx The index into the ready set, less than the value returned by poll_events().
+    /// @return Pointer to the ready event.
+    inline const struct poll_event *ready_event (const struct pollfds *pollfds, size_t idx) {
+        return &pollfds->ready[idx];
+    }
+
+    /// @brief Check if a ready file descriptor has a specific event flag set.
+    /// @param pollfds The pollfds struct.
+    /// @param idx The index into the ready set.
     /// @param flag The event flag to check, e.g. POLLIN, POLLOUT.
     /// @return 1 if the flag is set, 0 if not.
     inline int check_flag (const struct pollfds *pollfds, size_t idx, short flag) {
-        return !!((pollfds->fds[idx].revents & flag) == flag);
+        return !!((pollfds->ready[idx].revents & flag) == flag);
     }
 
     // --- Function Definitions, iobuffer --- //
@@ -233,24 +755,54 @@
         return (buffer->head >= buffer->tail) ? buffer->size - (buffer->head - buffer->tail) : buffer->tail - buffer->head;
     }
 
+    /// @brief Describe the pending data of the buffer, the second segment is used only if the data wraps around.
+    /// @param buffer The iobuffer struct.
+    /// @param iov The two I/O vectors to fill in.
+    /// @return The number of segments holding data, i.e. 0, 1 or 2.
+    inline int iobuff_data_iov (const struct io_buffer *buffer, struct iovec iov[2]) {
+        assert(buffer && iov);
+
+        const size_t length = buffer->head - buffer->tail;
+        const size_t wtail = buffer->tail & (buffer->size - 1);
+        const size_t first_chunk = (buffer->flags & IOBUFF_MIRRORED || length < buffer->size - wtail) ? length : buffer->size - wtail;
+
+        iov[0].iov_base = buffer->buffer + wtail;
+        iov[0].iov_len = first_chunk;
+        iov[1].iov_base = buffer->buffer;
+        iov[1].iov_len = length - first_chunk;
+
+        return (length == 0) ? 0 : (first_chunk < length) ? 2 : 1;
+    }
+
     /// @brief Get the pointer to the head of the buffer.
+    /// @note The following free space is contiguous only up to the end of the storage, unless IOBUFF_MIRRORED.
     /// @param buffer The iobuffer struct.
     /// @return Pointer to the head of the buffer.
     inline char *iobuff_headptr (const struct io_buffer *buffer) {
         assert(buffer);
-        return buffer->buffer + buffer->head;
+        return buffer->buffer + (buffer->head & (buffer->size - 1));
     }
 
     /// @brief Get the pointer to the tail of the buffer.
     /// @param buffer The iobuffer struct.
+    /// @note The pending data is contiguous only up to the end of the storage, unless IOBUFF_MIRRORED.
     /// @return Pointer to the tail of the buffer.
     inline char *iobuff_tailptr (const struct io_buffer *buffer) {
         assert(buffer);
-        return buffer->buffer + buffer->tail;
+        return buffer->buffer + (buffer->tail & (buffer->size - 1));
     }
 
     // --- Function Definitions, asynchronnous server --- //
 
+    /// @brief Get the context of a connected client by its file descriptor.
+    /// @note This is a direct load from the descriptor index, unlike the lookup in server->contexts.
+    /// @param server The server context.
+    /// @param fd The client file descriptor.
+    /// @return Pointer to the client context, NULL if the descriptor is not a connected client.
+    inline struct client_context *as_get_client (const struct server_context *server, int fd) {
+        return (fd == server->info.fd) ? NULL : (struct client_context *) event_data(server->polled, fd);
+    }
+
     #ifdef __cplusplus
     }
     #endif // __cplusplus
@@ -0,0 +1,133 @@
+// ==============================================================================
+//                       Timer Wheel, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides a hierarchical hashed timer wheel with a
+// resolution of one millisecond. Arming and cancelling a timer is O(1), the
+// timers are intrusive and doubly linked into the slots of their level, timers
+// of the upper levels cascade down as the wheel turns. Empty stretches of the
+// wheel are skipped using the occupancy bitmaps of the levels, so the cost of
+// the wheel depends on the number of expiring timers, not on the elapsed time
+// or on the number of armed timers.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef AS_TIMER_H_
+#define AS_TIMER_H_
+
+    // --- Standard Libraries --- //
+
+    #include <stddef.h>     // For NULL definition and size_t type.
+    #include <stdbool.h>    // For boolean data type.
+    #include <stdint.h>     // For fixed-width integer types, e.g. uint64_t.
+
+    // --- Constants and Macros --- //
+
+    #define TIMER_SLOT_BITS 6U      // Number of bits resolved by a level of the wheel.
+    #define TIMER_SLOTS     (1U << TIMER_SLOT_BITS)
+    #define TIMER_SLOT_MASK (TIMER_SLOTS - 1U)
+    #define TIMER_LEVELS    5U      // Number of levels, delays up to 2^30 ms (about 12 days) are exact.
+
+    // --- Type Definitions --- //
+
+    struct as_timer;
+
+    /// @brief Timer callback, called once the timer expires.
+    /// @note The timer is disarmed before the call, it may be re-armed by the callback.
+    /// @param timer The expired timer.
+    /// @param data User data passed to timer_advance().
+    typedef void (*timer_callback_t)(struct as_timer *timer, void *data);
+
+    /// @brief Timer of the wheel, embed it in the structure it belongs to.
+    struct as_timer {
+        struct as_timer     *next;      // Next timer of the slot.
+        struct as_timer     **pprev;    // Link pointing to this timer, NULL if the timer is not armed.
+        uint64_t            expires;    // Expiry time in milliseconds, see timer_now().
+        unsigned int        slot;       // Index of the slot, level * TIMER_SLOTS + slot of the level.
+        timer_callback_t    callback;   // Called once the timer expires.
+        void                *arg;       // User argument of the timer.
+    };
+
+    /// @brief Hierarchical timer wheel.
+    struct timer_wheel {
+        uint64_t            tick;                               // Next millisecond to be processed.
+        uint64_t            now;                                // Time of the last timer_advance().
+        size_t              count;                              // Number of armed timers.
+        uint64_t            occupied[TIMER_LEVELS];             // Bitmap of the non-empty slots per level.
+        struct as_timer     *slots[TIMER_LEVELS][TIMER_SLOTS];  // Timers by level and slot.
+    };
+
+    #ifdef __cplusplus
+    extern "C" {
+    #endif // __cplusplus
+
+    // --- Function Prototypes --- //
+
+    /// @brief Get the current time of the monotonic clock in milliseconds.
+    /// @return The current time in milliseconds.
+    uint64_t timer_now (void);
+
+    /// @brief Initialize an empty timer wheel.
+    /// @param wheel The timer wheel.
+    /// @param now The current time in milliseconds.
+    void timer_wheel_init (struct timer_wheel *wheel, uint64_t now);
+
+    /// @brief Arm the timer, an already armed timer is re-armed.
+    /// @note Timers expiring in the past are expired by the next timer_advance().
+    /// @param wheel The timer wheel.
+    /// @param timer The timer, its callback must be set.
+    /// @param expires The expiry time in milliseconds.
+    void timer_arm (struct timer_wheel *wheel, struct as_timer *timer, uint64_t expires);
+
+    /// @brief Cancel the timer, does nothing if the timer is not armed.
+    /// @param wheel The timer wheel.
+    /// @param timer The timer.
+    void timer_cancel (struct timer_wheel *wheel, struct as_timer *timer);
+
+    /// @brief Expire all timers due by the given time and call their callbacks.
+    /// @param wheel The timer wheel.
+    /// @param now The current time in milliseconds.
+    /// @param data User data propagated to the timer callbacks.
+    /// @return The number of expired timers.
+    size_t timer_advance (struct timer_wheel *wheel, uint64_t now, void *data);
+
+    /// @brief Get the time until the wheel has to be advanced next.
+    /// @note Timers of the upper levels may wake up the wheel early to cascade them down, never late.
+    /// @param wheel The timer wheel.
+    /// @param now The current time in milliseconds.
+    /// @return The timeout in milliseconds, -1 if no timer is armed.
+    int timer_next (const struct timer_wheel *wheel, uint64_t now);
+
+    /// @brief Check whether the timer is armed.
+    /// @param timer The timer.
+    /// @return true if the timer is armed, false otherwise.
+    static inline bool timer_armed (const struct as_timer *timer) {
+        return timer->pprev != NULL;
+    }
+
+    #ifdef __cplusplus
+    }
+    #endif // __cplusplus
+
+#endif // AS_TIMER_H_
@@ -0,0 +1,124 @@
+// ==============================================================================
+//                       io_uring Engine, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides a completion-based I/O engine for the
+// asynchronous TCP server built on top of the Linux io_uring interface. The
+// listener is served by accept requests bounded by the free slots of the
+// accept queue, clients receive data through recv requests into a ring of
+// provided buffers, bounded by the free space of their input buffers, and the
+// output buffers are flushed with batched sendmsg submissions. Completions are
+// dispatched to the regular event handlers of the server and the clients.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef AS_URING_H_
+#define AS_URING_H_
+
+    // --- Standard Libraries --- //
+
+    #include <stddef.h>     // For NULL definition and size_t type.
+    #include <stdbool.h>    // For boolean data type.
+
+    // --- POSIX Libraries --- //
+
+    #include <sys/types.h>  // For ssize_t type.
+    #include <sys/socket.h> // For the msghdr struct used by sendmsg submissions.
+    #include <sys/uio.h>    // For the iovec struct.
+
+    // --- Constants and Macros --- //
+
+    #define URING_ENTRIES       256U    // Number of submission queue entries.
+    #define URING_BUFFER_COUNT  256U    // Number of provided receive buffers, power of two.
+    #define URING_BUFFER_SIZE   4096UL  // Size of a single provided receive buffer.
+    #define URING_ACCEPT_QUEUE  256U    // Maximum number of accepted, not yet claimed descriptors.
+    #define URING_ACCEPT_BATCH  16U     // Maximum number of accept requests in flight.
+
+    // --- Type Definitions --- //
+
+    struct server_context;
+    struct client_context;
+    struct io_buffer;
+
+    /// @brief Per-client state of the io_uring engine.
+    struct client_uring {
+        struct msghdr   msg;        // Message header of the in-flight sendmsg.
+        struct iovec    iov[2];     // Output ring segments of the in-flight sendmsg.
+        unsigned int    inflight;   // Number of requests in flight, the context is busy while non-zero.
+        size_t          sending;    // Number of bytes submitted for sending, 0 if idle.
+        bool            closing;    // Client is being disconnected, completions are dropped.
+        bool            cancelled;  // The cancellation of the requests in flight was queued.
+        bool            receiving;  // A recv is in flight.
+        bool            throttled;  // The input buffer was full, the recv is re-armed once it was consumed.
+    };
+
+    #ifdef __cplusplus
+    extern "C" {
+    #endif // __cplusplus
+
+    // --- Function Prototypes --- //
+
+    /// @brief Set up the io_uring instance and arm the accept requests on the listener.
+    /// @param server The bound server context, the listener must be open.
+    /// @return 0 on success, -1 on failure (e.g. io_uring not supported by the kernel).
+    int uring_create (struct server_context *server);
+
+    /// @brief Tear down the io_uring instance and release the provided buffers.
+    /// @param server The server context.
+    void uring_destroy (struct server_context *server);
+
+    /// @brief Claim a descriptor accepted by the engine.
+    /// @param server The server context.
+    /// @return The accepted file descriptor, -1 if none is pending.
+    int uring_accept (struct server_context *server);
+
+    /// @brief Start receiving data for a newly accepted client.
+    /// @param server The server context.
+    /// @param client The client context, the descriptor must be open.
+    /// @return 0 on success, -1 on failure.
+    int uring_attach (struct server_context *server, struct client_context *client);
+
+    /// @brief Cancel all requests of a client that is being disconnected, may be called again until it succeeded.
+    /// @note The client context must not be freed until client->uring.inflight drops to zero.
+    /// @param server The server context.
+    /// @param client The client context.
+    void uring_detach (struct server_context *server, struct client_context *client);
+
+    /// @brief Queue the output buffer of the client for sending.
+    /// @note The data is released from the buffer once the send completes, the buffer is pinned until then.
+    /// @param client The client context.
+    /// @return 0 on success, -1 on failure.
+    ssize_t uring_send (struct client_context *client);
+
+    /// @brief Submit the queued requests, wait for completions and dispatch them to the handlers.
+    /// @param server The server context.
+    /// @param data User data propagated to the event handlers.
+    /// @return 0 on success, -1 on failure.
+    int uring_poll (struct server_context *server, void *data);
+
+    #ifdef __cplusplus
+    }
+    #endif // __cplusplus
+
+#endif // AS_URING_H_
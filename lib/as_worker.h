@@ -0,0 +1,122 @@
+// ==============================================================================
+//                       Worker Pool, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides a pool of worker threads for the CPU-heavy
+// work of the client handlers, e.g. compression, parsing or cryptography. The
+// loop submits a task tied to a client context, the task runs on one of the
+// workers (idle workers steal queued tasks from the busy ones) and the result is
+// handed back to the loop thread of the client through the lock-free completion
+// queue of its server context, so that the output is still appended to the
+// client's output buffer by the loop thread.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef AS_WORKER_H_
+#define AS_WORKER_H_
+
+    // --- Standard Libraries --- //
+
+    #include <stddef.h>     // For NULL definition and size_t type.
+    #include <stdatomic.h>  // For the state shared between the workers.
+
+    // --- POSIX Libraries --- //
+
+    #include <pthread.h>    // For the worker threads, e.g. pthread_create(3).
+
+    // --- Project Libraries --- //
+
+    #include "as_server.h"
+
+    // --- Type Definitions --- //
+
+    struct as_task;
+
+    /// @brief Work callback, called on a worker thread.
+    /// @note It must not touch the client context or its buffers, they are owned by the loop thread.
+    /// @param task The task to run.
+    typedef void (*task_callback_t)(struct as_task *task);
+
+    /// @brief Task submitted to the worker pool.
+    /// @note The task is owned by the caller, it must stay valid until its completion callback is called.
+    struct as_task {
+        struct as_completion    completion; // Completion handed back to the loop, set the done callback.
+        task_callback_t         work;       // Called on a worker thread.
+        void                    *arg;       // User argument of the task (optional).
+        struct as_task          *next;      // Link of the worker queue.
+    };
+
+    /// @brief Worker thread with its own queue of tasks.
+    struct worker {
+        struct as_worker_pool   *pool;      // Pool the worker belongs to.
+        pthread_t               thread;     // Thread running the worker.
+        pthread_mutex_t         lock;       // Protects the queue of the worker.
+        struct as_task          *head;      // The oldest queued task.
+        struct as_task          *tail;      // The most recently queued task.
+    };
+
+    /// @brief Pool of worker threads.
+    struct as_worker_pool {
+        struct worker           *workers;   // The workers.
+        size_t                  count;      // Number of workers.
+        atomic_size_t           next;       // Worker receiving the next task, round-robin.
+        atomic_size_t           queued;     // Number of queued tasks over all workers.
+        atomic_bool             running;    // The workers keep waiting for tasks while set.
+        pthread_mutex_t         idle_lock;  // Protects the sleeping workers.
+        pthread_cond_t          idle;       // Signaled when a task is queued.
+        size_t                  sleeping;   // Number of sleeping workers.
+    };
+
+    #ifdef __cplusplus
+    extern "C" {
+    #endif // __cplusplus
+
+    // --- Function Prototypes --- //
+
+    /// @brief Start the worker threads.
+    /// @param pool The worker pool to start.
+    /// @param count Number of workers, 0 for one per online core.
+    /// @return 0 on success, -1 on failure.
+    int as_workers_start (struct as_worker_pool *pool, size_t count);
+
+    /// @brief Stop the worker threads once the queued tasks are done.
+    /// @note Stop the pool before as_cleanup() of the servers that submitted tasks, and process the last
+    /// completions with as_poll() if they are needed.
+    /// @param pool The worker pool to stop.
+    void as_workers_stop (struct as_worker_pool *pool);
+
+    /// @brief Submit a task tied to the client, must be called on the loop thread of the client.
+    /// @note Set task->work and task->completion.done before submitting. The done callback is called on
+    /// the loop thread of the client once the work is completed, even if the client was disconnected in
+    /// the meantime, the client context stays valid until then.
+    /// @param pool The worker pool.
+    /// @param client The client context the task belongs to.
+    /// @param task The task to submit.
+    /// @return 0 on success, -1 on failure.
+    int as_submit (struct as_worker_pool *pool, struct client_context *client, struct as_task *task);
+
+    #ifdef __cplusplus
+    }
+    #endif // __cplusplus
+
+#endif // AS_WORKER_H_
@@ -3,9 +3,11 @@
 // ==============================================================================
 //
 // Description: This library provides basic implementation of a generic hash table
-// using a linked list for collision resolution. To use this library, user must
-// provide a hash function and a comparison function for the keys and optionally
-// a wrapper function for the retrieval of the hash value for type safety.
+// using a linked list for collision resolution, or alternatively open addressing
+// with linear probing in a power-of-two table that grows incrementally. To use
+// this library, user must provide a hash function and a comparison function for
+// the keys and optionally a wrapper function for the retrieval of the hash value
+// for type safety.
 //
 // MIT License
 //
@@ -53,6 +55,27 @@
         struct htable_node *next; // The next hash node in the linked list.
     };
 
+    /// @brief Open addressing slot structure, the key-value pair is stored inline.
+    /// @note The slot is empty if the value is NULL.
+    struct htable_slot {
+        void *key;              // The key for the slot.
+        void *value;            // The value for the slot.
+        unsigned long hash;     // The cached hash value of the key.
+    };
+
+    /// @brief Slab of hash nodes allocated at once by the node pool.
+    struct htable_slab {
+        struct htable_slab *next;   // The next slab of the pool.
+        struct htable_node nodes[]; // The hash nodes of the slab.
+    };
+
+    /// @brief Node pool of the chained hash table, the free nodes are linked through their next field.
+    struct htable_pool {
+        struct htable_slab *slabs;  // The slabs allocated by the pool.
+        struct htable_node *free;   // The list of free hash nodes.
+        size_t chunk;               // The number of nodes per slab, 0 if the pool is disabled.
+    };
+
     struct callbacks {
         htable_cpy_t kcpy;
         htable_cpy_t vcpy;
@@ -60,6 +83,12 @@
         htable_free_t vfree;
     };
 
+    /// @brief Collision resolution strategy of the hash table.
+    enum htable_mode {
+        HTABLE_CHAINED = 0,     // Fixed number of buckets with linked lists of nodes.
+        HTABLE_OPEN             // Open addressing with linear probing, resized incrementally.
+    };
+
     /// @brief Hash table structure.
     typedef struct hash_map {
         struct htable_node **table; // The hash table.
@@ -68,6 +97,12 @@
         htable_hash_t hash;         // The hash function for the keys.
         htable_keq_t keq;           // The comparison function for the keys.
         struct callbacks cbs;       // The callback functions for the hash table.
+        enum htable_mode mode;      // The collision resolution strategy.
+        struct htable_slot *slots;  // The slots of the open addressing table, power-of-two size.
+        struct htable_slot *old_slots; // The slots being migrated during a resize, NULL otherwise.
+        size_t old_size;            // The size of the table being migrated.
+        size_t migrated;            // The number of slots already migrated.
+        struct htable_pool pool;    // The node pool of the chained table, see htable_create_pooled().
     } htable_t;
 
     // --- Function Prototypes --- //
@@ -79,6 +114,28 @@
     /// @return Pointer to the allocated hash table, NULL on failure.
     htable_t *htable_create (size_t size, htable_hash_t hash, htable_keq_t keq, const struct callbacks *cbs);
 
+    /// @brief Create a hash table with the specified size and collision resolution strategy.
+    /// @note In HTABLE_OPEN mode the size is rounded up to a power of two and used as the initial
+    /// capacity, the table doubles once it is three quarters full, moving a few slots per operation.
+    /// @param size Initial number of buckets (HTABLE_CHAINED) or slots (HTABLE_OPEN).
+    /// @param hash User-defined hash function for the keys.
+    /// @param keq User-defined comparison function for the keys.
+    /// @param cbs Optional copy and free callbacks, NULL for the defaults.
+    /// @param mode The collision resolution strategy.
+    /// @return Pointer to the allocated hash table, NULL on failure.
+    htable_t *htable_create_mode (size_t size, htable_hash_t hash, htable_keq_t keq, const struct callbacks *cbs, enum htable_mode mode);
+
+    /// @brief Create a chained hash table that allocates its nodes from a pool of slabs.
+    /// @note The removed nodes are kept on a freelist and reused by the following insertions, so that
+    /// the table does not allocate memory in steady state. The slabs are released by htable_destroy().
+    /// @param size Total number of buckets in the hash table.
+    /// @param hash User-defined hash function for the keys.
+    /// @param keq User-defined comparison function for the keys.
+    /// @param cbs Optional copy and free callbacks, NULL for the defaults.
+    /// @param chunk Number of nodes allocated per slab, the first slab is allocated upfront.
+    /// @return Pointer to the allocated hash table, NULL on failure.
+    htable_t *htable_create_pooled (size_t size, htable_hash_t hash, htable_keq_t keq, const struct callbacks *cbs, size_t chunk);
+
     /// @brief Destroy the hash table and free resources.
     /// @param table The hash table to destroy.
     void htable_destroy (htable_t *table);
@@ -0,0 +1,227 @@
+// ==============================================================================
+//                       Type-specialized Hash table generator
+// ==============================================================================
+//
+// Description: This header provides a macro generator of type-specialized hash
+// tables using open addressing with linear probing in a power-of-two table. Each
+// instantiation of HTABLE_GEN(...) defines a table type and static inline functions
+// for a single key and value type, so the hash and comparison functions are called
+// directly and can be inlined by the compiler, and keys and values are stored by
+// value without copy or free callbacks. The generated interface mirrors the one of
+// the generic hash table, see htable.h.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef HTABLE_GEN_H_
+#define HTABLE_GEN_H_
+
+    // --- Standard Libraries --- //
+
+    #include <stddef.h>     // For NULL definition and size_t type.
+    #include <stdlib.h>     // For memory allocation operations, e.g. calloc(3), free(3).
+
+    // --- Function Definitions --- //
+
+    /// @brief Hash function for integer keys, e.g. file descriptors.
+    /// @note The table keeps the low bits of the product. Multiplying by an odd constant is a bijection on them, so
+    /// keys that differ in their low bits never share a home slot, e.g. the dense range of file descriptors, while
+    /// keys that differ only in bits above the table mask always do. This is not Fibonacci hashing, which would
+    /// keep the high bits of the product.
+    /// @param key The integer key.
+    /// @return The hash value for the key.
+    static inline unsigned long htable_gen_hash_int (int key) {
+        return (unsigned long)((unsigned int) key * 2654435769U);
+    }
+
+    /// @brief Comparison function for integer keys.
+    /// @param keyA The first key.
+    /// @param keyB The second key.
+    /// @return Non-zero if the keys are equal, 0 otherwise.
+    static inline int htable_gen_eq_int (int keyA, int keyB) {
+        return keyA == keyB;
+    }
+
+    // --- Constants and Macros --- //
+
+    /// @brief Define a hash table type and its functions for the specified key and value types.
+    /// @note The generated type is "struct name", the functions are prefixed with "name_":
+    ///
+    ///     int    name_init    (struct name *table, size_t size);
+    ///     void   name_destroy (struct name *table);
+    ///     int    name_insert  (struct name *table, key_t key, val_t value);
+    ///     val_t *name_get     (struct name *table, key_t key);
+    ///     int    name_remove  (struct name *table, key_t key);
+    ///
+    /// The table doubles once it is three quarters full, the returned value pointers are
+    /// invalidated by the next insertion or removal.
+    /// @param name Name of the generated table type and prefix of its functions.
+    /// @param key_t Type of the keys, stored by value.
+    /// @param val_t Type of the values, stored by value.
+    /// @param hash_fn Hash function of the keys, unsigned long (*)(key_t).
+    /// @param eq_fn Comparison function of the keys, int (*)(key_t, key_t), non-zero if equal.
+    #define HTABLE_GEN(name, key_t, val_t, hash_fn, eq_fn)                                  \
+                                                                                            \
+        struct name##_slot {                                                                \
+            key_t key;                  /* The key for the slot. */                         \
+            val_t value;                /* The value for the slot. */                       \
+            unsigned char live;         /* Non-zero if the slot holds a key-value pair. */  \
+        };                                                                                  \
+                                                                                            \
+        struct name {                                                                       \
+            struct name##_slot *slots;  /* The slots of the table, power-of-two size. */    \
+            size_t size;                /* The size of the table. */                        \
+            size_t count;               /* The number of elements in the table. */          \
+        };                                                                                  \
+                                                                                            \
+        static inline int name##_init (struct name *table, size_t size) {                   \
+                                                                                            \
+            table->size = 8;                                                                \
+                                                                                            \
+            while (table->size < size) {                                                    \
+                table->size <<= 1;                                                          \
+            }                                                                               \
+                                                                                            \
+            table->count = 0;                                                               \
+                                                                                            \
+            if ((table->slots = calloc(table->size, sizeof(struct name##_slot))) == NULL) { \
+                return -1;                                                                  \
+            }                                                                               \
+                                                                                            \
+            return 0;                                                                       \
+        }                                                                                   \
+                                                                                            \
+        static inline void name##_destroy (struct name *table) {                            \
+                                                                                            \
+            free(table->slots);                                                             \
+                                                                                            \
+            table->slots = NULL;                                                            \
+            table->size = table->count = 0;                                                 \
+        }                                                                                   \
+                                                                                            \
+        static inline struct name##_slot *name##_find (const struct name *table, key_t key) { \
+                                                                                            \
+            const size_t mask = table->size - 1;                                            \
+                                                                                            \
+            for (size_t i = hash_fn(key) & mask; table->slots[i].live; i = (i + 1) & mask) { \
+                if (eq_fn(table->slots[i].key, key)) {                                      \
+                    return &table->slots[i];                                                \
+                }                                                                           \
+            }                                                                               \
+                                                                                            \
+            return NULL;                                                                    \
+        }                                                                                   \
+                                                                                            \
+        static inline void name##_place (struct name *table, key_t key, val_t value) {      \
+                                                                                            \
+            const size_t mask = table->size - 1;                                            \
+            size_t i = hash_fn(key) & mask;                                                 \
+                                                                                            \
+            while (table->slots[i].live) {                                                  \
+                i = (i + 1) & mask;                                                         \
+            }                                                                               \
+                                                                                            \
+            table->slots[i].key = key;                                                      \
+            table->slots[i].value = value;                                                  \
+            table->slots[i].live = 1;                                                       \
+        }                                                                                   \
+                                                                                            \
+        static inline int name##_grow (struct name *table) {                                \
+                                                                                            \
+            struct name##_slot *old = table->slots;                                         \
+            const size_t old_size = table->size;                                            \
+                                                                                            \
+            if ((table->slots = calloc(old_size << 1, sizeof(struct name##_slot))) == NULL) { \
+                table->slots = old;                                                         \
+                return -1;                                                                  \
+            }                                                                               \
+                                                                                            \
+            table->size = old_size << 1;                                                    \
+                                                                                            \
+            for (size_t i = 0; i < old_size; i++) {                                         \
+                if (old[i].live) {                                                          \
+                    name##_place(table, old[i].key, old[i].value);                          \
+                }                                                                           \
+            }                                                                               \
+                                                                                            \
+            free(old);                                                                      \
+                                                                                            \
+            return 0;                                                                       \
+        }                                                                                   \
+                                                                                            \
+        static inline int name##_insert (struct name *table, key_t key, val_t value) {      \
+                                                                                            \
+            struct name##_slot *slot = name##_find(table, key);                             \
+                                                                                            \
+            if (slot != NULL) {                                                             \
+                slot->value = value;                                                        \
+                return 0;                                                                   \
+            }                                                                               \
+                                                                                            \
+            if ((table->count + 1) * 4 > table->size * 3 && name##_grow(table) < 0) {       \
+                return -2;                                                                  \
+            }                                                                               \
+                                                                                            \
+            name##_place(table, key, value);                                                \
+            table->count++;                                                                 \
+                                                                                            \
+            return 0;                                                                       \
+        }                                                                                   \
+                                                                                            \
+        static inline val_t *name##_get (struct name *table, key_t key) {                   \
+                                                                                            \
+            struct name##_slot *slot = name##_find(table, key);                             \
+                                                                                            \
+            return slot != NULL ? &slot->value : NULL;                                      \
+        }                                                                                   \
+                                                                                            \
+        static inline int name##_remove (struct name *table, key_t key) {                   \
+                                                                                            \
+            struct name##_slot *slot = name##_find(table, key);                             \
+                                                                                            \
+            if (slot == NULL) {                                                             \
+                return -1;                                                                  \
+            }                                                                               \
+                                                                                            \
+            /* Shift the following entries of the cluster back instead of leaving a tombstone. */ \
+            const size_t mask = table->size - 1;                                            \
+            size_t hole = (size_t)(slot - table->slots);                                    \
+                                                                                            \
+            for (size_t i = (hole + 1) & mask; table->slots[i].live; i = (i + 1) & mask) {  \
+                                                                                            \
+                const size_t home = hash_fn(table->slots[i].key) & mask;                    \
+                                                                                            \
+                /* Move the entry unless its home lies cyclically in (hole, i]. */           \
+                if (((i - home) & mask) >= ((i - hole) & mask)) {                           \
+                    table->slots[hole] = table->slots[i];                                   \
+                    hole = i;                                                               \
+                }                                                                           \
+            }                                                                               \
+                                                                                            \
+            table->slots[hole].live = 0;                                                    \
+            table->count--;                                                                 \
+                                                                                            \
+            return 0;                                                                       \
+        }
+
+#endif // HTABLE_GEN_H_
@@ -1,21 +1,26 @@
 #ifndef LOGGING_H_
-#define LOGGINH_H_
+#define LOGGING_H_
 
     #include <stdio.h>
 
-    #ifdef DEBUG
+    #include "as_log.h"
+
+    // The level is fixed at compile time, the messages above it are compiled out with their arguments.
+    #ifndef LOG_LEVEL
+        #ifdef DEBUG
+            #define LOG_LEVEL LOG_LEVEL_INFO
+        #else
+            #define LOG_LEVEL LOG_LEVEL_OFF
+        #endif // DEBUG
+    #endif // LOG_LEVEL
+
+    #if LOG_LEVEL >= LOG_LEVEL_INFO
         /// @brief Log an informational message.
         /// @param message The informational message to log.
         #define LOG_INFO(formatted_message, ...) \
         do { \
-            (void) fprintf(stdout, formatted_message, ##__VA_ARGS__); \
-        } while (0)
-
-        /// @brief Log an error message.
-        /// @param message The error message to log.
-        #define LOG_ERROR(message) \
-        do { \
-            perror(message); \
+            static struct log_site log_site_; \
+            log_info(&log_site_, formatted_message, ##__VA_ARGS__); \
         } while (0)
     #else
         /// @brief Log an informational message.
@@ -24,13 +29,23 @@
         do { \
             (void) formatted_message; \
         } while (0)
+    #endif // LOG_LEVEL >= LOG_LEVEL_INFO
 
+    #if LOG_LEVEL >= LOG_LEVEL_ERROR
+        /// @brief Log an error message.
+        /// @param message The error message to log.
+        #define LOG_ERROR(message) \
+        do { \
+            static struct log_site log_site_; \
+            log_error(&log_site_, message); \
+        } while (0)
+    #else
         /// @brief Log an error message.
         /// @param message The error message to log.
         #define LOG_ERROR(message) \
         do { \
             (void) message; \
         } while (0)
-    #endif // DEBUG
+    #endif // LOG_LEVEL >= LOG_LEVEL_ERROR
 
-#endif // LOGGING_H_
\ No newline at end of file
+#endif // LOGGING_H_
@@ -0,0 +1,215 @@
+// ==============================================================================
+//                     Intrusive Multi-Producer Single-Consumer Queue
+// ==============================================================================
+//
+// Description: This header provides a lock-free, unbounded multi-producer single-
+// consumer queue of intrusive nodes (D. Vyukov's algorithm). Any thread can push
+// a node with a single atomic exchange, only the owning thread may pop. The nodes
+// are embedded in the user structures, the queue never allocates memory. A
+// bounded variant storing pointers in a power-of-two ring of sequenced cells is
+// provided as well, its producers fail instead of blocking once it is full.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef MPSC_H_
+#define MPSC_H_
+
+    // --- Standard Libraries --- //
+
+    #include <stddef.h>     // For NULL definition.
+    #include <stdlib.h>     // For memory allocation operations, e.g. malloc(3), free(3).
+    #include <stdbool.h>    // For boolean data type.
+    #include <stdatomic.h>  // For the atomic links of the nodes.
+
+    // --- Type Definitions --- //
+
+    /// @brief Node of the queue, embedded in the queued structure.
+    struct mpsc_node {
+        _Atomic(struct mpsc_node *) next;   // The next node towards the head.
+    };
+
+    /// @brief Queue structure, the producers push to the head and the consumer pops from the tail.
+    struct mpsc_queue {
+        _Atomic(struct mpsc_node *) head;   // The most recently pushed node, shared by the producers.
+        struct mpsc_node *tail;             // The oldest node, owned by the consumer.
+        struct mpsc_node stub;              // Placeholder keeping the queue non-empty.
+    };
+
+    /// @brief Cell of the bounded ring, the sequence number tells whose turn it is.
+    struct mpsc_cell {
+        atomic_size_t seq;                  // Equal to the position when free, position + 1 when filled.
+        void *value;                        // The stored pointer.
+    };
+
+    /// @brief Bounded queue structure of pointers.
+    struct mpsc_ring {
+        atomic_size_t head;                 // Next position to fill, shared by the producers.
+        size_t tail;                        // Next position to consume, owned by the consumer.
+        size_t mask;                        // Capacity of the ring minus one, power-of-two capacity.
+        struct mpsc_cell cells[];           // The cells of the ring.
+    };
+
+    // --- Function Definitions --- //
+
+    /// @brief Initialize an empty queue.
+    /// @param queue The queue to initialize.
+    static inline void mpsc_init (struct mpsc_queue *queue) {
+        atomic_store_explicit(&queue->stub.next, NULL, memory_order_relaxed);
+        atomic_store_explicit(&queue->head, &queue->stub, memory_order_relaxed);
+        queue->tail = &queue->stub;
+    }
+
+    /// @brief Push a node to the queue, safe to call from any thread.
+    /// @param queue The queue to push to.
+    /// @param node The node to push, it must not be queued already.
+    static inline void mpsc_push (struct mpsc_queue *queue, struct mpsc_node *node) {
+        atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+
+        struct mpsc_node *prev = atomic_exchange_explicit(&queue->head, node, memory_order_acq_rel);
+
+        // The node becomes visible to the consumer once it is linked to its predecessor.
+        atomic_store_explicit(&prev->next, node, memory_order_release);
+    }
+
+    /// @brief Pop the oldest node from the queue, only the consumer thread may call it.
+    /// @note NULL is also returned while a producer is between its exchange and its link, the
+    /// producer is expected to notify the consumer after the push, see as_notify().
+    /// @param queue The queue to pop from.
+    /// @return The oldest node, NULL if the queue is empty.
+    static inline struct mpsc_node *mpsc_pop (struct mpsc_queue *queue) {
+
+        struct mpsc_node *tail = queue->tail;
+        struct mpsc_node *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+        // Skip the placeholder.
+        if (tail == &queue->stub) {
+
+            if (next == NULL) {
+                return NULL;
+            }
+
+            queue->tail = next;
+            tail = next;
+            next = atomic_load_explicit(&tail->next, memory_order_acquire);
+        }
+
+        if (next != NULL) {
+            queue->tail = next;
+            return tail;
+        }
+
+        // The tail is the last node unless a producer is still linking a newer one.
+        if (tail != atomic_load_explicit(&queue->head, memory_order_acquire)) {
+            return NULL;
+        }
+
+        // Put the placeholder behind the last node, so that it can be detached.
+        mpsc_push(queue, &queue->stub);
+
+        if ((next = atomic_load_explicit(&tail->next, memory_order_acquire)) != NULL) {
+            queue->tail = next;
+            return tail;
+        }
+
+        return NULL;
+    }
+
+    /// @brief Allocate a bounded queue.
+    /// @param capacity Number of cells, a power of two.
+    /// @return Pointer to the allocated queue, NULL on failure.
+    static inline struct mpsc_ring *mpsc_ring_create (size_t capacity) {
+
+        struct mpsc_ring *ring = NULL;
+
+        if ((capacity & (capacity - 1)) != 0 || (ring = malloc(sizeof(*ring) + capacity * sizeof(ring->cells[0]))) == NULL) {
+            return NULL;
+        }
+
+        atomic_init(&ring->head, 0);
+        ring->tail = 0;
+        ring->mask = capacity - 1;
+
+        for (size_t i = 0; i < capacity; i++) {
+            atomic_init(&ring->cells[i].seq, i);
+            ring->cells[i].value = NULL;
+        }
+
+        return ring;
+    }
+
+    /// @brief Push a pointer to the bounded queue, safe to call from any thread.
+    /// @param ring The queue to push to.
+    /// @param value The pointer to push.
+    /// @return true on success, false if the queue is full.
+    static inline bool mpsc_ring_push (struct mpsc_ring *ring, void *value) {
+
+        size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+        for (;;) {
+
+            struct mpsc_cell *cell = &ring->cells[pos & ring->mask];
+            const size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+            const ptrdiff_t diff = (ptrdiff_t) (seq - pos);
+
+            // The cell is free, claim the position.
+            if (diff == 0) {
+
+                if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                    cell->value = value;
+                    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                    return true;
+                }
+            }
+            // The cell still holds the value from the previous lap.
+            else if (diff < 0) {
+                return false;
+            }
+            // Another producer claimed the position.
+            else {
+                pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief Pop the oldest pointer from the bounded queue, only the consumer thread may call it.
+    /// @param ring The queue to pop from.
+    /// @return The oldest pointer, NULL if the queue is empty.
+    static inline void *mpsc_ring_pop (struct mpsc_ring *ring) {
+
+        struct mpsc_cell *cell = &ring->cells[ring->tail & ring->mask];
+
+        if (atomic_load_explicit(&cell->seq, memory_order_acquire) != ring->tail + 1) {
+            return NULL;
+        }
+
+        void *value = cell->value;
+
+        // Hand the cell to the producers of the next lap.
+        atomic_store_explicit(&cell->seq, ring->tail + ring->mask + 1, memory_order_release);
+        ring->tail++;
+
+        return value;
+    }
+
+#endif // MPSC_H_
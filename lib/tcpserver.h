@@ -46,6 +46,7 @@
     #include <poll.h>       // For polling file descriptors, e.g. poll(2) and pollfd struct.
     #include <sys/socket.h> // For socket operations, e.g. socket(2).
     #include <netinet/in.h> // For internet address operations, e.g. sockaddr_in struct.
+    #include <netinet/tcp.h> // For the TCP socket options, e.g. TCP_NODELAY.
     #include <arpa/inet.h>  // For internet operations, e.g. inet_ntop(3).
     #include <unistd.h>     // For POSIX system calls, e.g. close(2), read(2), write(2).
 
@@ -65,6 +66,21 @@
     struct server_info {
         int                 fd;     // File descriptor of the client socket.
         struct sockaddr_in  addr;   // Address of the server socket.
+        int                 cpu;    // Core the listener prefers the connections of, -1 for any, see socket_options.
+    };
+
+    /// @brief Socket options profile, the listener options are applied before bind(2), the connection
+    /// options by socket_tune() on every accepted socket. Zeroed fields keep the system defaults.
+    struct socket_options {
+        int                 reuse_port; // Share the address with other listeners, see SO_REUSEPORT in socket(7).
+        int                 backlog;    // Length of the accept queue, 0 for MAX_CLIENTS.
+        int                 send_buffer; // Size of the send buffers in bytes, set on the listener and inherited, see SO_SNDBUF.
+        int                 recv_buffer; // Size of the receive buffers in bytes, set on the listener and inherited, see SO_RCVBUF.
+        int                 defer_accept; // Seconds to wait for the first data of a connection before it is accepted, see TCP_DEFER_ACCEPT in tcp(7).
+        int                 fast_open;  // Length of the pending TCP Fast Open queue of the listener, see TCP_FASTOPEN in tcp(7).
+        int                 incoming_cpu; // Prefer the connections processed by the core of the binding thread, see SO_INCOMING_CPU.
+        int                 no_delay;   // Connection option, send small segments right away, see TCP_NODELAY in tcp(7).
+        int                 busy_poll;  // Connection option, microseconds to busy poll the device queue, see SO_BUSY_POLL.
     };
 
     /// @brief Structure to store client information.
@@ -73,6 +89,7 @@
         int                         fd;         // File descriptor of the client socket.
         struct sockaddr_in          addr;       // Address of the client socket.
         const struct server_info    *listener;  // Server information.
+        int                         cpu;        // Core that processed the packets of the connection, -1 if unknown.
     };
 
     // --- Function Prototypes --- //
@@ -88,16 +105,46 @@
     /// @return Error code, 0 on success, -1 on failure.
     int server_bind (struct server_info *server, const char* ipv4);
 
+    /// @brief Create a listener socket on the specified port with the specified socket options.
+    /// @note With reuse_port several listeners (e.g. one per thread) can bind the same address, the kernel
+    /// then distributes the incoming connections between them. With incoming_cpu as well, a connection goes
+    /// to the listener bound by a thread on the core that processed its SYN if there is one (Linux 6.1).
+    /// @param server The server struct to create.
+    /// @param ipv4 The address and port to listen on.
+    /// @param opts The socket options, NULL for the defaults.
+    /// @return Error code, 0 on success, -1 on failure.
+    int server_bind_opts (struct server_info *server, const char* ipv4, const struct socket_options *opts);
+
     /// @brief Close the listener socket.
     /// @param server The server struct to close.
     void server_close (struct server_info *server);
 
+    /// @brief Apply the connection options of the profile to an accepted socket.
+    /// @note The options are set independently, the failed ones are logged and the rest is still applied.
+    /// @param fd The accepted socket.
+    /// @param opts The socket options profile.
+    /// @return 0 on success, -1 if an option could not be set (e.g. EPERM for SO_BUSY_POLL).
+    int socket_tune (int fd, const struct socket_options *opts);
+
+    /// @brief Get the core that processed the last packets of a connection, see SO_INCOMING_CPU in socket(7).
+    /// @note Typically the core handling the interrupts of the receive queue the connection is hashed to.
+    /// @param fd The connected socket.
+    /// @return The core identifier, -1 if unknown or not supported.
+    int socket_incoming_cpu (int fd);
+
     /// @brief Accept a connection from a client for the listener socket.
     /// @param server The server struct to accept the connection on.
     /// @param client The client struct to store the connection information.
     /// @return Error code, 0 on success, -1 on failure.
     int server_accept (const struct server_info *server, struct client_info *client);
 
+    /// @brief Accept a connection from a client for the listener socket in non-blocking, close-on-exec mode.
+    /// @note On Linux the flags are set by accept4(2) itself, elsewhere by fcntl(2) after accept(2).
+    /// @param server The server struct to accept the connection on, the listener should be non-blocking.
+    /// @param client The client struct to store the connection information.
+    /// @return Error code, 0 on success, -1 on failure, errno is EAGAIN if no connection is pending.
+    int server_accept_nonblock (const struct server_info *server, struct client_info *client);
+
     /// @brief Close the client socket.
     /// @param client The client struct to close.
     void client_close (struct client_info *client);
@@ -0,0 +1,438 @@
+// ==============================================================================
+//                      Message Framing, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides the framing of messages received into an
+// io_buffer, with length-prefixed and delimited (byte, LF and CRLF) modes. The
+// complete messages are handed out as views of one or two spans of the ring,
+// the second one if the message wraps around the end of the storage, and are
+// consumed in place, nothing is copied. The delimiters are searched with SIMD
+// instructions where available (AVX2, SSE2 or NEON, scalar otherwise) and the
+// data already scanned is not scanned again when more of the message arrives.
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#include <stdint.h>     // For fixed-width integer types, e.g. uint64_t.
+#include <string.h>     // For memory operations, e.g. memcpy(3).
+#include <errno.h>      // For the error codes, e.g. EMSGSIZE.
+#include <assert.h>     // For debugging, e.g. assert(3).
+
+#include "as_frame.h"
+#include "as_server.h"
+
+// The widest search available on the target is compiled in, AVX2 is selected at runtime on x86.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && defined(__GNUC__)
+#define FRAME_SCAN_X86
+#include <immintrin.h>  // For the SSE2 and AVX2 intrinsics, e.g. _mm_cmpeq_epi8().
+#elif defined(__ARM_NEON)
+#define FRAME_SCAN_NEON
+#include <arm_neon.h>   // For the NEON intrinsics, e.g. vceqq_u8().
+#endif
+
+// --- Constants and Macros --- //
+
+#define FRAME_NOT_FOUND SIZE_MAX    // Offset returned by ring_find() if the byte does not occur.
+
+// --- Static Function Definitions, delimiter search --- //
+
+/// @brief Get the smaller of two sizes.
+static inline size_t min_size (size_t a, size_t b) {
+    return (a < b) ? a : b;
+}
+
+/// @brief Find a byte eight bytes at a time, the fallback and the remainder of the vector searches.
+static const char *scan_scalar (const char *data, size_t length, unsigned char byte) {
+
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t pattern = ones * byte;
+    size_t idx = 0;
+
+    // A word holds the byte if the word xor the pattern has a zero byte.
+    for (; idx + sizeof(uint64_t) <= length; idx += sizeof(uint64_t)) {
+
+        uint64_t word;
+
+        memcpy(&word, data + idx, sizeof(word));
+        word ^= pattern;
+
+        if (((word - ones) & ~word & (ones << 7)) != 0) {
+            break;
+        }
+    }
+
+    for (; idx < length; idx++) {
+        if ((unsigned char) data[idx] == byte) {
+            return data + idx;
+        }
+    }
+
+    return NULL;
+}
+
+#if defined(FRAME_SCAN_X86)
+
+/// @brief Find a byte sixteen bytes at a time.
+/// @note The last vector overlaps the previous one instead of searching the remainder byte by byte.
+static const char *scan_sse2 (const char *data, size_t length, unsigned char byte) {
+
+    if (length < sizeof(__m128i)) {
+        return scan_scalar(data, length, byte);
+    }
+
+    const __m128i needle = _mm_set1_epi8((char) byte);
+    size_t idx = 0;
+
+    for (;;) {
+
+        const __m128i chunk = _mm_loadu_si128((const __m128i *) (const void *) (data + idx));
+        const unsigned int mask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+
+        if (mask != 0) {
+            return data + idx + __builtin_ctz(mask);
+        }
+
+        if (idx + sizeof(__m128i) >= length) {
+            return NULL;
+        }
+
+        idx = min_size(idx + sizeof(__m128i), length - sizeof(__m128i));
+    }
+}
+
+/// @brief Find a byte thirty-two bytes at a time, the data must hold at least one vector.
+/// @note The search stays in the AVX2 code, falling through to SSE2 code with the upper halves
+/// of the registers dirty costs a state transition on every call.
+__attribute__((target("avx2")))
+static const char *scan_avx2 (const char *data, size_t length, unsigned char byte) {
+
+    assert(length >= sizeof(__m256i));
+
+    const __m256i needle = _mm256_set1_epi8((char) byte);
+    const char *found = NULL;
+    size_t idx = 0;
+
+    // Long data is searched four vectors at a time, the vector holding the byte is located afterwards.
+    for (; idx + 4 * sizeof(__m256i) <= length; idx += 4 * sizeof(__m256i)) {
+
+        const __m256i *chunk = (const __m256i *) (const void *) (data + idx);
+        const __m256i first = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(chunk), needle),
+                                              _mm256_cmpeq_epi8(_mm256_loadu_si256(chunk + 1), needle));
+        const __m256i second = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256(chunk + 2), needle),
+                                               _mm256_cmpeq_epi8(_mm256_loadu_si256(chunk + 3), needle));
+
+        if (!_mm256_testz_si256(_mm256_or_si256(first, second), _mm256_or_si256(first, second))) {
+            break;
+        }
+    }
+
+    if (idx == length) {
+        _mm256_zeroupper();
+        return NULL;
+    }
+
+    idx = min_size(idx, length - sizeof(__m256i));
+
+    for (;;) {
+
+        const __m256i chunk = _mm256_loadu_si256((const __m256i *) (const void *) (data + idx));
+        const unsigned int mask = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+
+        if (mask != 0) {
+            found = data + idx + __builtin_ctz(mask);
+            break;
+        }
+
+        if (idx + sizeof(__m256i) >= length) {
+            break;
+        }
+
+        idx = min_size(idx + sizeof(__m256i), length - sizeof(__m256i));
+    }
+
+    _mm256_zeroupper();
+
+    return found;
+}
+
+#elif defined(FRAME_SCAN_NEON)
+
+/// @brief Find a byte sixteen bytes at a time.
+/// @note The last vector overlaps the previous one instead of searching the remainder byte by byte.
+static const char *scan_neon (const char *data, size_t length, unsigned char byte) {
+
+    if (length < 16) {
+        return scan_scalar(data, length, byte);
+    }
+
+    const uint8x16_t needle = vdupq_n_u8(byte);
+    size_t idx = 0;
+
+    for (;;) {
+
+        const uint8x16_t equal = vceqq_u8(vld1q_u8((const uint8_t *) data + idx), needle);
+
+        // Narrowing the comparison leaves four bits per byte, NEON has no movemask.
+        const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+
+        if (mask != 0) {
+            return data + idx + (__builtin_ctzll(mask) >> 2);
+        }
+
+        if (idx + 16 >= length) {
+            return NULL;
+        }
+
+        idx = min_size(idx + 16, length - 16);
+    }
+}
+
+#endif // FRAME_SCAN_X86
+
+// --- Static Function Definitions, ring access --- //
+
+/// @brief Get a byte of the pending data.
+/// @param buffer The buffer.
+/// @param offset The offset from the tail, less than the pending length.
+static inline unsigned char ring_byte (const struct io_buffer *buffer, size_t offset) {
+    return (unsigned char) buffer->buffer[(buffer->tail + offset) & (buffer->size - 1)];
+}
+
+/// @brief Find a byte in the pending data, across the end of the storage.
+/// @param buffer The buffer.
+/// @param offset The offset from the tail to start at.
+/// @param pending The length of the pending data.
+/// @param byte The byte to find.
+/// @return The offset of the byte from the tail, FRAME_NOT_FOUND if it does not occur.
+static size_t ring_find (const struct io_buffer *buffer, size_t offset, size_t pending, unsigned char byte) {
+
+    while (offset < pending) {
+
+        const size_t start = (buffer->tail + offset) & (buffer->size - 1);
+        const size_t chunk = (buffer->flags & IOBUFF_MIRRORED) ? pending - offset : min_size(pending - offset, buffer->size - start);
+        const char *found = frame_scan(buffer->buffer + start, chunk, byte);
+
+        if (found != NULL) {
+            return offset + (size_t) (found - (buffer->buffer + start));
+        }
+
+        offset += chunk;
+    }
+
+    return FRAME_NOT_FOUND;
+}
+
+/// @brief Describe a message of the pending data.
+/// @param buffer The buffer.
+/// @param frame The view to fill.
+/// @param offset The offset of the message from the tail.
+/// @param length The length of the message.
+/// @param consumed The bytes taken by the message including the framing.
+static void frame_fill (const struct io_buffer *buffer, struct frame *frame, size_t offset, size_t length, size_t consumed) {
+
+    const size_t start = (buffer->tail + offset) & (buffer->size - 1);
+    const size_t first = (buffer->flags & IOBUFF_MIRRORED) ? length : min_size(length, buffer->size - start);
+
+    frame->span[0].iov_base = buffer->buffer + start;
+    frame->span[0].iov_len = first;
+    frame->span[1].iov_base = buffer->buffer;
+    frame->span[1].iov_len = length - first;
+    frame->count = (length == 0) ? 0 : (first < length) ? 2 : 1;
+    frame->length = length;
+    frame->consumed = consumed;
+}
+
+/// @brief Grow a full buffer so that the incomplete message can be received.
+/// @param buffer The buffer.
+/// @param needed The total number of bytes the message needs, 0 if unknown.
+/// @return 0 if the buffer can receive more data, -1 on failure.
+static int frame_reserve (struct io_buffer *buffer, size_t needed) {
+
+    const size_t pending = buffer->head - buffer->tail;
+
+    // Without a known length the capacity is doubled.
+    const size_t missing = (needed > pending) ? needed - pending : (pending > 0) ? pending : 1;
+
+    if (buffer->buffer != NULL && buffer->size - pending >= missing) {
+        return 0;
+    }
+
+    if (iobuff_reserve(buffer, missing) == 0) {
+        return 0;
+    }
+
+    // A pinned buffer is grown by its owner, e.g. the io_uring engine appends beyond the current size.
+    return (errno == EBUSY) ? 0 : -1;
+}
+
+// --- Static Function Definitions, framing modes --- //
+
+/// @brief Get the next message of a length-prefixed stream.
+static int next_length (struct framer *framer, struct io_buffer *buffer, struct frame *frame, size_t pending) {
+
+    if (pending < framer->prefix) {
+        return (frame_reserve(buffer, framer->prefix) < 0) ? -1 : 0;
+    }
+
+    uint64_t length = 0;
+
+    for (unsigned int i = 0; i < framer->prefix; i++) {
+        length = (length << 8) | ring_byte(buffer, i);
+    }
+
+    if ((framer->max_length > 0 && length > framer->max_length) || length > SIZE_MAX - framer->prefix) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    if (pending - framer->prefix < length) {
+        return (frame_reserve(buffer, framer->prefix + (size_t) length) < 0) ? -1 : 0;
+    }
+
+    frame_fill(buffer, frame, framer->prefix, (size_t) length, framer->prefix + (size_t) length);
+
+    return 1;
+}
+
+/// @brief Get the next message of a delimited stream.
+static int next_delimited (struct framer *framer, struct io_buffer *buffer, struct frame *frame, size_t pending) {
+
+    for (;;) {
+
+        const size_t found = ring_find(buffer, framer->scanned, pending, framer->delimiter);
+
+        if (found == FRAME_NOT_FOUND) {
+
+            framer->scanned = pending;
+
+            // The message may still end with a CR before the delimiter, which is not part of it.
+            if (framer->max_length > 0 && pending > framer->max_length + 1) {
+                errno = EMSGSIZE;
+                return -1;
+            }
+
+            return (frame_reserve(buffer, 0) < 0) ? -1 : 0;
+        }
+
+        size_t length = found;
+
+        if (framer->mode != FRAME_DELIMITER && found > 0 && ring_byte(buffer, found - 1) == '\r') {
+            length--;
+        }
+        else if (framer->mode == FRAME_CRLF) {
+            // A lone LF is part of the message, the search continues after it.
+            framer->scanned = found + 1;
+            continue;
+        }
+
+        if (framer->max_length > 0 && length > framer->max_length) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+
+        // The message is found again without a search until it is consumed.
+        framer->scanned = found;
+        frame_fill(buffer, frame, 0, length, found + 1);
+
+        return 1;
+    }
+}
+
+// --- Function Definitions --- //
+
+int frame_init (struct framer *framer, enum frame_mode mode, unsigned int param, size_t max_length) {
+
+    assert(framer);
+
+    if (mode == FRAME_LENGTH && param != 1 && param != 2 && param != 4 && param != 8) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(framer, 0, sizeof(*framer));
+
+    framer->mode = mode;
+    framer->delimiter = (mode == FRAME_DELIMITER) ? (unsigned char) param : '\n';
+    framer->prefix = (mode == FRAME_LENGTH) ? param : 0;
+    framer->max_length = max_length;
+
+    return 0;
+}
+
+int frame_next (struct framer *framer, struct io_buffer *buffer, struct frame *frame) {
+
+    assert(framer && buffer && frame);
+
+    const size_t pending = buffer->head - buffer->tail;
+
+    // The scanned bytes are relative to the tail, they are scanned again if the data moved or was consumed elsewhere.
+    if (buffer->tail != framer->tail || framer->scanned > pending) {
+        framer->tail = buffer->tail;
+        framer->scanned = 0;
+    }
+
+    // A detached buffer holds no data, e.g. with AS_OPT_LAZY_BUFFERS.
+    if (buffer->buffer == NULL) {
+        return 0;
+    }
+
+    return (framer->mode == FRAME_LENGTH) ? next_length(framer, buffer, frame, pending) : next_delimited(framer, buffer, frame, pending);
+}
+
+void frame_consume (struct framer *framer, struct io_buffer *buffer, const struct frame *frame) {
+
+    assert(framer && buffer && frame);
+    assert(frame->consumed <= buffer->head - buffer->tail);
+
+    buffer->tail += frame->consumed;
+
+    framer->scanned = (framer->scanned > frame->consumed) ? framer->scanned - frame->consumed : 0;
+    framer->tail = buffer->tail;
+}
+
+size_t frame_copy (const struct frame *frame, void *destination, size_t size) {
+
+    assert(frame && (destination || size == 0));
+
+    size_t copied = 0;
+
+    for (int i = 0; i < frame->count && copied < size; i++) {
+
+        const size_t chunk = min_size(frame->span[i].iov_len, size - copied);
+
+        memcpy((char *) destination + copied, frame->span[i].iov_base, chunk);
+        copied += chunk;
+    }
+
+    return copied;
+}
+
+const char *frame_scan (const char *data, size_t length, unsigned char byte) {
+
+#if defined(FRAME_SCAN_X86)
+    return (length >= sizeof(__m256i) && __builtin_cpu_supports("avx2")) ? scan_avx2(data, length, byte) : scan_sse2(data, length, byte);
+#elif defined(FRAME_SCAN_NEON)
+    return scan_neon(data, length, byte);
+#else
+    return scan_scalar(data, length, byte);
+#endif // FRAME_SCAN_X86
+}
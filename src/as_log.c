@@ -0,0 +1,446 @@
+// ==============================================================================
+//                     Logging Backend, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides the asynchronous backend of the logging
+// macros. Every thread formats its messages into its own lock-free ring of
+// fixed-size records, the rings are drained in batches by log_flush(), called
+// by a background thread or by the event loop while it is idle, so a message
+// costs the formatting and no system call on the logging thread. Messages are
+// dropped instead of blocking once a ring is full. Each call site is rate
+// limited, floods of the same error are reduced to a summary line.
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // For the thread-safe description of errno, e.g. strerror_r(3).
+#endif // _GNU_SOURCE
+
+#include <stdio.h>      // For formatting the messages, e.g. vsnprintf(3).
+#include <stdlib.h>     // For memory allocation operations, e.g. calloc(3), free(3).
+#include <stdarg.h>     // For the variable arguments of the messages.
+#include <stdbool.h>    // For boolean data type.
+#include <string.h>     // For the description of errno, e.g. strerror_r(3).
+#include <errno.h>      // For the errno of the logged errors.
+#include <time.h>       // For the time of the records, e.g. clock_gettime(2).
+#include <unistd.h>     // For writing the records, e.g. write(2).
+#include <pthread.h>    // For the background thread, e.g. pthread_create(3).
+
+#include "as_log.h"
+
+// --- Constants and Macros --- //
+
+#define LOG_FLUSH_BUFFER    65536U  // Size of the buffer the records are formatted into by log_flush().
+#define LOG_LINE_MAX        512U    // Maximum length of a formatted record, including the prefix and errno.
+
+// --- Type Definitions --- //
+
+/// @brief Fixed-size record of a logged message.
+struct log_record {
+    uint64_t        time;                   // Time of the message in nanoseconds since the epoch.
+    int             level;                  // Level of the message, e.g. LOG_LEVEL_ERROR.
+    int             error;                  // The errno of an error message, 0 for informational ones.
+    unsigned int    suppressed;             // Messages of the call site suppressed before this one.
+    char            text[LOG_TEXT_SIZE];    // The formatted message.
+};
+
+/// @brief Single-producer single-consumer ring of a logging thread.
+struct log_ring {
+    struct log_ring     *next;                      // Next ring of the registry.
+    atomic_size_t       head;                       // Next record to fill, advanced by the owning thread.
+    atomic_size_t       tail;                       // Next record to write, advanced by log_flush().
+    atomic_size_t       dropped;                    // Records dropped because the ring was full.
+    size_t              reported;                   // Dropped records already reported by log_flush().
+    struct log_record   records[LOG_RING_RECORDS];  // The records.
+};
+
+/// @brief State of the asynchronous backend.
+struct logger {
+    _Atomic(struct log_ring *)  rings;      // Registry of the rings of all threads.
+    atomic_bool                 enabled;    // Whether the messages go to the rings.
+    atomic_uint                 generation; // Incremented by log_close(), the rings of older generations are gone.
+    atomic_flag                 flushing;   // Held by the thread inside log_flush().
+    atomic_bool                 stopping;   // Tells the background thread to exit.
+    bool                        running;    // Whether the background thread runs.
+    pthread_t                   thread;     // The background thread.
+    unsigned int                interval;   // Period of the background thread in milliseconds.
+    int                         fd;         // The descriptor the records are written to.
+};
+
+// --- Static Variables --- //
+
+static struct logger logger = { .flushing = ATOMIC_FLAG_INIT };
+
+static _Thread_local struct log_ring *local_ring = NULL;   // The ring of the calling thread.
+static _Thread_local unsigned int local_generation = 0;     // The generation the ring belongs to.
+
+static char flush_buffer[LOG_FLUSH_BUFFER];                 // Used by the holder of logger.flushing only.
+
+static const char *const level_names[] = {
+    [LOG_LEVEL_OFF]     = "",
+    [LOG_LEVEL_ERROR]   = "ERROR",
+    [LOG_LEVEL_INFO]    = "INFO",
+};
+
+// --- Static Function Definitions --- //
+
+/// @brief Get the current time of the realtime clock in nanoseconds.
+static inline uint64_t log_now (void) {
+
+    struct timespec now;
+
+    (void) clock_gettime(CLOCK_REALTIME, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/// @brief Apply the rate limit of the call site.
+/// @note The threads of a call site race benignly, the limit is approximate.
+/// @param site The rate limit of the call site.
+/// @param now The current time in nanoseconds.
+/// @param suppressed Set to the number of messages suppressed before this one.
+/// @return true if the message passes, false if it is suppressed.
+static bool site_pass (struct log_site *site, uint64_t now, unsigned int *suppressed) {
+
+    const uint64_t millis = now / 1000000ULL;
+
+    if (millis - atomic_load_explicit(&site->window, memory_order_relaxed) >= LOG_RATE_INTERVAL) {
+        atomic_store_explicit(&site->window, millis, memory_order_relaxed);
+        atomic_store_explicit(&site->count, 0, memory_order_relaxed);
+    }
+
+    if (atomic_fetch_add_explicit(&site->count, 1, memory_order_relaxed) >= LOG_RATE_BURST) {
+        atomic_fetch_add_explicit(&site->suppressed, 1, memory_order_relaxed);
+        return false;
+    }
+
+    *suppressed = atomic_exchange_explicit(&site->suppressed, 0, memory_order_relaxed);
+
+    return true;
+}
+
+/// @brief Get the ring of the calling thread, it is allocated and registered by the first message.
+/// @return The ring, NULL on allocation failure.
+static struct log_ring *ring_get (void) {
+
+    const unsigned int generation = atomic_load_explicit(&logger.generation, memory_order_acquire);
+
+    if (local_ring != NULL && local_generation == generation) {
+        return local_ring;
+    }
+
+    struct log_ring *ring = NULL;
+
+    if ((ring = calloc(1, sizeof(*ring))) == NULL) {
+        return NULL;
+    }
+
+    // The rings are only ever pushed while the backend is enabled, log_close() takes them all at once.
+    ring->next = atomic_load_explicit(&logger.rings, memory_order_relaxed);
+
+    while (!atomic_compare_exchange_weak_explicit(&logger.rings, &ring->next, ring, memory_order_release, memory_order_relaxed)) {}
+
+    local_ring = ring;
+    local_generation = generation;
+
+    return ring;
+}
+
+/// @brief Write the whole buffer to the descriptor, errors are ignored.
+static void write_all (int fd, const char *buffer, size_t length) {
+
+    while (length > 0) {
+
+        const ssize_t written = write(fd, buffer, length);
+
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (written <= 0) {
+            return;
+        }
+
+        buffer += written;
+        length -= (size_t) written;
+    }
+}
+
+/// @brief Length of the text written by snprintf(3), clamped to the truncated length.
+static inline size_t written_length (int written, size_t size) {
+    return (written < 0) ? 0 : ((size_t) written < size) ? (size_t) written : size - 1;
+}
+
+/// @brief Format a record as a line of text.
+/// @param record The record.
+/// @param line The destination, LOG_LINE_MAX bytes.
+/// @return The length of the line, including the newline.
+static size_t format_record (const struct log_record *record, char *line) {
+
+    char scratch[96];
+    const char *description = (record->level == LOG_LEVEL_ERROR) ? strerror_r(record->error, scratch, sizeof(scratch)) : NULL;
+
+    // The informational messages may carry their own newline, every line ends with exactly one.
+    size_t text = strnlen(record->text, LOG_TEXT_SIZE);
+
+    while (text > 0 && record->text[text - 1] == '\n') {
+        text--;
+    }
+
+    // One byte is kept for the newline.
+    const size_t size = LOG_LINE_MAX - 1;
+    size_t length = written_length(snprintf(line, size, "[%llu.%06llu] %s %.*s%s%s",
+                                            (unsigned long long) (record->time / 1000000000ULL),
+                                            (unsigned long long) (record->time % 1000000000ULL / 1000ULL),
+                                            level_names[record->level], (int) text, record->text,
+                                            (description != NULL) ? ": " : "", (description != NULL) ? description : ""), size);
+
+    if (record->suppressed > 0) {
+        length += written_length(snprintf(line + length, size - length, " (%u similar messages suppressed)", record->suppressed), size - length);
+    }
+
+    line[length++] = '\n';
+
+    return length;
+}
+
+/// @brief Write a message directly, used while the backend is not enabled.
+static void write_direct (const struct log_record *record) {
+
+    char line[LOG_LINE_MAX];
+    const size_t length = format_record(record, line);
+
+    // The informational messages go to stdout and the errors to stderr, as without the backend.
+    FILE *stream = (record->level == LOG_LEVEL_ERROR) ? stderr : stdout;
+
+    (void) fwrite(line, 1, length, stream);
+}
+
+/// @brief Format a message into the ring of the calling thread, or write it directly.
+/// @param site The rate limit of the call site.
+/// @param level The level of the message.
+/// @param error The errno of an error message.
+/// @param format The printf(3) format of the message.
+/// @param args The arguments of the format.
+static void log_emit (struct log_site *site, int level, int error, const char *format, va_list args) {
+
+    const uint64_t now = log_now();
+    unsigned int suppressed = 0;
+
+    if (!site_pass(site, now, &suppressed)) {
+        return;
+    }
+
+    struct log_ring *ring = NULL;
+    struct log_record direct;
+    struct log_record *record = &direct;
+
+    if (atomic_load_explicit(&logger.enabled, memory_order_acquire) && (ring = ring_get()) != NULL) {
+
+        const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+        // The message is dropped instead of waiting for log_flush(), the loss is reported with the next flush.
+        if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == LOG_RING_RECORDS) {
+            atomic_store_explicit(&ring->dropped, atomic_load_explicit(&ring->dropped, memory_order_relaxed) + 1, memory_order_relaxed);
+            return;
+        }
+
+        record = &ring->records[head & (LOG_RING_RECORDS - 1)];
+    }
+
+    record->time = now;
+    record->level = level;
+    record->error = error;
+    record->suppressed = suppressed;
+
+    (void) vsnprintf(record->text, sizeof(record->text), format, args);
+
+    if (ring == NULL) {
+        write_direct(record);
+        return;
+    }
+
+    // Publish the record to log_flush().
+    atomic_store_explicit(&ring->head, atomic_load_explicit(&ring->head, memory_order_relaxed) + 1, memory_order_release);
+}
+
+/// @brief Log an error message through log_emit(), the message is copied as the text of the record.
+static void log_error_args (struct log_site *site, int error, const char *format, ...) {
+
+    va_list args;
+
+    va_start(args, format);
+    log_emit(site, LOG_LEVEL_ERROR, error, format, args);
+    va_end(args);
+}
+
+/// @brief Flush the records periodically until log_close() is called.
+static void *log_thread (void *arg) {
+
+    (void) arg;
+
+    const struct timespec period = {
+        .tv_sec = logger.interval / 1000U,
+        .tv_nsec = (long) (logger.interval % 1000U) * 1000000L,
+    };
+
+    while (!atomic_load_explicit(&logger.stopping, memory_order_acquire)) {
+        (void) nanosleep(&period, NULL);
+        (void) log_flush();
+    }
+
+    return NULL;
+}
+
+// --- Function Definitions --- //
+
+int log_open (int fd) {
+
+    if (atomic_load_explicit(&logger.enabled, memory_order_acquire)) {
+        return -1;
+    }
+
+    logger.fd = fd;
+    atomic_store_explicit(&logger.enabled, true, memory_order_release);
+
+    return 0;
+}
+
+int log_start (unsigned int interval) {
+
+    if (!atomic_load_explicit(&logger.enabled, memory_order_acquire) || logger.running) {
+        return -1;
+    }
+
+    logger.interval = (interval > 0) ? interval : 1;
+    atomic_store_explicit(&logger.stopping, false, memory_order_relaxed);
+
+    if (pthread_create(&logger.thread, NULL, log_thread, NULL) != 0) {
+        return -1;
+    }
+
+    logger.running = true;
+
+    return 0;
+}
+
+size_t log_flush (void) {
+
+    // Nothing to do without the backend, e.g. when called by an idle loop.
+    if (!atomic_load_explicit(&logger.enabled, memory_order_acquire)) {
+        return 0;
+    }
+
+    if (atomic_flag_test_and_set_explicit(&logger.flushing, memory_order_acquire)) {
+        return 0;
+    }
+
+    const int saved = errno;
+    size_t used = 0;
+    size_t flushed = 0;
+
+    for (struct log_ring *ring = atomic_load_explicit(&logger.rings, memory_order_acquire); ring != NULL; ring = ring->next) {
+
+        const size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+        for (; tail != head; tail++) {
+
+            if (LOG_FLUSH_BUFFER - used < LOG_LINE_MAX) {
+                write_all(logger.fd, flush_buffer, used);
+                used = 0;
+            }
+
+            used += format_record(&ring->records[tail & (LOG_RING_RECORDS - 1)], flush_buffer + used);
+            flushed++;
+        }
+
+        // Hand the records back to the owning thread.
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+        const size_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+
+        if (dropped != ring->reported) {
+
+            if (LOG_FLUSH_BUFFER - used < LOG_LINE_MAX) {
+                write_all(logger.fd, flush_buffer, used);
+                used = 0;
+            }
+
+            used += written_length(snprintf(flush_buffer + used, LOG_LINE_MAX, "(%zu log messages dropped)\n", dropped - ring->reported), LOG_LINE_MAX);
+            ring->reported = dropped;
+        }
+    }
+
+    write_all(logger.fd, flush_buffer, used);
+
+    atomic_flag_clear_explicit(&logger.flushing, memory_order_release);
+    errno = saved;
+
+    return flushed;
+}
+
+void log_close (void) {
+
+    if (logger.running) {
+        atomic_store_explicit(&logger.stopping, true, memory_order_release);
+        (void) pthread_join(logger.thread, NULL);
+        logger.running = false;
+    }
+
+    (void) log_flush();
+
+    atomic_store_explicit(&logger.enabled, false, memory_order_release);
+
+    // The rings of the threads are released, their next message allocates a new one.
+    struct log_ring *ring = atomic_exchange_explicit(&logger.rings, NULL, memory_order_acq_rel);
+
+    atomic_fetch_add_explicit(&logger.generation, 1, memory_order_release);
+
+    while (ring != NULL) {
+        struct log_ring *next = ring->next;
+        free(ring);
+        ring = next;
+    }
+}
+
+void log_info (struct log_site *site, const char *format, ...) {
+
+    const int saved = errno;
+    va_list args;
+
+    va_start(args, format);
+    log_emit(site, LOG_LEVEL_INFO, 0, format, args);
+    va_end(args);
+
+    errno = saved;
+}
+
+void log_error (struct log_site *site, const char *message) {
+
+    const int saved = errno;
+
+    log_error_args(site, saved, "%s", message);
+
+    errno = saved;
+}
@@ -0,0 +1,234 @@
+// ==============================================================================
+//                         Metrics, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides the always-on counters and the handler
+// latency histograms of a server. The event loop is the only writer, so the
+// updates are relaxed atomic loads and stores instead of read-modify-write
+// instructions and cost about as much as a plain increment. Other threads read
+// the values without locks through a snapshot, the histograms use log-linear
+// buckets with a relative error of 25% in the style of HDR histograms.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // For the monotonic clock, e.g. CLOCK_MONOTONIC.
+#endif // _GNU_SOURCE
+
+#include <time.h>       // For the monotonic clock, e.g. clock_gettime(2).
+#include <stdio.h>      // For formatting the metrics, e.g. snprintf(3).
+#include <string.h>     // For memory operations, e.g. memset(3).
+#include <assert.h>     // For debugging, e.g. assert(3).
+
+#include "as_metrics.h"
+
+// --- Static Variables --- //
+
+/// @brief Names of the counters in the formatted metrics, by enum as_counter.
+static const char *const counter_names[AS_COUNTERS] = {
+    [AS_COUNTER_WAKEUPS]        = "wakeups",
+    [AS_COUNTER_READY]          = "ready",
+    [AS_COUNTER_ACCEPTS]        = "accepts",
+    [AS_COUNTER_DISCONNECTS]    = "disconnects",
+    [AS_COUNTER_BYTES_IN]       = "bytes_in",
+    [AS_COUNTER_BYTES_OUT]      = "bytes_out",
+    [AS_COUNTER_PARTIAL_SENDS]  = "partial_sends",
+    [AS_COUNTER_REALLOCS]       = "reallocs",
+    [AS_COUNTER_TIMERS]         = "timers",
+    [AS_COUNTER_FOREIGN_CPU]    = "foreign_cpu",
+    [AS_COUNTER_ZEROCOPY]       = "zerocopy_sends",
+    [AS_COUNTER_ZEROCOPY_COPIED] = "zerocopy_copied",
+};
+
+/// @brief Names of the handlers in the formatted metrics, by enum as_handler.
+static const char *const handler_names[AS_HANDLERS] = {
+    [AS_HANDLER_SERVER] = "server",
+    [AS_HANDLER_CLIENT] = "client",
+    [AS_HANDLER_NOTIFY] = "notify",
+    [AS_HANDLER_TIMERS] = "timers",
+    [AS_HANDLER_BATCH]  = "batch",
+};
+
+/// @brief Percentiles of the latency histograms in the formatted metrics.
+static const struct {
+    const char  *name;
+    double      quantile;
+} percentiles[] = {
+    { "p50", 0.5 },
+    { "p90", 0.9 },
+    { "p99", 0.99 },
+    { "p999", 0.999 },
+    { "max", 1.0 },
+};
+
+// --- Static Function Definitions --- //
+
+/// @brief Get the highest value counted in a histogram bucket.
+/// @param index The index of the bucket.
+/// @return The upper bound of the bucket, UINT64_MAX for the saturated last one.
+static uint64_t histogram_bound (unsigned int index) {
+    return (index + 1U < AS_HISTOGRAM_BUCKETS) ? histogram_value(index + 1U) - 1U : UINT64_MAX;
+}
+
+/// @brief Append formatted text to the destination, the length keeps counting once it is full.
+/// @param buffer The destination.
+/// @param size The size of the destination.
+/// @param length The length of the text so far.
+/// @param name The name of the line.
+/// @param value The value of the line.
+/// @return The length of the text including the new line.
+static size_t format_line (char *buffer, size_t size, size_t length, const char *name, uint64_t value) {
+
+    const size_t offset = (length < size) ? length : size;
+    const int written = snprintf(buffer + offset, size - offset, "%s %llu\n", name, (unsigned long long) value);
+
+    return length + ((written > 0) ? (size_t) written : 0);
+}
+
+// --- Function Definitions --- //
+
+void metrics_init (struct as_metrics *metrics, bool timing) {
+
+    assert(metrics);
+
+    for (size_t i = 0; i < AS_COUNTERS; i++) {
+        atomic_init(&metrics->counters[i], 0);
+    }
+
+    for (size_t h = 0; h < AS_HANDLERS; h++) {
+        for (size_t i = 0; i < AS_HISTOGRAM_BUCKETS; i++) {
+            atomic_init(&metrics->latency[h][i], 0);
+        }
+    }
+
+    metrics->timing = timing;
+}
+
+void metrics_snapshot (const struct as_metrics *metrics, struct as_metrics_snapshot *snapshot) {
+
+    assert(metrics && snapshot);
+
+    for (size_t i = 0; i < AS_COUNTERS; i++) {
+        snapshot->counters[i] = atomic_load_explicit(&metrics->counters[i], memory_order_relaxed);
+    }
+
+    for (size_t h = 0; h < AS_HANDLERS; h++) {
+        for (size_t i = 0; i < AS_HISTOGRAM_BUCKETS; i++) {
+            snapshot->latency[h][i] = atomic_load_explicit(&metrics->latency[h][i], memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t metrics_now (void) {
+
+    struct timespec now;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+uint64_t histogram_value (unsigned int index) {
+
+    assert(index < AS_HISTOGRAM_BUCKETS);
+
+    if (index < AS_HISTOGRAM_SUB) {
+        return index;
+    }
+
+    // Inverse of histogram_index(), the leading one followed by the sub-bucket bits.
+    const unsigned int exponent = (index >> AS_HISTOGRAM_SUB_BITS) + AS_HISTOGRAM_SUB_BITS - 1U;
+    const uint64_t mantissa = AS_HISTOGRAM_SUB | (index & (AS_HISTOGRAM_SUB - 1U));
+
+    return mantissa << (exponent - AS_HISTOGRAM_SUB_BITS);
+}
+
+uint64_t histogram_percentile (const uint64_t *buckets, double quantile) {
+
+    assert(buckets);
+
+    uint64_t total = 0;
+
+    for (unsigned int i = 0; i < AS_HISTOGRAM_BUCKETS; i++) {
+        total += buckets[i];
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    // The rank of the value, the first one for quantiles of 0 and the last one for quantiles of 1.
+    uint64_t rank = (uint64_t) (quantile * (double) total + 0.5);
+
+    rank = (rank < 1) ? 1 : (rank > total) ? total : rank;
+
+    uint64_t seen = 0;
+
+    for (unsigned int i = 0; i < AS_HISTOGRAM_BUCKETS; i++) {
+
+        seen += buckets[i];
+
+        if (seen >= rank) {
+            return histogram_bound(i);
+        }
+    }
+
+    return histogram_bound(AS_HISTOGRAM_BUCKETS - 1U);
+}
+
+size_t metrics_format (const struct as_metrics_snapshot *snapshot, char *buffer, size_t size) {
+
+    assert(snapshot && (buffer || size == 0));
+
+    size_t length = 0;
+    char name[64];
+
+    for (size_t i = 0; i < AS_COUNTERS; i++) {
+        length = format_line(buffer, size, length, counter_names[i], snapshot->counters[i]);
+    }
+
+    // Histograms that recorded nothing are left out, e.g. if the run times are not recorded.
+    for (size_t h = 0; h < AS_HANDLERS; h++) {
+
+        uint64_t count = 0;
+
+        for (size_t i = 0; i < AS_HISTOGRAM_BUCKETS; i++) {
+            count += snapshot->latency[h][i];
+        }
+
+        if (count == 0) {
+            continue;
+        }
+
+        (void) snprintf(name, sizeof(name), "latency_%s_count", handler_names[h]);
+        length = format_line(buffer, size, length, name, count);
+
+        for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); p++) {
+            (void) snprintf(name, sizeof(name), "latency_%s_%s_ns", handler_names[h], percentiles[p].name);
+            length = format_line(buffer, size, length, name, histogram_percentile(snapshot->latency[h], percentiles[p].quantile));
+        }
+    }
+
+    return length;
+}
@@ -0,0 +1,262 @@
+// ==============================================================================
+//                      Multi-reactor, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides a multi-reactor mode for the asynchronous
+// TCP server. Each reactor is a thread pinned to a core that owns a complete
+// server context, i.e. its listener, pollfds and client contexts, and drives it
+// with its own event loop. The listeners bind the same address with SO_REUSEPORT
+// so that the kernel load-balances the incoming connections between the loops.
+// No state is shared between the loops, the handlers remain lock-free as long as
+// they only touch the server context they were called for.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // For Linux specific interfaces, e.g. pthread_setaffinity_np(3).
+#endif // _GNU_SOURCE
+
+#include "as_reactor.h"
+
+#include <sched.h>          // For the CPU affinity masks, e.g. sched_getaffinity(2).
+
+// --- Static Function Definitions --- //
+
+/// @brief Select the core of the loop among the cores available to the process.
+/// @param index The index of the loop.
+/// @return The core identifier, -1 if the affinity cannot be determined.
+static int reactor_cpu (size_t index) {
+
+#ifdef __linux__
+
+    cpu_set_t available;
+
+    CPU_ZERO(&available);
+
+    if (sched_getaffinity(0, sizeof(available), &available) < 0 || CPU_COUNT(&available) == 0) {
+        return -1;
+    }
+
+    // Distribute the loops round-robin over the available cores.
+    size_t nth = index % (size_t) CPU_COUNT(&available);
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+
+        if (CPU_ISSET(cpu, &available) && nth-- == 0) {
+            return cpu;
+        }
+    }
+
+#else
+
+    (void) index;
+
+#endif // __linux__
+
+    return -1;
+}
+
+/// @brief Number of cores available to the process.
+static size_t reactor_cores (void) {
+
+#ifdef __linux__
+
+    cpu_set_t available;
+
+    CPU_ZERO(&available);
+
+    if (sched_getaffinity(0, sizeof(available), &available) == 0 && CPU_COUNT(&available) > 0) {
+        return (size_t) CPU_COUNT(&available);
+    }
+
+#endif // __linux__
+
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (online > 0) ? (size_t) online : 1U;
+}
+
+/// @brief Publish the startup status of the loop.
+static void reactor_ready (struct reactor_loop *loop, int status) {
+
+    struct as_reactor *reactor = loop->reactor;
+
+    pthread_mutex_lock(&reactor->lock);
+
+    loop->status = status;
+    reactor->started++;
+
+    pthread_cond_broadcast(&reactor->ready);
+    pthread_mutex_unlock(&reactor->lock);
+}
+
+/// @brief Thread routine of a loop, owns the server context for its whole lifetime.
+static void *reactor_main (void *arg) {
+
+    struct reactor_loop *loop = (struct reactor_loop *) arg;
+    struct as_reactor *reactor = loop->reactor;
+    struct server_context *server = &loop->server;
+
+#ifdef __linux__
+    // Pin the thread, so that the loop, its sockets and its memory stay on the same core.
+    if (loop->cpu >= 0) {
+
+        cpu_set_t cpus;
+
+        CPU_ZERO(&cpus);
+        CPU_SET(loop->cpu, &cpus);
+
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            LOG_ERROR("Error pinning reactor thread");
+            loop->cpu = -1;
+        }
+    }
+#endif // __linux__
+
+    if (reactor->init != NULL) {
+        reactor->init(server, loop->index, reactor->data);
+    }
+
+    // Every loop binds its own listener to the shared address, from its pinned thread for SO_INCOMING_CPU.
+    server->options |= AS_OPT_REUSEPORT;
+
+    if (as_bind_config(server, reactor->ipv4, reactor->handler, &server->config) < 0) {
+        LOG_ERROR("Error binding reactor server");
+        reactor_ready(loop, -1);
+        return NULL;
+    }
+
+    reactor_ready(loop, 1);
+
+    while (atomic_load_explicit(&reactor->running, memory_order_relaxed)) {
+        (void) as_poll(server, reactor->data);
+    }
+
+    // The stop request may still be notifying the loop, its wakeup descriptor is closed by as_cleanup().
+    pthread_mutex_lock(&reactor->lock);
+    pthread_mutex_unlock(&reactor->lock);
+
+    as_cleanup(server);
+
+    return NULL;
+}
+
+// --- Function Definitions --- //
+
+/// @brief Start the event loops, each one binds its own listener to the address with SO_REUSEPORT.
+int as_reactor_start (struct as_reactor *reactor, size_t count, const char *ipv4, event_callback_t handler, reactor_init_t init, void *data) {
+
+    assert(reactor && ipv4 && handler);
+
+    memset(reactor, 0, sizeof(*reactor));
+
+    reactor->count = (count > 0) ? count : reactor_cores();
+    reactor->ipv4 = ipv4;
+    reactor->handler = handler;
+    reactor->init = init;
+    reactor->data = data;
+
+    if ((reactor->loops = calloc(reactor->count, sizeof(*reactor->loops))) == NULL) {
+        LOG_ERROR("Error allocating memory for reactor loops");
+        return -1;
+    }
+
+    pthread_mutex_init(&reactor->lock, NULL);
+    pthread_cond_init(&reactor->ready, NULL);
+
+    atomic_store(&reactor->running, true);
+
+    size_t created = 0;
+
+    for (; created < reactor->count; created++) {
+
+        struct reactor_loop *loop = &reactor->loops[created];
+
+        loop->reactor = reactor;
+        loop->index = created;
+        loop->cpu = reactor_cpu(created);
+
+        if (pthread_create(&loop->thread, NULL, reactor_main, loop) != 0) {
+            LOG_ERROR("Error creating reactor thread");
+            break;
+        }
+    }
+
+    // Wait for the startup of the created loops, either all of them are running or the reactor is stopped.
+    bool failed = created < reactor->count;
+
+    pthread_mutex_lock(&reactor->lock);
+
+    while (reactor->started < created) {
+        pthread_cond_wait(&reactor->ready, &reactor->lock);
+    }
+
+    for (size_t i = 0; i < created; i++) {
+        failed = failed || (reactor->loops[i].status < 0);
+    }
+
+    pthread_mutex_unlock(&reactor->lock);
+
+    if (failed) {
+        reactor->count = created;
+        as_reactor_stop(reactor);
+        return -1;
+    }
+
+    return 0;
+}
+
+/// @brief Stop the event loops, wait for their threads and release their server contexts.
+void as_reactor_stop (struct as_reactor *reactor) {
+
+    assert(reactor);
+
+    if (reactor->loops == NULL) {
+        return;
+    }
+
+    atomic_store(&reactor->running, false);
+
+    // The loops keep the timeouts of their servers, the wakeup makes a sleeping loop notice the stop request.
+    pthread_mutex_lock(&reactor->lock);
+
+    for (size_t i = 0; i < reactor->count; i++) {
+        if (reactor->loops[i].status > 0) {
+            as_notify(&reactor->loops[i].server);
+        }
+    }
+
+    pthread_mutex_unlock(&reactor->lock);
+
+    for (size_t i = 0; i < reactor->count; i++) {
+        (void) pthread_join(reactor->loops[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&reactor->ready);
+    pthread_mutex_destroy(&reactor->lock);
+
+    free(reactor->loops);
+
+    reactor->loops = NULL;
+    reactor->count = 0;
+}
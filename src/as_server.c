@@ -30,32 +30,61 @@
 // SOFTWARE.
 // ==============================================================================
 
-#include "as_server.h"
-
-// --- Static function definitions --- //
-
-/// @brief Hash function for the client file descriptor.
-/// @note Since the client file descriptor is unique, the hash value is the key itself.
-/// @param key (int *) The client file descriptor.
-/// @return The hash value for the key.
-static unsigned long client_hash (const void *key) {
-    // Typecast the key to an integer value.
-    const int value = *((int *) key);
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // For Linux specific interfaces, e.g. memfd_create(2).
+#endif // _GNU_SOURCE
 
-    return (unsigned long)(value - 4U);
-}
+#include "as_server.h"
 
-/// @brief Comparison function for the client file descriptor.
-/// @param key1 (int *) The first client file descriptor.
-/// @param key2 (int *) The second client file descriptor.
-/// @return The difference between the two keys.
-static int client_compare (const void *key1, const void *key2) {
-    // Typecast the keys to integer values.
-    const int valueA = *((int *) key1);
-    const int valueB = *((int *) key2);
+#include <limits.h>         // For the INT_MAX and UINT_MAX limits of the configuration.
+#include <sys/mman.h>       // For the mirrored buffer storage, e.g. mmap(2).
+
+#include <netinet/tcp.h>    // For corking the client sockets, e.g. TCP_CORK.
+
+#ifdef __linux__
+#include <sys/eventfd.h>    // For the wakeup descriptor of the loop, e.g. eventfd(2).
+#include <sys/sendfile.h>   // For transmitting files without copying, e.g. sendfile(2).
+#include <fcntl.h>          // For transmitting pipes without copying, e.g. splice(2).
+#include <linux/errqueue.h> // For the zero-copy completions of the error queue, e.g. struct sock_extended_err.
+#endif // __linux__
+
+// Zero-copy sends need SO_ZEROCOPY (Linux 4.14) and the completions of the socket error queue.
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define AS_ZEROCOPY_SUPPORTED
+#endif // __linux__ && SO_ZEROCOPY && MSG_ZEROCOPY
+
+// --- External Definitions, inline functions --- //
+
+// The inline functions of the header are emitted here for the calls the compiler does not inline.
+extern inline unsigned int polled_fds (const struct pollfds *pollfds);
+extern inline unsigned int total_fds (const struct pollfds *pollfds);
+extern inline int is_polled (const struct pollfds *pollfds, int fd);
+extern inline void *event_data (const struct pollfds *pollfds, int fd);
+extern inline void set_timeout (struct pollfds *pollfds, int timeout);
+extern inline void set_poll_growth (struct pollfds *pollfds, unsigned int limit, unsigned int growth);
+extern inline int poll_events (struct pollfds *pollfds);
+extern inline const struct poll_event *ready_event (const struct pollfds *pollfds, size_t idx);
+extern inline int check_flag (const struct pollfds *pollfds, size_t idx, short flag);
+extern inline int iobuff_empty (const struct io_buffer *buffer);
+extern inline int iobuff_full (const struct io_buffer *buffer);
+extern inline int iobuff_space (const struct io_buffer *buffer);
+extern inline int iobuff_data_iov (const struct io_buffer *buffer, struct iovec iov[2]);
+extern inline char *iobuff_headptr (const struct io_buffer *buffer);
+extern inline char *iobuff_tailptr (const struct io_buffer *buffer);
+extern inline struct client_context *as_get_client (const struct server_context *server, int fd);
+
+// --- Type Definitions --- //
+
+/// @brief Message posted to the loop by another thread.
+struct post_msg {
+    uint64_t        id;         // The connection identifier of the client, for data posted with as_post().
+    post_callback_t callback;   // The function to call, for callbacks posted with as_post_task().
+    void            *arg;       // User argument of the function.
+    size_t          length;     // Length of the data.
+    char            data[];     // The copied data.
+};
 
-    return !(valueA - valueB);
-}
+// --- Static function definitions --- //
 
 /// @brief Round up the size to the next power of two.
 /// @param size The size to round up.
@@ -86,542 +115,3263 @@ static inline size_t min (size_t a, size_t b) {
     return (a < b) ? a : b;
 }
 
-/// @brief Align the pointer to the specified alignment to avoid misalignment issues.
-/// @param ptr The pointer to align.
-/// @param bytes The number of bytes to skip (if any).
-/// @param alignment The alignment value, i.e. _Alignof() value.
-/// @return The aligned pointer.
-static void *align_ptr (void *ptr, size_t bytes, size_t alignment) {
+/// @brief Memory layout of a client context allocated by client_alloc().
+struct client_chunk {
+    struct client_context   context;        // The client context.
+    struct client_info      info;           // The client information.
+    struct io_buffer        buffers[2];     // The input and output buffer headers.
+    char                    storage[];      // The ring storage of both buffers, config.buffer_size each, none if pooled.
+};
 
-    char *ptr_char = (char *) ptr;
+/// @brief Size class of the storage size in the buffer pool.
+/// @param pool The buffer pool.
+/// @param size The size of the storage, a power of two.
+/// @return The index of the size class, BUFFER_POOL_CLASSES if the size is not pooled.
+static inline unsigned int pool_class (const struct buffer_pool *pool, size_t size) {
 
-    // Calculate the raw address of the pointer and the misalignment.
-    uintptr_t raw_address = (uintptr_t) (ptr_char + bytes);
-    uintptr_t misalignment = raw_address & (alignment - 1);
+    unsigned int class = 0;
 
-    // Adjust the pointer to the next aligned address.
-    if (misalignment != 0) {
-        size_t padding = alignment - misalignment;
-        raw_address += padding;
+    while (class < BUFFER_POOL_CLASSES && (pool->base << class) != size) {
+        class++;
     }
 
-    return (void *) raw_address;
+    return class;
 }
 
-/// @brief Allocate memory for the client context and associated structures.
-/// @note This function allocates fixed-size memory for the buffers defined by the BUFFER_SIZE macro.
-/// @param client The client context to allocate memory for.
-/// @return Pointer to the allocated client context.
-static struct client_context *client_alloc (void) {
-
-    // Allocate memory for the client context in a single memory chunk.
-    const size_t mem_size = sizeof(struct client_context) + sizeof(struct client_info) + sizeof(struct io_buffer) * 2;
-    void* mem_chunk = NULL;
+/// @brief Take storage of the given size from the pool, allocate it if the size class is empty.
+/// @param pool The buffer pool.
+/// @param size The size of the storage, a power of two.
+/// @return Pointer to the storage, NULL on failure.
+static void *pool_take (struct buffer_pool *pool, size_t size) {
 
-    if ((mem_chunk = calloc(mem_size, 1U)) == NULL) {
-        LOG_ERROR("Error allocating memory for client context");
-        return NULL;
-    }
+    const unsigned int class = pool_class(pool, size);
 
-    // Partition the memory chunk into the client context and associated structures.
-    struct client_context *client = (struct client_context *) mem_chunk;
-    mem_chunk = align_ptr(mem_chunk, sizeof(struct client_context), _Alignof(struct client_context));
+    if (class < BUFFER_POOL_CLASSES && pool->free[class] != NULL) {
 
-    client->info = (struct client_info *) mem_chunk;
-    mem_chunk = align_ptr(mem_chunk, sizeof(struct client_info), _Alignof(struct client_info));
+        void *storage = pool->free[class];
 
-    client->input = (struct io_buffer *) mem_chunk;
-    mem_chunk = align_ptr(mem_chunk, sizeof(struct io_buffer), _Alignof(struct io_buffer));
+        pool->free[class] = *(void **) storage;
+        pool->count[class]--;
 
-    client->output = (struct io_buffer *) mem_chunk;
+        return storage;
+    }
 
-    return client;
+    return malloc(size);
 }
 
-// --- Function definitions, pollfd wrapper --- //
-
-/// @brief Create a pollfd array of the specified size.
-struct pollfds *create_pollfds (size_t max_descs) {
-
-    assert(max_descs > 0);
+/// @brief Return the storage to the pool, free it if its size class is full or not pooled.
+/// @param pool The buffer pool.
+/// @param storage The storage taken by pool_take().
+/// @param size The size of the storage.
+static void pool_give (struct buffer_pool *pool, void *storage, size_t size) {
 
-    // Allocate memory for the pollfds struct.
-    struct pollfds *pollfds = malloc(sizeof(*pollfds));
+    const unsigned int class = pool_class(pool, size);
 
-    if (pollfds == NULL) {
-        LOG_ERROR("Error creating pollfds struct: memory allocation failed");
-        return NULL;
+    if (class >= BUFFER_POOL_CLASSES || (pool->count[class] + 1) * size > BUFFER_POOL_LIMIT) {
+        free(storage);
+        return;
     }
 
-    // Allocate memory for the pollfd array.
-    pollfds->fds = calloc(max_descs, sizeof(*pollfds->fds));
+    *(void **) storage = pool->free[class];
+    pool->free[class] = storage;
+    pool->count[class]++;
+}
 
-    if (pollfds->fds == NULL) {
-        LOG_ERROR("Error creating pollfd array: memory allocation failed");
-        free(pollfds);
-        return NULL;
-    }
+/// @brief Free the storage cached in the pool.
+/// @param pool The buffer pool.
+static void pool_destroy (struct buffer_pool *pool) {
 
-    // Initialize the pollfd array with invalid file descriptors.
-    for (unsigned int idx = 0; idx < max_descs; idx++) {
-        pollfds->fds[idx].fd = -1;
-    }
+    for (unsigned int class = 0; class < BUFFER_POOL_CLASSES; class++) {
 
-    // Initialize the remaining fields of the pollfds struct.
-    pollfds->polled = 0;
-    pollfds->length = max_descs;
-    pollfds->timeout = -1; // Default to blocking mode, no timeout.
+        while (pool->free[class] != NULL) {
+            void *next = *(void **) pool->free[class];
+            free(pool->free[class]);
+            pool->free[class] = next;
+        }
 
-    return pollfds;
+        pool->count[class] = 0;
+    }
 }
 
-/// @brief Destroy the pollfd array.
-void destroy_pollfds (struct pollfds *pollfds) {
+/// @brief Unmap the storage of a mirrored buffer.
+/// @param storage Pointer to the first mapping.
+/// @param size Size of the storage.
+static void mirror_unmap (char *storage, size_t size) {
+    (void) munmap(storage, size * 2);
+}
 
-    assert(pollfds);
+/// @brief Release the separately allocated storage of the buffer, the inline and mirrored storage is kept.
+/// @param buffer The buffer.
+static void storage_release (struct io_buffer *buffer) {
 
-    if (pollfds->fds != NULL) {
-        free(pollfds->fds);
+    if (buffer->flags & IOBUFF_POOLED) {
+        pool_give(buffer->pool, buffer->buffer, buffer->size);
+    }
+    else if (buffer->flags & IOBUFF_OWNED) {
+        free(buffer->buffer);
     }
 
-    free(pollfds);
+    buffer->flags &= ~(IOBUFF_POOLED | IOBUFF_OWNED);
 }
 
-/// @brief Add (or update) a file descriptor event.
-int add_event (struct pollfds *pollfds, int fd, short events) {
-
-    assert(pollfds && pollfds->fds && fd >= 0);
+/// @brief Keep the storage of a pinned buffer alive, the buffer is moving to a new one.
+/// @note The inline storage of a client context lives as long as the context, it is not tracked.
+/// @param buffer The pinned buffer.
+/// @return 0 on success, -1 on allocation failure.
+static int storage_retire (struct io_buffer *buffer) {
 
-    if (pollfds->polled == pollfds->length) {
-        LOG_ERROR("Error adding pollfd event: buffer overflow");
-        return -1;
+    if (!(buffer->flags & (IOBUFF_POOLED | IOBUFF_OWNED | IOBUFF_MIRRORED))) {
+        return 0;
     }
 
-    // Check whether the file descriptor is already being polled.
-    unsigned int desc_idx = 0;
-
-    for (; desc_idx < pollfds->polled; desc_idx++) {
-        if (pollfds->fds[desc_idx].fd == fd) {
+    struct io_retired *retired = NULL;
 
-            // Update the events being monitored.
-            pollfds->fds[desc_idx].events = events;
-            pollfds->fds[desc_idx].revents = 0;
-            
-            return 0;
-        }
+    if ((retired = malloc(sizeof(*retired))) == NULL) {
+        return -1;
     }
 
-    struct pollfd new_fd = {
-        .fd = fd,
-        .events = events,
-        .revents = 0
-    };
+    retired->next = buffer->retired;
+    retired->storage = buffer->buffer;
+    retired->size = buffer->size;
+    retired->flags = buffer->flags & (IOBUFF_POOLED | IOBUFF_OWNED | IOBUFF_MIRRORED);
 
-    // Add the file descriptor and events to the pollfd array.
-    pollfds->fds[pollfds->polled++] = new_fd;
+    buffer->retired = retired;
+    buffer->flags &= ~(IOBUFF_POOLED | IOBUFF_OWNED);
 
     return 0;
 }
 
-/// @brief Remove a file descriptor event.
-void remove_event (struct pollfds *pollfds, int fd) {
-
-    assert(pollfds && pollfds->fds && fd >= 0);
+/// @brief Release the storage replaced while the buffer was pinned.
+/// @param buffer The buffer, no operation may reference its former storage anymore.
+static void retired_release (struct io_buffer *buffer) {
 
-    if (pollfds->polled == 0) {
-        return;
-    }
+    while (buffer->retired != NULL) {
 
-    // Find the file descriptor in the pollfd array.
-    unsigned int desc_idx = 0;
+        struct io_retired *next = buffer->retired->next;
 
-    for (; desc_idx < pollfds->polled; desc_idx++) {
-        if (pollfds->fds[desc_idx].fd == fd) {
-            break;
+        if (buffer->retired->flags & IOBUFF_MIRRORED) {
+            mirror_unmap(buffer->retired->storage, buffer->retired->size);
+        }
+        else if (buffer->retired->flags & IOBUFF_POOLED) {
+            pool_give(buffer->pool, buffer->retired->storage, buffer->retired->size);
         }
+        else {
+            free(buffer->retired->storage);
+        }
+
+        free(buffer->retired);
+        buffer->retired = next;
     }
+}
 
-    // Check if the file descriptor was found.
-    if (desc_idx == pollfds->polled) {
+/// @brief Reset the client context to its initial state, the structures and the storage are kept.
+/// @note Storage allocated by growing the buffers is released, the buffers are back to their initial size.
+/// @param server The server context the client belongs to.
+/// @param client The client context to reset.
+static void client_reset (struct server_context *server, struct client_context *client) {
+
+    struct client_info *info = client->info;
+    struct io_buffer *input = client->input;
+    struct io_buffer *output = client->output;
+    struct buffer_pool *pool = input->pool;
+    const size_t size = server->config.buffer_size;
+
+    retired_release(input);
+    retired_release(output);
+    storage_release(input);
+    storage_release(output);
+
+    memset(client, 0, sizeof(*client));
+    memset(info, 0, sizeof(*info));
+    memset(input, 0, sizeof(*input));
+    memset(output, 0, sizeof(*output));
+
+    client->info = info;
+    client->input = input;
+    client->output = output;
+
+    info->fd = INVALID_FD;
+
+    client->output_high = server->config.output_high;
+    client->output_low = server->config.output_low;
+
+    input->limit = server->config.buffer_max;
+    output->limit = server->config.buffer_max;
+    input->metrics = &server->metrics;
+    output->metrics = &server->metrics;
+
+    // Pooled buffers start detached, their storage is attached by the first data.
+    if (pool != NULL) {
+        input->pool = pool;
+        output->pool = pool;
         return;
     }
 
-    struct pollfd new_fd = {
-        .fd = -1,
-        .events = 0,
-        .revents = 0
-    };
+    // The ring storage follows the buffer headers in the same chunk.
+    input->buffer = ((struct client_chunk *) client)->storage;
+    input->size = size;
 
-    // Clear the file descriptor and events.
-    pollfds->fds[desc_idx] = new_fd;
+    output->buffer = input->buffer + size;
+    output->size = size;
+}
 
-    // Pack the pollfd array.
-    for (unsigned int idx = desc_idx; idx < pollfds->polled; idx++) {
-        if (pollfds->fds[idx].fd < 0) {
-            continue;
-        }
-        pollfds->fds[desc_idx++] = pollfds->fds[idx];
-        pollfds->fds[idx].fd = -1;
+/// @brief Allocate memory for the client context and associated structures.
+/// @note The context, the client info, both buffer headers and their initial storage share a single chunk.
+/// @param server The server context, with AS_OPT_LAZY_BUFFERS the storage is taken from its buffer pool instead.
+/// @return Pointer to the allocated client context, NULL on failure.
+static struct client_context *client_alloc (struct server_context *server) {
+
+    const bool lazy = server->options & AS_OPT_LAZY_BUFFERS;
+    struct client_chunk *chunk = NULL;
+
+    if ((chunk = malloc(sizeof(*chunk) + (lazy ? 0 : server->config.buffer_size * 2))) == NULL) {
+        LOG_ERROR("Error allocating memory for client context");
+        return NULL;
     }
 
-    pollfds->polled--;
+    // Partition the memory chunk into the client context and associated structures.
+    struct client_context *client = &chunk->context;
+
+    client->info = &chunk->info;
+    client->input = &chunk->buffers[0];
+    client->output = &chunk->buffers[1];
+
+    client->input->flags = 0;
+    client->output->flags = 0;
+    client->input->retired = NULL;
+    client->output->retired = NULL;
+    client->input->pool = lazy ? &server->buffers : NULL;
+    client->output->pool = client->input->pool;
+
+    client_reset(server, client);
+
+    return client;
 }
 
-// --- Function definitions, iobuffer wrappers --- //
+/// @brief Take a client context from the pool of the server, allocate a new one if the pool is empty.
+/// @param server The server context.
+/// @return Pointer to the client context, NULL on failure.
+static struct client_context *client_get (struct server_context *server) {
 
-/// @brief Allocate memory for the client context and associated structures.
-struct io_buffer *iobuff_alloc (size_t size) {
+    struct client_context *client = server->pool;
 
-    assert((size & (size - 1)) == 0);
-    
-    const size_t alloc_size = sizeof(struct io_buffer) + size_roundup(size * sizeof(char));
+    if (client == NULL) {
+        return client_alloc(server);
+    }
 
-    struct io_buffer *buffer = NULL;
+    server->pool = client->next;
+    server->pooled--;
 
-    if ((buffer = calloc(1U, alloc_size)) == NULL) {
-        LOG_ERROR("Error allocating memory for buffer");
-        return NULL;
+    client->next = NULL;
+
+    return client;
+}
+
+/// @brief Return the client context to the pool of the server, free it if the pool is full.
+/// @note The client socket must already be closed.
+/// @param server The server context.
+/// @param client The client context.
+static void client_put (struct server_context *server, struct client_context *client) {
+
+    client_reset(server, client);
+
+    if (server->pooled >= server->pool_size) {
+        free(client);
+        return;
     }
 
-    // char has an alignment of 1, so no need to align the buffer.
-    buffer->buffer = (char *) (buffer + 1);
-    buffer->size = size;
+    client->next = server->pool;
+    server->pool = client;
+    server->pooled++;
+}
 
-    return buffer;
+/// @brief Free the client contexts kept in the pool of the server.
+/// @param server The server context.
+static void client_pool_destroy (struct server_context *server) {
+
+    while (server->pool != NULL) {
+        struct client_context *next = server->pool->next;
+        free(server->pool);
+        server->pool = next;
+    }
+
+    server->pooled = 0;
 }
 
-/// @brief Append the new data to the buffer.
-size_t iobuff_append (struct io_buffer *buffer, const char *data, size_t length, bool can_reallocate) {
+// --- Static function definitions, pollfd wrapper --- //
 
-    assert(buffer && data);
+/// @brief Get the index of the file descriptor in the pollfd array.
+/// @param pollfds The pollfds struct.
+/// @param fd The file descriptor.
+/// @return The index of the file descriptor, -1 if it is not being polled.
+static inline int slot_of (const struct pollfds *pollfds, int fd) {
+    return ((size_t) fd < pollfds->nslots) ? pollfds->slots[fd].index : -1;
+}
+
+/// @brief Make sure the descriptor index can hold the file descriptor.
+/// @note Descriptors are small dense integers, the index grows geometrically up to the highest one.
+/// @param pollfds The pollfds struct.
+/// @param fd The file descriptor.
+/// @return 0 on success, -1 on failure.
+static int reserve_slots (struct pollfds *pollfds, int fd) {
 
-    // If the length is zero or the buffer is full, return early.
-    if (length == 0 || iobuff_full(buffer)) {
+    if ((size_t) fd < pollfds->nslots) {
         return 0;
     }
 
-    size_t free_space = iobuff_space(buffer);
+    size_t nslots = (pollfds->nslots > 0) ? pollfds->nslots : pollfds->length;
 
-    // Reallocate the buffer if there is insufficient space.
-    if (free_space < length) {
+    while (nslots <= (size_t) fd) {
+        nslots *= 2;
+    }
 
-        if (can_reallocate) {
-            size_t new_size = buffer->size + length;
+    struct poll_slot *slots = NULL;
 
-            // Calculate the next power of two for the new buffer size.
-            new_size = size_roundup(new_size);
+    if ((slots = realloc(pollfds->slots, nslots * sizeof(*slots))) == NULL) {
+        return -1;
+    }
 
-            char *new_buffer = NULL;
+    for (size_t idx = pollfds->nslots; idx < nslots; idx++) {
+        slots[idx].index = -1;
+        slots[idx].data = NULL;
+    }
 
-            if ((new_buffer = realloc(buffer->buffer, new_size)) == NULL) {
-                LOG_ERROR("Error reallocating buffer");
-                return 0;
-            }
+    pollfds->slots = slots;
+    pollfds->nslots = nslots;
+
+    return 0;
+}
 
-            buffer->buffer = new_buffer;
-            buffer->size = new_size;
+/// @brief Grow the pollfd array and the ready set according to the growth policy.
+/// @note Entries of the ready set are copied, the set of the current iteration stays valid.
+/// @param pollfds The pollfds struct, all entries in use.
+/// @return 0 on success, -1 if the limit is reached or on allocation failure.
+static int grow_pollfds (struct pollfds *pollfds) {
 
-            // Update the free space after reallocation.
-            free_space = buffer->size - (buffer->head - buffer->tail);
-        }
+    if (pollfds->length >= pollfds->limit) {
+        return -1;
     }
 
-    // Wrap around the buffer pointers for pointer arithmetic.
-    const size_t whead = buffer->head & (buffer->size - 1);
-    const size_t wtail = buffer->tail & (buffer->size - 1);
+    const unsigned int step = (pollfds->growth > 0) ? pollfds->growth : pollfds->length;
+    const unsigned int length = (pollfds->limit - pollfds->length > step) ? pollfds->length + step : pollfds->limit;
 
-    // In case the buffer has wrapped around, we need to copy the data in two chunks.
-    if (wtail <= whead) {
-        size_t first_chunk = min(length, buffer->size - whead);
-        size_t second_chunk = min(length - first_chunk, wtail);
-        
-        size_t total = first_chunk + second_chunk;
+    struct pollfd *fds = NULL;
+    struct poll_event *ready = NULL;
 
-        memcpy(buffer->buffer + whead, data, first_chunk);
-        memcpy(buffer->buffer, data + first_chunk, second_chunk);
+    if ((fds = realloc(pollfds->fds, length * sizeof(*fds))) == NULL) {
+        return -1;
+    }
 
-        buffer->head += total;
+    pollfds->fds = fds;
 
-        return total;
+    if ((ready = realloc(pollfds->ready, length * sizeof(*ready))) == NULL) {
+        return -1;
     }
 
-    size_t chunk = min(length, wtail - whead);
+    pollfds->ready = ready;
 
-    memcpy(buffer->buffer + whead, data, chunk);
+    if (pollfds->ops->resize(pollfds, length) < 0) {
+        return -1;
+    }
 
-    buffer->head += chunk;
+    for (unsigned int idx = pollfds->length; idx < length; idx++) {
+        pollfds->fds[idx].fd = -1;
+        pollfds->fds[idx].events = 0;
+        pollfds->fds[idx].revents = 0;
+    }
 
-    return chunk;
+    pollfds->length = length;
+
+    return 0;
 }
 
-/// @brief Free the memory allocated for the buffer.
-void iobuff_free (struct io_buffer *buffer) {
+// --- Static function definitions, poll(2) backend --- //
 
-    assert(buffer);
+/// @brief Register the file descriptor with the poll(2) backend.
+/// @note The pollfd array is passed directly to poll(2), nothing to mirror.
+static int poll_backend_add (struct pollfds *pollfds, int fd, short events, bool update) {
+    (void) pollfds;
+    (void) fd;
+    (void) events;
+    (void) update;
+    return 0;
+}
 
-    free(buffer->buffer);
-    free(buffer);
+/// @brief Unregister the file descriptor from the poll(2) backend.
+static void poll_backend_remove (struct pollfds *pollfds, int fd) {
+    (void) pollfds;
+    (void) fd;
 }
 
-/// @brief Send data to the client from the (circular) buffer.
-ssize_t iobuff_send (struct client_context *client, struct io_buffer *buffer) {
+/// @brief Wait for events with poll(2) and collect the ready descriptors.
+static int poll_backend_wait (struct pollfds *pollfds) {
 
-    assert(client && buffer);
+    int polled = poll(pollfds->fds, pollfds->polled, pollfds->timeout);
 
-    // The number of bytes to send to the client.
-    const size_t length = buffer->head - buffer->tail;
+    pollfds->nready = 0;
 
-    // If the buffer is empty, we can return early.
-    if (length == 0) {
-        return 0;
+    if (polled <= 0) {
+        return polled;
     }
 
-    // The number of bytes sent to the client.
-    ssize_t sent = 0;
+    // Collect the descriptors with pending events, stop as soon as all of them are found.
+    for (unsigned int idx = 0; idx < pollfds->polled && pollfds->nready < (unsigned int) polled; idx++) {
 
-    // Wrap around the buffer pointers for pointer arithmetic.
-    const size_t whead = buffer->head & (buffer->size - 1);
-    const size_t wtail = buffer->tail & (buffer->size - 1);
+        if (pollfds->fds[idx].revents == 0) {
+            continue;
+        }
 
-    // Since the buffer is circular, we need to wrap around the buffer size.
-    char *buffer_wrap = NULL;
+        const int fd = pollfds->fds[idx].fd;
 
-    // If the buffer has wrapped around, straighten the buffer.
-    if (buffer->tail > buffer->head) {
+        pollfds->ready[pollfds->nready].fd = fd;
+        pollfds->ready[pollfds->nready].revents = pollfds->fds[idx].revents;
+        pollfds->ready[pollfds->nready].data = pollfds->slots[fd].data;
+        pollfds->nready++;
+    }
 
-        if ((buffer_wrap = calloc(1U, buffer->size)) == NULL) {
-            LOG_ERROR("Error allocating memory for buffer wrap");
-            return -1;
-        }
+    return (int) pollfds->nready;
+}
+
+/// @brief Release the resources of the poll(2) backend.
+static void poll_backend_destroy (struct pollfds *pollfds) {
+    (void) pollfds;
+}
+
+/// @brief Resize the storage of the poll(2) backend, it uses the pollfd array itself.
+static int poll_backend_resize (struct pollfds *pollfds, unsigned int length) {
+    (void) pollfds;
+    (void) length;
+    return 0;
+}
 
-        const size_t tail_size = buffer->size - wtail;
+static const struct poll_ops poll_backend_ops = {
+    .add = poll_backend_add,
+    .remove = poll_backend_remove,
+    .wait = poll_backend_wait,
+    .destroy = poll_backend_destroy,
+    .resize = poll_backend_resize
+};
 
-        memcpy(buffer_wrap, buffer->buffer + wtail, tail_size);
-        memcpy(buffer_wrap + tail_size, buffer->buffer, whead);
+#ifdef __linux__
 
-        sent = send(client->info->fd, buffer_wrap, length, 0);
-    }
-    else {
-        sent = send(client->info->fd, buffer->buffer + wtail, length, 0);
-    }
+// --- Static function definitions, epoll(7) backend --- //
 
-    // Check if the data was sent successfully, update the tail pointer.
-    if (sent < 0) {
-        LOG_ERROR("Error sending data to client");
+/// @brief Register (or update) the file descriptor with the epoll instance.
+/// @note Linux defines the epoll(7) event bits with the same values as poll(2).
+static int epoll_backend_add (struct pollfds *pollfds, int fd, short events, bool update) {
+
+    struct epoll_event event = {
+        .events = (uint32_t) (unsigned short) events,
+        .data.fd = fd
+    };
+
+    if (epoll_ctl(pollfds->backend_fd, update ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) < 0) {
+        LOG_ERROR("Error updating epoll interest list");
         return -1;
     }
 
-    buffer->tail += sent;
+    return 0;
+}
 
-    // Free the buffer wrap if it was allocated.
-    if (buffer_wrap != NULL) {
-        free(buffer_wrap);
-    }
+/// @brief Unregister the file descriptor from the epoll instance.
+static void epoll_backend_remove (struct pollfds *pollfds, int fd) {
 
-    return sent;
+    // The descriptor might have been closed already, which removes it implicitly.
+    (void) epoll_ctl(pollfds->backend_fd, EPOLL_CTL_DEL, fd, NULL);
 }
 
-// --- Function definitions, server --- //
+/// @brief Wait for events with epoll_wait(2), the kernel returns only the ready descriptors.
+static int epoll_backend_wait (struct pollfds *pollfds) {
 
-int as_bind (struct server_context *server, const char* ipv4, event_callback_t handler) {
+    struct epoll_event *events = (struct epoll_event *) pollfds->backend_data;
 
-    assert(server && ipv4 && handler);
+    int polled = epoll_wait(pollfds->backend_fd, events, (int) pollfds->length, pollfds->timeout);
 
-    int retvalue = 0;
+    pollfds->nready = 0;
 
-    if ((server->contexts = htable_create(MAX_CLIENTS, client_hash, client_compare, NULL)) == NULL) {
-        LOG_ERROR("Error creating hash table");
-        retvalue = -1;
-        goto error;
+    if (polled <= 0) {
+        return polled;
     }
 
-    if ((server->polled = create_pollfds(MAX_CLIENTS)) == NULL) {
-        LOG_ERROR("Error creating pollfd array");
-        retvalue = -1;
-        goto error_poll;
-    }
+    for (int idx = 0; idx < polled; idx++) {
+        const int fd = events[idx].data.fd;
 
-    if (server_bind(&server->info, ipv4) < 0) {
-        retvalue = -1;
-        goto error_server;
+        pollfds->ready[idx].fd = fd;
+        pollfds->ready[idx].revents = (short) events[idx].events;
+        pollfds->ready[idx].data = pollfds->slots[fd].data;
     }
 
-    // Set the listener socket to non-blocking mode to avoid blocking on accept.
-    int get_flags = 0;
+    pollfds->nready = (unsigned int) polled;
 
-    if ((get_flags = fcntl(server->info.fd, F_GETFL, 0)) < 0) {
-        LOG_ERROR("Error getting file descriptor flags");
-        goto error_server;
-    }
+    return polled;
+}
 
-    // Update the file descriptor flags.
-    if (fcntl(server->info.fd, F_SETFL, get_flags | O_NONBLOCK) < 0) {
-        LOG_ERROR("Error setting file descriptor flags");
-        goto error_server;
-    }
+/// @brief Release the epoll instance and the event array.
+static void epoll_backend_destroy (struct pollfds *pollfds) {
 
-    // Monitor the server socket for incoming connections.
-    if (add_event(server->polled, server->info.fd, POLLIN | POLLPRI) < 0) {
-        LOG_ERROR("Error adding event to pollfds");
-        goto error_server;
+    if (pollfds->backend_fd >= 0) {
+        (void) close(pollfds->backend_fd);
+        pollfds->backend_fd = -1;
     }
 
-    // Set the event handler for the server.
-    server->event_handler = handler;
+    free(pollfds->backend_data);
+    pollfds->backend_data = NULL;
+}
 
-    return 0;
+/// @brief Resize the event array filled by epoll_wait(2).
+static int epoll_backend_resize (struct pollfds *pollfds, unsigned int length) {
 
-error_server:
-    destroy_pollfds(server->polled);
-    server->polled = NULL;
+    struct epoll_event *events = NULL;
+
+    if ((events = realloc(pollfds->backend_data, length * sizeof(*events))) == NULL) {
+        return -1;
+    }
+
+    pollfds->backend_data = events;
+
+    return 0;
+}
+
+static const struct poll_ops epoll_backend_ops = {
+    .add = epoll_backend_add,
+    .remove = epoll_backend_remove,
+    .wait = epoll_backend_wait,
+    .destroy = epoll_backend_destroy,
+    .resize = epoll_backend_resize
+};
+
+/// @brief Create the epoll instance and the event array for the pollfds struct.
+/// @return 0 on success, -1 on failure.
+static int epoll_backend_init (struct pollfds *pollfds) {
+
+    if ((pollfds->backend_data = calloc(pollfds->length, sizeof(struct epoll_event))) == NULL) {
+        LOG_ERROR("Error creating epoll event array: memory allocation failed");
+        return -1;
+    }
+
+    if ((pollfds->backend_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        LOG_ERROR("Error creating epoll instance");
+        free(pollfds->backend_data);
+        pollfds->backend_data = NULL;
+        return -1;
+    }
+
+    pollfds->backend = POLL_BACKEND_EPOLL;
+    pollfds->ops = &epoll_backend_ops;
+
+    return 0;
+}
+
+#endif // __linux__
+
+/// @brief Release an entry of the output queue.
+/// @param chunk The entry, its descriptor is closed if requested, its payload reference is dropped.
+static void chunk_free (struct output_chunk *chunk) {
+
+    if (chunk->payload != NULL) {
+        as_payload_release(chunk->payload);
+    }
+    else if (chunk->flags & AS_SENDFILE_CLOSE) {
+        (void) close(chunk->fd);
+    }
+
+    free(chunk);
+}
+
+/// @brief Close the socket of the client and return the context to the pool of the server.
+/// @param client The client context to release.
+static void client_free (struct client_context *client) {
+
+    if (client->info->fd >= 0) {
+        client_close(client->info);
+    }
+
+    // Descriptors and payloads that were not transmitted before the disconnect.
+    while (client->chunks != NULL) {
+        struct output_chunk *next = client->chunks->next;
+        chunk_free(client->chunks);
+        client->chunks = next;
+    }
+
+    client_put(client->server, client);
+}
+
+/// @brief Number of output ring bytes not handed to the socket yet.
+/// @note The bytes of zero-copy sends in flight are still in the ring, but already sent.
+/// @param client The client context.
+static inline size_t output_unsent (const struct client_context *client) {
+    return client->output->head - client->output->tail - client->zerocopy.pending;
+}
+
+/// @brief Describe the output ring bytes not handed to the socket yet.
+/// @param client The client context.
+/// @param iov The two I/O vectors to fill in.
+/// @return The number of segments holding data, i.e. 0, 1 or 2.
+static int output_iov (const struct client_context *client, struct iovec iov[2]) {
+
+    struct io_buffer unsent = *client->output;
+
+    unsent.tail += client->zerocopy.pending;
+
+    return iobuff_data_iov(&unsent, iov);
+}
+
+/// @brief Release the output ring bytes accepted by the socket.
+/// @note The ring is released in order, bytes copied behind a zero-copy send are released with it.
+/// @param client The client context.
+/// @param sent The number of bytes accepted by the socket.
+/// @param zerocopy true if the bytes were sent with MSG_ZEROCOPY.
+static void output_release (struct client_context *client, size_t sent, bool zerocopy) {
+
+    struct client_zerocopy *zc = &client->zerocopy;
+
+    // The kernel references the ring pages until the completion, the storage must not move meanwhile.
+    if (zerocopy) {
+        zc->lengths[zc->next & (AS_ZEROCOPY_SENDS - 1)] = sent;
+        zc->next++;
+        zc->pending += sent;
+        client->output->flags |= IOBUFF_PINNED;
+    }
+    else if (zc->pending > 0) {
+        zc->lengths[(zc->next - 1) & (AS_ZEROCOPY_SENDS - 1)] += sent;
+        zc->pending += sent;
+    }
+    else {
+        client->output->tail += sent;
+    }
+}
+
+/// @brief Check whether the kernel still references output ring bytes of zero-copy sends.
+/// @param client The client context.
+static inline bool zerocopy_inflight (const struct client_context *client) {
+    return client->zerocopy.acked != client->zerocopy.next;
+}
+
+/// @brief Release the output ring bytes of the zero-copy sends the kernel reported as completed.
+/// @note The completions are read from the error queue of the socket, which is reported as POLLERR.
+/// @param client The client context.
+/// @return 0 on success, -1 if the socket has an error pending as well (errno is set to it).
+static int zerocopy_complete (struct client_context *client) {
+
+#ifdef AS_ZEROCOPY_SUPPORTED
+
+    struct client_zerocopy *zc = &client->zerocopy;
+
+    for (;;) {
+
+        union {
+            char            buffer[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+            struct cmsghdr  align;
+        } control;
+
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+
+        if (recvmsg(client->info->fd, &msg, MSG_ERRQUEUE) < 0) {
+            break;
+        }
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+
+            struct sock_extended_err error;
+
+            if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                && !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+
+            memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+
+            if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY || error.ee_errno != 0) {
+                continue;
+            }
+
+            // The kernel copied the data anyway, e.g. on loopback, the pinning is only overhead then.
+            if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                metrics_add(&client->server->metrics, AS_COUNTER_ZEROCOPY_COPIED, 1);
+                client->flags &= ~CLIENT_ZEROCOPY;
+            }
+
+            // The sends ee_info up to ee_data are completed, TCP completes them in order.
+            while (zerocopy_inflight(client) && (int32_t) (error.ee_data - zc->acked) >= 0) {
+
+                const size_t length = zc->lengths[zc->acked & (AS_ZEROCOPY_SENDS - 1)];
+
+                client->output->tail += length;
+                zc->pending -= length;
+                zc->acked++;
+            }
+        }
+    }
+
+    // The storage replaced by appends meanwhile is no longer referenced either.
+    if (!zerocopy_inflight(client)) {
+        iobuff_unpin(client->output);
+    }
+
+    // The error queue raised POLLERR, the socket might have a real error pending as well.
+    int error = 0;
+    socklen_t length = sizeof(error);
+
+    if (getsockopt(client->info->fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+        errno = (error != 0) ? error : errno;
+        return -1;
+    }
+
+#else
+
+    (void) client;
+
+#endif // AS_ZEROCOPY_SUPPORTED
+
+    return 0;
+}
+
+/// @brief Check whether the client has output waiting for transmission.
+/// @param client The client context.
+/// @return true if the output buffer or the output queue holds data, false otherwise.
+static inline bool output_pending (const struct client_context *client) {
+    return client->chunks != NULL || (client->output != NULL && output_unsent(client) > 0);
+}
+
+/// @brief Events the client should be polled for.
+/// @note Connected sockets are nearly always writable, so POLLOUT is only requested while data is pending.
+/// @param client The client context.
+/// @return The events to poll for.
+static short client_interest (const struct client_context *client) {
+
+    // A paused client is not read from until its output drains, hang-ups are reported regardless.
+    short events = (client->flags & CLIENT_PAUSED) ? POLLHUP : POLLIN | POLLHUP;
+
+    if (output_pending(client)) {
+        events |= POLLOUT;
+    }
+
+    return events;
+}
+
+/// @brief Queue the client for the flush at the end of the iteration.
+/// @param client The client context.
+static void client_mark_dirty (struct client_context *client) {
+
+    if (client->flags & CLIENT_DIRTY) {
+        return;
+    }
+
+    client->flags |= CLIENT_DIRTY;
+    client->dirty = client->server->dirty;
+    client->server->dirty = client;
+}
+
+/// @brief Pause or resume the client once its output buffer crosses a watermark.
+/// @note The crossing is queued for the report at the end of the iteration, see report_watermarks().
+/// @param client The client context.
+static void client_watermark (struct client_context *client) {
+
+    // Queued payloads are not copied into the ring, but a slow reader holds on to them all the same.
+    const size_t pending = client->output->head - client->output->tail + client->queued;
+
+    if (!(client->flags & CLIENT_PAUSED)) {
+
+        if (client->output_high == 0 || pending < client->output_high) {
+            return;
+        }
+
+        client->flags |= CLIENT_PAUSED;
+    }
+    else {
+
+        // Disabling the watermarks resumes a paused client as well.
+        if (client->output_high > 0 && pending > client->output_low) {
+            return;
+        }
+
+        client->flags &= ~CLIENT_PAUSED;
+    }
+
+    if (!(client->flags & CLIENT_PAUSE_QUEUED)) {
+        client->flags |= CLIENT_PAUSE_QUEUED;
+        client->paused = client->server->paused;
+        client->server->paused = client;
+    }
+}
+
+/// @brief Set or clear the cork of the client socket, partial segments are held back while it is set.
+/// @param client The client context.
+/// @param cork true to cork the socket, false to push the pending data.
+static void client_cork (struct client_context *client, bool cork) {
+
+#ifdef TCP_CORK
+
+    const int value = cork ? 1 : 0;
+
+    if (setsockopt(client->info->fd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value)) < 0) {
+        LOG_ERROR("Error setting TCP_CORK on client socket");
+    }
+
+#else
+
+    (void) client;
+    (void) cork;
+
+#endif // TCP_CORK
+}
+
+/// @brief Release the disconnected clients that have no requests in flight anymore.
+/// @param server The server context.
+static void reap_clients (struct server_context *server) {
+
+    struct client_context **link = &server->closing;
+
+    while (*link != NULL) {
+
+        struct client_context *client = *link;
+
+        // No submission entry may have been free to queue the cancellation when the client was disconnected.
+        if (client->uring.inflight > 0 && server->uring != NULL) {
+            uring_detach(server, client);
+        }
+
+        if (client->uring.inflight > 0 || client->pending > 0 || zerocopy_inflight(client)) {
+            link = &client->next;
+            continue;
+        }
+
+        *link = client->next;
+        client_free(client);
+    }
+}
+
+/// @brief Open the wakeup descriptor of the loop, an eventfd(2) on Linux and a pipe(2) elsewhere.
+/// @param server The server context.
+/// @return 0 on success, -1 on failure.
+static int notify_open (struct server_context *server) {
+
+#ifdef __linux__
+
+    if ((server->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        return -1;
+    }
+
+    server->notify_wfd = server->notify_fd;
+
+#else
+
+    int fds[2];
+
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        (void) fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+        (void) fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    server->notify_fd = fds[0];
+    server->notify_wfd = fds[1];
+
+#endif // __linux__
+
+    atomic_init(&server->notified, false);
+    mpsc_init(&server->completions);
+
+    if ((server->posts = mpsc_ring_create(AS_POST_QUEUE)) == NULL) {
+        (void) close(server->notify_fd);
+
+        if (server->notify_wfd != server->notify_fd) {
+            (void) close(server->notify_wfd);
+        }
+
+        return -1;
+    }
+
+    return 0;
+}
+
+/// @brief Close the writable end of the wakeup descriptor, unless it is shared with the readable one, and release the post queue.
+/// @param server The server context.
+static void notify_close (struct server_context *server) {
+
+    if (server->notify_wfd >= 0 && server->notify_wfd != server->notify_fd) {
+        (void) close(server->notify_wfd);
+    }
+
+    server->notify_wfd = INVALID_FD;
+
+    // Drop the messages that were never processed.
+    if (server->posts != NULL) {
+
+        void *msg = NULL;
+
+        while ((msg = mpsc_ring_pop(server->posts)) != NULL) {
+            free(msg);
+        }
+
+        free(server->posts);
+        server->posts = NULL;
+    }
+}
+
+// --- Function definitions, pollfd wrapper --- //
+
+/// @brief Create a pollfd array of the specified size.
+struct pollfds *create_pollfds (size_t max_descs, enum poll_backend backend) {
+
+    assert(max_descs > 0);
+
+    // Allocate memory for the pollfds struct.
+    struct pollfds *pollfds = malloc(sizeof(*pollfds));
+
+    if (pollfds == NULL) {
+        LOG_ERROR("Error creating pollfds struct: memory allocation failed");
+        return NULL;
+    }
+
+    // Allocate memory for the pollfd array.
+    pollfds->fds = calloc(max_descs, sizeof(*pollfds->fds));
+
+    if (pollfds->fds == NULL) {
+        LOG_ERROR("Error creating pollfd array: memory allocation failed");
+        free(pollfds);
+        return NULL;
+    }
+
+    // Allocate memory for the ready set, at most every descriptor can be ready at once.
+    pollfds->ready = calloc(max_descs, sizeof(*pollfds->ready));
+
+    if (pollfds->ready == NULL) {
+        LOG_ERROR("Error creating ready set: memory allocation failed");
+        free(pollfds->fds);
+        free(pollfds);
+        return NULL;
+    }
+
+    // Initialize the pollfd array with invalid file descriptors.
+    for (unsigned int idx = 0; idx < max_descs; idx++) {
+        pollfds->fds[idx].fd = -1;
+    }
+
+    // The descriptor index is allocated on the first insertion.
+    pollfds->slots = NULL;
+    pollfds->nslots = 0;
+
+    // Initialize the remaining fields of the pollfds struct.
+    pollfds->polled = 0;
+    pollfds->length = max_descs;
+    pollfds->limit = max_descs;
+    pollfds->growth = 0;
+    pollfds->timeout = -1; // Default to blocking mode, no timeout.
+    pollfds->nready = 0;
+
+    // Default to the portable poll(2) backend.
+    pollfds->backend = POLL_BACKEND_POLL;
+    pollfds->ops = &poll_backend_ops;
+    pollfds->backend_fd = -1;
+    pollfds->backend_data = NULL;
+
+    // The io_uring engine reports completions itself, the pollfd array is only used for bookkeeping.
+    if (backend == POLL_BACKEND_IO_URING) {
+        pollfds->backend = POLL_BACKEND_IO_URING;
+        return pollfds;
+    }
+
+#ifdef __linux__
+    if (backend == POLL_BACKEND_AUTO || backend == POLL_BACKEND_EPOLL) {
+
+        if (epoll_backend_init(pollfds) < 0) {
+
+            // Only fail if the epoll backend was requested explicitly.
+            if (backend == POLL_BACKEND_EPOLL) {
+                destroy_pollfds(pollfds);
+                return NULL;
+            }
+        }
+    }
+#else
+    if (backend == POLL_BACKEND_EPOLL) {
+        LOG_ERROR("Error creating pollfds struct: epoll backend not supported");
+        destroy_pollfds(pollfds);
+        return NULL;
+    }
+#endif // __linux__
+
+    return pollfds;
+}
+
+/// @brief Destroy the pollfd array.
+void destroy_pollfds (struct pollfds *pollfds) {
+
+    assert(pollfds);
+
+    pollfds->ops->destroy(pollfds);
+
+    free(pollfds->slots);
+
+    if (pollfds->ready != NULL) {
+        free(pollfds->ready);
+    }
+
+    if (pollfds->fds != NULL) {
+        free(pollfds->fds);
+    }
+
+    free(pollfds);
+}
+
+/// @brief Add (or update) a file descriptor event.
+int add_event (struct pollfds *pollfds, int fd, short events) {
+
+    assert(pollfds && pollfds->fds && fd >= 0);
+
+    // Check whether the file descriptor is already being polled.
+    const int desc_idx = slot_of(pollfds, fd);
+
+    if (desc_idx >= 0) {
+
+        if (pollfds->ops->add(pollfds, fd, events, true) < 0) {
+            return -1;
+        }
+
+        // Update the events being monitored.
+        pollfds->fds[desc_idx].events = events;
+        pollfds->fds[desc_idx].revents = 0;
+
+        return 0;
+    }
+
+    if (pollfds->polled == pollfds->length && grow_pollfds(pollfds) < 0) {
+        LOG_ERROR("Error adding pollfd event: buffer overflow");
+        return -1;
+    }
+
+    if (reserve_slots(pollfds, fd) < 0) {
+        LOG_ERROR("Error adding pollfd event: memory allocation failed");
+        return -1;
+    }
+
+    if (pollfds->ops->add(pollfds, fd, events, false) < 0) {
+        return -1;
+    }
+
+    struct pollfd new_fd = {
+        .fd = fd,
+        .events = events,
+        .revents = 0
+    };
+
+    // Add the file descriptor and events to the pollfd array.
+    pollfds->slots[fd].index = (int) pollfds->polled;
+    pollfds->slots[fd].data = NULL;
+    pollfds->fds[pollfds->polled++] = new_fd;
+
+    return 0;
+}
+
+/// @brief Remove a file descriptor event.
+void remove_event (struct pollfds *pollfds, int fd) {
+
+    assert(pollfds && pollfds->fds && fd >= 0);
+
+    // Check if the file descriptor is being polled.
+    const int desc_idx = slot_of(pollfds, fd);
+
+    if (desc_idx < 0) {
+        return;
+    }
+
+    pollfds->ops->remove(pollfds, fd);
+
+    // Move the last descriptor into the freed slot, the order of the pollfd array is irrelevant.
+    const unsigned int last_idx = --pollfds->polled;
+
+    if ((unsigned int) desc_idx != last_idx) {
+        pollfds->fds[desc_idx] = pollfds->fds[last_idx];
+        pollfds->slots[pollfds->fds[desc_idx].fd].index = desc_idx;
+    }
+
+    struct pollfd new_fd = {
+        .fd = -1,
+        .events = 0,
+        .revents = 0
+    };
+
+    // Clear the file descriptor and events.
+    pollfds->fds[last_idx] = new_fd;
+    pollfds->slots[fd].index = -1;
+    pollfds->slots[fd].data = NULL;
+}
+
+/// @brief Attach a context pointer to a polled file descriptor.
+int set_event_data (struct pollfds *pollfds, int fd, void *data) {
+
+    assert(pollfds && fd >= 0);
+
+    if (slot_of(pollfds, fd) < 0) {
+        return -1;
+    }
+
+    pollfds->slots[fd].data = data;
+
+    return 0;
+}
+
+// --- Static function definitions, iobuffer --- //
+
+/// @brief Map the storage of a mirrored buffer, the same pages are mapped twice back to back.
+/// @param size Size of the storage, a multiple of the page size.
+/// @return Pointer to the first mapping, NULL on failure.
+static char *mirror_map (size_t size) {
+
+#ifdef __linux__
+
+    int fd = -1;
+
+    if ((fd = memfd_create("io_buffer", MFD_CLOEXEC)) < 0) {
+        return NULL;
+    }
+
+    if (ftruncate(fd, (off_t) size) < 0) {
+        goto error_close;
+    }
+
+    // Reserve the address range first, so that both mappings are adjacent.
+    char *base = NULL;
+
+    if ((base = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED) {
+        goto error_close;
+    }
+
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        goto error_unmap;
+    }
+
+    if (mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        goto error_unmap;
+    }
+
+    // The mappings keep the memory referenced, the descriptor is not needed anymore.
+    (void) close(fd);
+
+    return base;
+
+error_unmap:
+    (void) munmap(base, size * 2);
+
+error_close:
+    (void) close(fd);
+
+    return NULL;
+
+#else
+
+    (void) size;
+
+    return NULL;
+
+#endif // __linux__
+}
+
+/// @brief Move the buffered data into a larger storage.
+/// @note The data is straightened during the copy, since the wrapped offsets change with the size.
+/// @param buffer The iobuffer struct.
+/// @param new_size The new size of the storage, power of two.
+/// @return 0 on success, -1 on failure.
+static int iobuff_grow (struct io_buffer *buffer, size_t new_size) {
+
+    char *storage = NULL;
+
+    // The mirrored storage is replaced by a larger mapping, the pending data is contiguous in the old one.
+    if (buffer->flags & IOBUFF_MIRRORED) {
+
+        if ((storage = mirror_map(new_size)) == NULL) {
+            return -1;
+        }
+
+        const size_t length = buffer->head - buffer->tail;
+
+        memcpy(storage, iobuff_tailptr(buffer), length);
+
+        // In-flight operations keep reading the old mapping, it is unmapped once they completed.
+        if (!(buffer->flags & IOBUFF_PINNED)) {
+            mirror_unmap(buffer->buffer, buffer->size);
+        }
+        else if (storage_retire(buffer) < 0) {
+            mirror_unmap(storage, new_size);
+            return -1;
+        }
+
+        buffer->buffer = storage;
+        buffer->size = new_size;
+        buffer->tail = 0;
+        buffer->head = length;
+
+        return 0;
+    }
+
+    // Buffers of the client contexts take their storage from the pool of the server.
+    if ((storage = (buffer->pool != NULL) ? pool_take(buffer->pool, new_size) : malloc(new_size)) == NULL) {
+        return -1;
+    }
+
+    const size_t length = buffer->head - buffer->tail;
+
+    // A detached buffer has no data to move.
+    if (length > 0) {
+
+        const size_t wtail = buffer->tail & (buffer->size - 1);
+        const size_t first_chunk = min(length, buffer->size - wtail);
+
+        memcpy(storage, buffer->buffer + wtail, first_chunk);
+        memcpy(storage + first_chunk, buffer->buffer, length - first_chunk);
+    }
+
+    // In-flight operations keep reading the old storage, it is released once they completed.
+    if ((buffer->flags & IOBUFF_PINNED) && storage_retire(buffer) < 0) {
+
+        if (buffer->pool != NULL) {
+            pool_give(buffer->pool, storage, new_size);
+        }
+        else {
+            free(storage);
+        }
+
+        return -1;
+    }
+
+    // Attaching the storage of a detached buffer is not a reallocation.
+    if (buffer->metrics != NULL && buffer->buffer != NULL) {
+        metrics_add(buffer->metrics, AS_COUNTER_REALLOCS, 1);
+    }
+
+    // The initial storage is allocated together with the header and is released with it.
+    storage_release(buffer);
+
+    buffer->buffer = storage;
+    buffer->size = new_size;
+    buffer->tail = 0;
+    buffer->head = length;
+    buffer->flags |= (buffer->pool != NULL) ? IOBUFF_POOLED : IOBUFF_OWNED;
+
+    return 0;
+}
+
+// --- Function definitions, iobuffer wrappers --- //
+
+/// @brief Allocate an iobuffer with mirrored storage.
+struct io_buffer *iobuff_alloc_mirrored (size_t size) {
+
+    assert((size & (size - 1)) == 0);
+
+    // Both mappings must start at a page boundary, pages are a power of two in size as well.
+    const long page_size = sysconf(_SC_PAGESIZE);
+
+    if (page_size > 0 && size < (size_t) page_size) {
+        size = (size_t) page_size;
+    }
+
+    struct io_buffer *buffer = NULL;
+
+    if ((buffer = calloc(1U, sizeof(*buffer))) == NULL) {
+        LOG_ERROR("Error allocating memory for buffer");
+        return NULL;
+    }
+
+    if ((buffer->buffer = mirror_map(size)) == NULL) {
+        LOG_ERROR("Error mapping mirrored buffer storage");
+        free(buffer);
+        return NULL;
+    }
+
+    buffer->size = size;
+    buffer->flags = IOBUFF_MIRRORED;
+
+    return buffer;
+}
+
+/// @brief Allocate memory for the client context and associated structures.
+struct io_buffer *iobuff_alloc (size_t size) {
+
+    assert((size & (size - 1)) == 0);
+    
+    const size_t alloc_size = sizeof(struct io_buffer) + size_roundup(size * sizeof(char));
+
+    struct io_buffer *buffer = NULL;
+
+    if ((buffer = calloc(1U, alloc_size)) == NULL) {
+        LOG_ERROR("Error allocating memory for buffer");
+        return NULL;
+    }
+
+    // char has an alignment of 1, so no need to align the buffer.
+    buffer->buffer = (char *) (buffer + 1);
+    buffer->size = size;
+
+    return buffer;
+}
+
+/// @brief Append the new data to the buffer.
+size_t iobuff_append (struct io_buffer *buffer, const char *data, size_t length, bool can_reallocate) {
+
+    assert(buffer && data);
+
+    // If the length is zero, return early.
+    if (length == 0) {
+        return 0;
+    }
+
+    // A detached buffer takes its storage from the pool, regardless of can_reallocate.
+    if (buffer->buffer == NULL && iobuff_reserve(buffer, length) < 0) {
+        LOG_ERROR("Error attaching buffer storage");
+        return 0;
+    }
+
+    size_t free_space = iobuff_space(buffer);
+
+    // Reallocate the buffer if there is insufficient space.
+    if (free_space < length) {
+
+        // Pinned storage is referenced by an in-flight operation, it is kept until the operation completed.
+        if (can_reallocate) {
+            size_t new_size = buffer->size + length;
+
+            // Calculate the next power of two for the new buffer size.
+            new_size = size_roundup(new_size);
+
+            // Limited buffers grow up to their limit, the rest of the data is not appended.
+            if (buffer->limit > 0 && new_size > buffer->limit) {
+                new_size = buffer->limit;
+            }
+
+            if (new_size > buffer->size && iobuff_grow(buffer, new_size) < 0) {
+                LOG_ERROR("Error reallocating buffer");
+                return 0;
+            }
+
+            // Update the free space after reallocation.
+            free_space = buffer->size - (buffer->head - buffer->tail);
+        }
+    }
+
+    // The buffer is full and could not be reallocated.
+    if (free_space == 0) {
+        return 0;
+    }
+
+    // The free space of a mirrored buffer is contiguous, the data is copied at once.
+    if (buffer->flags & IOBUFF_MIRRORED) {
+        const size_t chunk = min(length, free_space);
+
+        memcpy(iobuff_headptr(buffer), data, chunk);
+        buffer->head += chunk;
+
+        return chunk;
+    }
+
+    // Wrap around the buffer pointers for pointer arithmetic.
+    const size_t whead = buffer->head & (buffer->size - 1);
+    const size_t wtail = buffer->tail & (buffer->size - 1);
+
+    // In case the buffer has wrapped around, we need to copy the data in two chunks.
+    if (wtail <= whead) {
+        size_t first_chunk = min(length, buffer->size - whead);
+        size_t second_chunk = min(length - first_chunk, wtail);
+        
+        size_t total = first_chunk + second_chunk;
+
+        memcpy(buffer->buffer + whead, data, first_chunk);
+        memcpy(buffer->buffer, data + first_chunk, second_chunk);
+
+        buffer->head += total;
+
+        return total;
+    }
+
+    size_t chunk = min(length, wtail - whead);
+
+    memcpy(buffer->buffer + whead, data, chunk);
+
+    buffer->head += chunk;
+
+    return chunk;
+}
+
+/// @brief Free the memory allocated for the buffer.
+void iobuff_free (struct io_buffer *buffer) {
+
+    assert(buffer);
+
+    retired_release(buffer);
+
+    if (buffer->flags & IOBUFF_MIRRORED) {
+        mirror_unmap(buffer->buffer, buffer->size);
+    }
+    else {
+        storage_release(buffer);
+    }
+
+    free(buffer);
+}
+
+/// @brief Clear the pin of the buffer and release the storage it replaced meanwhile.
+void iobuff_unpin (struct io_buffer *buffer) {
+
+    assert(buffer);
+
+    buffer->flags &= ~IOBUFF_PINNED;
+    retired_release(buffer);
+}
+
+/// @brief Make room for at least the given number of bytes in the buffer.
+int iobuff_reserve (struct io_buffer *buffer, size_t length) {
+
+    assert(buffer);
+
+    const size_t pending = buffer->head - buffer->tail;
+
+    if (buffer->buffer != NULL && buffer->size - pending >= length) {
+        return 0;
+    }
+
+    size_t new_size = size_roundup(pending + length);
+    const size_t min_size = (buffer->pool != NULL) ? buffer->pool->base : BUFFER_SIZE;
+
+    if (new_size < min_size) {
+        new_size = min_size;
+    }
+
+    if (buffer->limit > 0 && new_size > buffer->limit) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    return iobuff_grow(buffer, new_size);
+}
+
+/// @brief Return the storage of a drained buffer to its pool.
+void iobuff_release (struct io_buffer *buffer) {
+
+    assert(buffer);
+
+    if (buffer->pool == NULL || buffer->buffer == NULL || !iobuff_empty(buffer) || (buffer->flags & (IOBUFF_PINNED | IOBUFF_MIRRORED))) {
+        return;
+    }
+
+    storage_release(buffer);
+
+    buffer->buffer = NULL;
+    buffer->size = 0;
+    buffer->head = 0;
+    buffer->tail = 0;
+}
+
+/// @brief Send the pending data of the buffers with a single sendmsg(2), both ring segments are sent in place.
+/// @param client The client context.
+/// @param buffers The buffers to send, in order.
+/// @param count The number of buffers, at most IOBUFF_SENDV_MAX.
+/// @return The total number of bytes sent, -1 on failure.
+static ssize_t iobuff_sendmsg (struct client_context *client, struct io_buffer *const *buffers, size_t count) {
+
+    struct iovec iov[IOBUFF_SENDV_MAX * 2];
+    size_t iovcnt = 0;
+    size_t total = 0;
+
+    // Describe the pending data of every buffer, the wrapped data takes a second segment.
+    for (size_t i = 0; i < count; i++) {
+
+        // The output ring might still hold bytes of zero-copy sends in flight.
+        if (buffers[i] == client->output) {
+            iovcnt += (size_t) output_iov(client, &iov[iovcnt]);
+            total += output_unsent(client);
+            continue;
+        }
+
+        iovcnt += (size_t) iobuff_data_iov(buffers[i], &iov[iovcnt]);
+        total += buffers[i]->head - buffers[i]->tail;
+    }
+
+    // If the buffers are empty, we can return early.
+    if (iovcnt == 0) {
+        return 0;
+    }
+
+    struct server_context *server = client->server;
+
+    // Hold back partial segments until the end of the iteration, the flush uncorks the socket.
+    if (server != NULL && server->dispatching && (server->options & AS_OPT_CORK) && !(client->flags & CLIENT_CORKED)) {
+        client_cork(client, true);
+        client->flags |= CLIENT_CORKED;
+        client_mark_dirty(client);
+    }
+
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    bool zerocopy = false;
+
+#ifdef AS_ZEROCOPY_SUPPORTED
+    // Large output is transmitted from the ring pages, its bytes are released once the kernel completes the send.
+    zerocopy = (client->flags & CLIENT_ZEROCOPY) && count == 1 && buffers[0] == client->output
+        && total >= server->config.zerocopy_min && client->zerocopy.next - client->zerocopy.acked < AS_ZEROCOPY_SENDS;
+#endif // AS_ZEROCOPY_SUPPORTED
+
+    // The number of bytes sent to the client, a broken connection is reported as an error instead of SIGPIPE.
+    ssize_t sent = sendmsg(client->info->fd, &msg, MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0));
+
+    // The pages cannot be pinned, e.g. the socket exceeded its optmem limit, the data is copied instead.
+    if (sent < 0 && zerocopy && errno == ENOBUFS) {
+        zerocopy = false;
+        sent = sendmsg(client->info->fd, &msg, MSG_NOSIGNAL);
+    }
+
+    // Check if the data was sent successfully, the socket buffer might be full.
+    if (sent < 0) {
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_ERROR("Error sending data to client");
+            return -1;
+        }
+
+        sent = 0;
+    }
+
+    zerocopy = zerocopy && sent > 0;
+
+    if (server != NULL) {
+        metrics_add(&server->metrics, AS_COUNTER_BYTES_OUT, (uint64_t) sent);
+        metrics_add(&server->metrics, AS_COUNTER_PARTIAL_SENDS, (size_t) sent < total);
+        metrics_add(&server->metrics, AS_COUNTER_ZEROCOPY, zerocopy);
+    }
+
+    // Release the sent data from the buffers in order, the socket might have accepted only a part of it.
+    size_t remaining = (size_t) sent;
+    bool output = false;
+
+    for (size_t i = 0; i < count; i++) {
+
+        if (buffers[i] == client->output) {
+
+            const size_t chunk = min(remaining, output_unsent(client));
+
+            output_release(client, chunk, zerocopy);
+            remaining -= chunk;
+            output = true;
+            continue;
+        }
+
+        const size_t chunk = min(remaining, buffers[i]->head - buffers[i]->tail);
+
+        buffers[i]->tail += chunk;
+        remaining -= chunk;
+    }
+
+    // Arm the write interest if data was left behind, disarm it once the output buffer is drained.
+    if (output && client->server != NULL) {
+        as_sync_events(client);
+    }
+
+    return sent;
+}
+
+/// @brief Flush the output buffers of the clients written during the iteration and uncork their sockets.
+/// @note Called once the dispatching is over, disconnected clients are still valid until they are reaped.
+/// @param server The server context.
+static void flush_dirty (struct server_context *server) {
+
+    struct client_context *client = server->dirty;
+
+    server->dirty = NULL;
+
+    while (client != NULL) {
+
+        struct client_context *next = client->dirty;
+
+        if (!(client->flags & CLIENT_CLOSING)) {
+
+            // A single sendmsg per client, whatever is left behind arms the write interest.
+            if (output_pending(client)) {
+                (void) as_flush(client);
+            }
+
+            if (client->flags & CLIENT_CORKED) {
+                client_cork(client, false);
+            }
+
+            iobuff_release(client->output);
+        }
+
+        client->flags &= ~(CLIENT_DIRTY | CLIENT_CORKED);
+        client->dirty = NULL;
+        client = next;
+    }
+}
+
+/// @brief Send data to the client from the (circular) buffer.
+ssize_t iobuff_send (struct client_context *client, struct io_buffer *buffer) {
+
+    assert(client && buffer);
+
+    // Writes of the handlers are coalesced into a single send at the end of the iteration.
+    if (client->server != NULL && client->server->dispatching && (client->server->options & AS_OPT_DEFER_FLUSH)
+        && client->server->uring == NULL && buffer == client->output) {
+        client_mark_dirty(client);
+        return 0;
+    }
+
+    // The queued entries are interleaved with the ring data, see as_flush().
+    if (client->chunks != NULL && buffer == client->output) {
+        return as_flush(client);
+    }
+
+    // The io_uring engine sends the output buffer asynchronously, in a single batch per iteration.
+    if (client->server != NULL && client->server->uring != NULL && buffer == client->output) {
+        return uring_send(client);
+    }
+
+    return iobuff_sendmsg(client, &buffer, 1);
+}
+
+/// @brief Send data of several buffers to the client.
+ssize_t iobuff_sendv (struct client_context *client, struct io_buffer *const *buffers, size_t count) {
+
+    assert(client && buffers && count <= IOBUFF_SENDV_MAX);
+
+    // The ring data queued behind a descriptor must not overtake it.
+    for (size_t i = 0; client->chunks != NULL && i < count; i++) {
+
+        if (buffers[i] == client->output) {
+            LOG_ERROR("Error sending output buffer with queued entries synchronously");
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    // The output buffer of the io_uring engine might have a send in flight, the data would be reordered.
+    if (client->server != NULL && client->server->uring != NULL) {
+
+        for (size_t i = 0; i < count; i++) {
+
+            if (buffers[i] == client->output) {
+                LOG_ERROR("Error sending output buffer of io_uring client synchronously");
+                errno = EINVAL;
+                return -1;
+            }
+        }
+    }
+
+    return iobuff_sendmsg(client, buffers, count);
+}
+
+/// @brief Send the data of the output buffer queued before the first descriptor.
+/// @param client The client context.
+/// @param limit The maximum number of bytes to send.
+/// @return The number of bytes sent, 0 if the socket is full, -1 on failure.
+static ssize_t output_send_ring (struct client_context *client, size_t limit) {
+
+    struct iovec iov[2];
+    const int iovcnt = output_iov(client, iov);
+    size_t length = 0;
+
+    // Cut the segments at the position of the descriptor.
+    for (int i = 0; i < iovcnt; i++) {
+        iov[i].iov_len = min(iov[i].iov_len, limit - length);
+        length += iov[i].iov_len;
+    }
+
+    if (length == 0) {
+        return 0;
+    }
+
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (size_t) iovcnt;
+
+    ssize_t sent = sendmsg(client->info->fd, &msg, MSG_NOSIGNAL);
+
+    if (sent < 0) {
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_ERROR("Error sending data to client");
+            return -1;
+        }
+
+        return 0;
+    }
+
+    output_release(client, (size_t) sent, false);
+
+    return sent;
+}
+
+/// @brief Transmit the data of a queued descriptor.
+/// @param client The client context.
+/// @param chunk The first entry of the output queue.
+/// @return The number of bytes sent, 0 if the socket is full, -1 on failure.
+static ssize_t output_send_chunk (struct client_context *client, struct output_chunk *chunk) {
+
+    ssize_t sent;
+
+#ifdef __linux__
+
+    if (chunk->offset < 0) {
+        sent = splice(chunk->fd, NULL, client->info->fd, NULL, chunk->remaining, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    }
+    else {
+        sent = sendfile(client->info->fd, chunk->fd, &chunk->offset, chunk->remaining);
+    }
+
+#else
+
+    // Without sendfile(2) the file is copied through a bounce buffer, only the accepted part is consumed.
+    char bounce[16384];
+
+    sent = pread(chunk->fd, bounce, min(sizeof(bounce), chunk->remaining), chunk->offset);
+
+    if (sent > 0 && (sent = send(client->info->fd, bounce, (size_t) sent, MSG_NOSIGNAL)) > 0) {
+        chunk->offset += sent;
+    }
+
+#endif // __linux__
+
+    if (sent < 0) {
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_ERROR("Error transmitting descriptor to client");
+            return -1;
+        }
+
+        return 0;
+    }
+
+    // The source ended early, e.g. the file was truncated or the write end of the pipe was closed.
+    if (sent == 0) {
+        chunk->remaining = 0;
+        return 0;
+    }
+
+    chunk->remaining -= (size_t) sent;
+
+    if (client->server != NULL) {
+        metrics_add(&client->server->metrics, AS_COUNTER_BYTES_OUT, (uint64_t) sent);
+    }
+
+    return sent;
+}
+
+/// @brief Describe a part of the unsent output ring bytes.
+/// @param ring The segments of the unsent ring bytes, see output_iov().
+/// @param count The number of ring segments.
+/// @param skip The number of ring bytes in front of the part.
+/// @param length The length of the part.
+/// @param iov The two I/O vectors to fill in.
+/// @return The number of segments holding the part, i.e. 0, 1 or 2.
+static int ring_slice (const struct iovec ring[2], int count, size_t skip, size_t length, struct iovec iov[2]) {
+
+    int slices = 0;
+
+    for (int i = 0; i < count && length > 0; i++) {
+
+        if (skip >= ring[i].iov_len) {
+            skip -= ring[i].iov_len;
+            continue;
+        }
+
+        const size_t chunk = min(length, ring[i].iov_len - skip);
+
+        iov[slices].iov_base = (char *) ring[i].iov_base + skip;
+        iov[slices].iov_len = chunk;
+        slices++;
+
+        length -= chunk;
+        skip = 0;
+    }
+
+    return slices;
+}
+
+/// @brief Transmit the payloads at the front of the output queue and the ring data around them with a single sendmsg.
+/// @param client The client context.
+/// @param length Set to the number of bytes handed to sendmsg.
+/// @return The number of bytes sent, 0 if the socket is full, -1 on failure.
+static ssize_t output_send_payloads (struct client_context *client, size_t *length) {
+
+    struct iovec ring[2];
+    const int ringcnt = output_iov(client, ring);
+
+    struct iovec iov[AS_PAYLOAD_IOV];
+    size_t iovcnt = 0;
+    size_t skip = 0;
+
+    struct output_chunk *chunk = client->chunks;
+
+    *length = 0;
+
+    // Each entry takes up to two ring segments in front of it and its payload.
+    for (; chunk != NULL && chunk->payload != NULL && iovcnt + 3 <= AS_PAYLOAD_IOV; chunk = chunk->next) {
+
+        iovcnt += (size_t) ring_slice(ring, ringcnt, skip, chunk->before, &iov[iovcnt]);
+        skip += chunk->before;
+
+        iov[iovcnt].iov_base = chunk->payload->data + chunk->offset;
+        iov[iovcnt].iov_len = chunk->remaining;
+        iovcnt++;
+
+        *length += chunk->before + chunk->remaining;
+    }
+
+    // The ring data queued behind the last entry completes the batch.
+    if (chunk == NULL && iovcnt + 2 <= AS_PAYLOAD_IOV) {
+        const size_t trailing = output_unsent(client) - skip;
+
+        iovcnt += (size_t) ring_slice(ring, ringcnt, skip, trailing, &iov[iovcnt]);
+        *length += trailing;
+    }
+
+    if (*length == 0) {
+        return 0;
+    }
+
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+
+    const ssize_t sent = sendmsg(client->info->fd, &msg, MSG_NOSIGNAL);
+
+    if (sent < 0) {
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_ERROR("Error sending data to client");
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if (client->server != NULL) {
+        metrics_add(&client->server->metrics, AS_COUNTER_BYTES_OUT, (uint64_t) sent);
+        metrics_add(&client->server->metrics, AS_COUNTER_PARTIAL_SENDS, (size_t) sent < *length);
+    }
+
+    // Release the sent bytes in order, the entries are dropped once their payload was transmitted.
+    size_t remaining = (size_t) sent;
+
+    while ((chunk = client->chunks) != NULL && chunk->payload != NULL) {
+
+        const size_t ring_bytes = min(remaining, chunk->before);
+
+        output_release(client, ring_bytes, false);
+        chunk->before -= ring_bytes;
+        client->chunked -= ring_bytes;
+        remaining -= ring_bytes;
+
+        const size_t payload_bytes = min(remaining, chunk->remaining);
+
+        chunk->offset += (off_t) payload_bytes;
+        chunk->remaining -= payload_bytes;
+        client->queued -= payload_bytes;
+        remaining -= payload_bytes;
+
+        if (chunk->before > 0 || chunk->remaining > 0) {
+            break;
+        }
+
+        client->chunks = chunk->next;
+
+        if (client->chunks == NULL) {
+            client->chunks_last = NULL;
+        }
+
+        chunk_free(chunk);
+    }
+
+    output_release(client, remaining, false);
+
+    return sent;
+}
+
+/// @brief Append an entry to the output queue, behind the ring data appended so far.
+/// @param client The client context.
+/// @param chunk The entry.
+static void output_enqueue (struct client_context *client, struct output_chunk *chunk) {
+
+    // The ring data appended so far goes first, the bytes before earlier entries are already accounted for.
+    const size_t pending = output_unsent(client);
+
+    chunk->next = NULL;
+    chunk->before = pending - client->chunked;
+
+    client->chunked = pending;
+
+    if (client->chunks_last != NULL) {
+        client->chunks_last->next = chunk;
+    }
+    else {
+        client->chunks = chunk;
+    }
+
+    client->chunks_last = chunk;
+}
+
+int as_sendfile (struct client_context *client, int fd, off_t offset, size_t length, unsigned int flags) {
+
+    assert(client && client->output && fd >= 0);
+
+    // Completion-based transmission of descriptors is not implemented by the io_uring engine.
+    if (client->server != NULL && client->server->uring != NULL) {
+        LOG_ERROR("Error queueing descriptor, not supported by the io_uring engine");
+        errno = ENOTSUP;
+        return -1;
+    }
+
+#ifndef __linux__
+
+    // Pipes cannot be read back once the socket refuses the data, splice(2) is required.
+    if (offset < 0) {
+        errno = ENOTSUP;
+        return -1;
+    }
+
+#endif // __linux__
+
+    struct output_chunk *chunk = NULL;
+
+    if ((chunk = malloc(sizeof(*chunk))) == NULL) {
+        LOG_ERROR("Error allocating memory for output queue entry");
+        return -1;
+    }
+
+    chunk->payload = NULL;
+    chunk->fd = fd;
+    chunk->offset = (offset < 0) ? -1 : offset;
+    chunk->remaining = length;
+    chunk->flags = flags;
+
+    output_enqueue(client, chunk);
+
+    return 0;
+}
+
+struct as_payload *as_payload_create (const char *data, size_t length) {
+
+    struct as_payload *payload = NULL;
+
+    if ((payload = malloc(sizeof(*payload) + length)) == NULL) {
+        LOG_ERROR("Error allocating memory for payload");
+        return NULL;
+    }
+
+    atomic_init(&payload->refs, 1U);
+    payload->length = length;
+
+    if (data != NULL && length > 0) {
+        memcpy(payload->data, data, length);
+    }
+
+    return payload;
+}
+
+struct as_payload *as_payload_acquire (struct as_payload *payload) {
+
+    assert(payload);
+
+    // Taking a reference needs no ordering, the holder of an existing one keeps the payload alive.
+    atomic_fetch_add_explicit(&payload->refs, 1U, memory_order_relaxed);
+
+    return payload;
+}
+
+void as_payload_release (struct as_payload *payload) {
+
+    if (payload == NULL) {
+        return;
+    }
+
+    // The last reference observes the accesses of all the others before the storage is freed.
+    if (atomic_fetch_sub_explicit(&payload->refs, 1U, memory_order_acq_rel) == 1U) {
+        free(payload);
+    }
+}
+
+int as_send_payload (struct client_context *client, struct as_payload *payload) {
+
+    assert(client && client->output && payload);
+
+    // The io_uring engine flushes the output ring only, the queue would be overtaken.
+    if (client->server != NULL && client->server->uring != NULL) {
+        LOG_ERROR("Error queueing payload, not supported by the io_uring engine");
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    // An empty payload has nothing to transmit, the queue only holds entries with data.
+    if (payload->length == 0) {
+        return 0;
+    }
+
+    struct output_chunk *chunk = NULL;
+
+    if ((chunk = malloc(sizeof(*chunk))) == NULL) {
+        LOG_ERROR("Error allocating memory for output queue entry");
+        return -1;
+    }
+
+    chunk->payload = as_payload_acquire(payload);
+    chunk->fd = INVALID_FD;
+    chunk->offset = 0;
+    chunk->remaining = payload->length;
+    chunk->flags = 0;
+
+    output_enqueue(client, chunk);
+
+    client->queued += payload->length;
+
+    // The queued bytes count against the high watermark of the output.
+    if (client->server != NULL) {
+        as_sync_events(client);
+    }
+
+    return 0;
+}
+
+ssize_t as_flush (struct client_context *client) {
+
+    assert(client && client->output);
+
+    struct output_chunk *chunk = NULL;
+    ssize_t total = 0;
+    ssize_t sent = 0;
+
+    while ((chunk = client->chunks) != NULL) {
+
+        // Payloads are gathered with the ring data in front of and behind them.
+        if (chunk->payload != NULL) {
+
+            size_t length = 0;
+
+            if ((sent = output_send_payloads(client, &length)) < 0) {
+                return -1;
+            }
+
+            total += sent;
+
+            if ((size_t) sent < length) {
+                goto blocked;
+            }
+
+            continue;
+        }
+
+        // The ring data queued in front of the descriptor.
+        if (chunk->before > 0) {
+
+            if ((sent = output_send_ring(client, chunk->before)) < 0) {
+                return -1;
+            }
+
+            chunk->before -= (size_t) sent;
+            client->chunked -= (size_t) sent;
+            total += sent;
+
+            if (chunk->before > 0) {
+                goto blocked;
+            }
+        }
+
+        if ((sent = output_send_chunk(client, chunk)) < 0) {
+            return -1;
+        }
+
+        total += sent;
+
+        if (chunk->remaining > 0) {
+            goto blocked;
+        }
+
+        client->chunks = chunk->next;
+
+        if (client->chunks == NULL) {
+            client->chunks_last = NULL;
+        }
+
+        chunk_free(chunk);
+    }
+
+    // The ring data queued after the last descriptor, the write interest is synchronized by the send.
+    if (output_unsent(client) > 0) {
+
+        if ((sent = iobuff_sendmsg(client, &client->output, 1)) < 0) {
+            return -1;
+        }
+
+        return total + sent;
+    }
+
+blocked:
+
+    // Keep the write interest while the socket is full, drop it once everything was transmitted.
+    if (client->server != NULL) {
+        as_sync_events(client);
+    }
+
+    return total;
+}
+
+/// @brief Receive data of the client into the buffer.
+ssize_t iobuff_recv (struct client_context *client, struct io_buffer *buffer) {
+
+    assert(client && buffer);
+
+    ssize_t total = 0;
+
+    // A detached buffer is attached only once the socket is readable.
+    if (buffer->buffer == NULL && iobuff_reserve(buffer, 1) < 0) {
+        LOG_ERROR("Error attaching buffer storage");
+        return -1;
+    }
+
+    for (;;) {
+
+        const size_t length = buffer->head - buffer->tail;
+        const size_t free_space = buffer->size - length;
+
+        if (free_space == 0) {
+            break;
+        }
+
+        // Describe the free space, it wraps around unless the buffer is mirrored.
+        const size_t whead = buffer->head & (buffer->size - 1);
+        const size_t first_chunk = (buffer->flags & IOBUFF_MIRRORED) ? free_space : min(free_space, buffer->size - whead);
+
+        struct iovec iov[2] = {
+            { .iov_base = buffer->buffer + whead, .iov_len = first_chunk },
+            { .iov_base = buffer->buffer, .iov_len = free_space - first_chunk },
+        };
+
+        const ssize_t received = readv(client->info->fd, iov, (first_chunk < free_space) ? 2 : 1);
+
+        if (received < 0) {
+
+            if (errno == EINTR) {
+                continue;
+            }
+
+            // The data received so far is reported, the error repeats on the next call.
+            if (total > 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+
+            if (total == 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Error receiving data from client");
+            }
+
+            return (total > 0) ? total : -1;
+        }
+
+        // The peer closed the connection, the end of stream is reported once the data is consumed.
+        if (received == 0) {
+            break;
+        }
+
+        buffer->head += (size_t) received;
+        total += received;
+
+        if (buffer->metrics != NULL) {
+            metrics_add(buffer->metrics, AS_COUNTER_BYTES_IN, (uint64_t) received);
+        }
+
+        // A short read means the socket was drained, saving the readv(2) that would fail with EAGAIN.
+        if ((size_t) received < free_space) {
+            break;
+        }
+    }
+
+    if (total == 0 && iobuff_full(buffer)) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    return total;
+}
+
+// --- Function definitions, server --- //
+
+int as_bind (struct server_context *server, const char* ipv4, event_callback_t handler) {
+    return as_bind_config(server, ipv4, handler, NULL);
+}
+
+int as_bind_config (struct server_context *server, const char *ipv4, event_callback_t handler, const struct server_config *config) {
+
+    assert(server && ipv4 && handler);
+
+    int retvalue = -1;
+
+    // Resolve the defaults of the capacity settings, the reactor passes the config of the server itself.
+    if (config != NULL) {
+        if (config != &server->config) {
+            server->config = *config;
+        }
+    }
+    else {
+        memset(&server->config, 0, sizeof(server->config));
+    }
+
+    struct server_config *conf = &server->config;
+
+    conf->max_clients = (conf->max_clients > 0) ? conf->max_clients : MAX_CLIENTS;
+    conf->backlog = (conf->backlog > 0) ? conf->backlog : (int) min(conf->max_clients, INT_MAX);
+    conf->buffer_size = (conf->buffer_size > 0) ? conf->buffer_size : BUFFER_SIZE;
+    conf->poll_initial = (conf->poll_initial > 0) ? min(conf->poll_initial, conf->max_clients) : conf->max_clients;
+    conf->output_low = (conf->output_low > 0) ? conf->output_low : conf->output_high / 2;
+    conf->zerocopy_min = (conf->zerocopy_min > 0) ? conf->zerocopy_min : AS_ZEROCOPY_MIN;
+
+    if ((conf->buffer_size & (conf->buffer_size - 1)) != 0 || (conf->buffer_max > 0 && conf->buffer_max < conf->buffer_size)
+        || (conf->buffer_max & (conf->buffer_max - 1)) != 0 || conf->max_clients > UINT_MAX - AS_RESERVED_FDS
+        || (conf->output_high > 0 && conf->output_low >= conf->output_high)
+        || (conf->buffer_max > 0 && conf->output_high > conf->buffer_max)) {
+        LOG_ERROR("Error binding server: invalid configuration");
+        errno = EINVAL;
+        goto error;
+    }
+
+    timer_wheel_init(&server->timers, timer_now());
+    metrics_init(&server->metrics, (server->options & AS_OPT_LATENCY) != 0);
+
+    // The table is specialized for descriptor keys, the hash and comparison are inlined.
+    if (client_table_init(&server->contexts, conf->poll_initial) < 0) {
+        LOG_ERROR("Error creating hash table");
+        retvalue = -1;
+        goto error;
+    }
+
+    // Preallocate the client contexts, so that accepting a connection does not allocate memory.
+    memset(&server->buffers, 0, sizeof(server->buffers));
+    server->buffers.base = conf->buffer_size;
+    server->pool = NULL;
+    server->pooled = 0;
+    server->pool_size = (server->pool_size > 0) ? server->pool_size : CLIENT_POOL_SIZE;
+
+    while (server->pooled < server->pool_size) {
+
+        struct client_context *client = NULL;
+
+        if ((client = client_alloc(server)) == NULL) {
+            retvalue = -1;
+            goto error_poll;
+        }
+
+        client->next = server->pool;
+        server->pool = client;
+        server->pooled++;
+    }
+
+    // Set by uring_create() only, the context is not required to be zeroed.
+    server->uring = NULL;
+
+    // Select the event backend, epoll(7) is preferred on Linux unless requested otherwise.
+    if ((server->polled = create_pollfds(conf->poll_initial + AS_RESERVED_FDS, server->backend)) == NULL) {
+        LOG_ERROR("Error creating pollfd array");
+        retvalue = -1;
+        goto error_poll;
+    }
+
+    // The poll set grows with the connections, the listener and the wakeup descriptor take an entry each.
+    set_poll_growth(server->polled, (unsigned int) (conf->max_clients + AS_RESERVED_FDS), (unsigned int) min(conf->poll_growth, UINT_MAX));
+
+    // Listeners of other reactors might share the address, see as_reactor.h.
+    conf->sockets.reuse_port = conf->sockets.reuse_port || (server->options & AS_OPT_REUSEPORT);
+    conf->sockets.backlog = conf->backlog;
+
+    if (server_bind_opts(&server->info, ipv4, &conf->sockets) < 0) {
+        retvalue = -1;
+        goto error_server;
+    }
+
+    // Set the listener socket to non-blocking mode to avoid blocking on accept.
+    int get_flags = 0;
+
+    if ((get_flags = fcntl(server->info.fd, F_GETFL, 0)) < 0) {
+        LOG_ERROR("Error getting file descriptor flags");
+        goto error_server;
+    }
+
+    // Update the file descriptor flags.
+    if (fcntl(server->info.fd, F_SETFL, get_flags | O_NONBLOCK) < 0) {
+        LOG_ERROR("Error setting file descriptor flags");
+        goto error_server;
+    }
+
+    // Monitor the server socket for incoming connections.
+    if (add_event(server->polled, server->info.fd, POLLIN | POLLPRI) < 0) {
+        LOG_ERROR("Error adding event to pollfds");
+        goto error_server;
+    }
+
+    // Other threads wake up the loop through this descriptor, e.g. to hand back completed work.
+    if (notify_open(server) < 0) {
+        LOG_ERROR("Error creating wakeup descriptor");
+        goto error_server;
+    }
+
+    if (add_event(server->polled, server->notify_fd, POLLIN) < 0) {
+        LOG_ERROR("Error adding event to pollfds");
+        goto error_notify;
+    }
+
+    // The io_uring engine serves the listener with its own accept requests instead.
+    if (server->polled->backend == POLL_BACKEND_IO_URING && uring_create(server) < 0) {
+        LOG_ERROR("Error creating io_uring engine");
+        goto error_notify;
+    }
+
+    server->closing = NULL;
+    server->dirty = NULL;
+    server->paused = NULL;
+    server->generation = 0;
+    server->listeners = NULL;
+    server->accepting = &server->info;
+    server->batch = NULL;
+    server->batch_length = 0;
+
+    // Set the event handler for the server.
+    server->event_handler = handler;
+
+    return 0;
+
+error_notify:
+    (void) close(server->notify_fd);
+    notify_close(server);
+
+error_server:
+    destroy_pollfds(server->polled);
+    server->polled = NULL;
 
 error_poll:
-    htable_destroy(server->contexts);
-    server->contexts = NULL;
+    client_pool_destroy(server);
+    pool_destroy(&server->buffers);
+    client_table_destroy(&server->contexts);
+
+error:
+    return retvalue;
+}
+
+int as_listen (struct server_context *server, const char *ipv4, event_callback_t handler) {
+
+    assert(server && server->polled && ipv4 && handler);
+
+    // The accept requests of the io_uring engine serve the listener of as_bind() only.
+    if (server->uring != NULL) {
+        LOG_ERROR("Error adding listener, not supported by the io_uring engine");
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    struct as_listener *listener = NULL;
+
+    if ((listener = calloc(1U, sizeof(*listener))) == NULL) {
+        LOG_ERROR("Error allocating memory for listener");
+        return -1;
+    }
+
+    // The listener options of the profile apply to every listener of the server.
+    if (server_bind_opts(&listener->info, ipv4, &server->config.sockets) < 0) {
+        goto error_free;
+    }
+
+    // Set the listener socket to non-blocking mode to avoid blocking on accept.
+    int get_flags = 0;
+
+    if ((get_flags = fcntl(listener->info.fd, F_GETFL, 0)) < 0 || fcntl(listener->info.fd, F_SETFL, get_flags | O_NONBLOCK) < 0) {
+        LOG_ERROR("Error setting file descriptor flags");
+        goto error_close;
+    }
+
+    // The listener takes a poll set entry on top of the clients.
+    set_poll_growth(server->polled, server->polled->limit + 1U, server->polled->growth);
+
+    if (add_event(server->polled, listener->info.fd, POLLIN | POLLPRI) < 0) {
+        LOG_ERROR("Error adding event to pollfds");
+        goto error_close;
+    }
+
+    listener->handler = handler;
+    listener->next = server->listeners;
+    server->listeners = listener;
+
+    return 0;
+
+error_close:
+    (void) close(listener->info.fd);
+
+error_free:
+    free(listener);
+
+    return -1;
+}
+
+struct client_context *as_accept (struct server_context *server, event_callback_t handler) {
+
+    assert(server && handler);
+    
+    struct client_context *client;
+
+    if ((client = client_get(server)) == NULL) {
+        LOG_ERROR("Error allocating memory for client context");
+        goto error;
+    }
+
+    client->event_handler = handler;
+    client->server = server;
+
+    if (server->uring != NULL) {
+
+        // The descriptor was already accepted by the io_uring engine in non-blocking mode.
+        if ((client->info->fd = uring_accept(server)) < 0) {
+            goto error_free;
+        }
+
+        socklen_t client_addr_len = sizeof(client->info->addr);
+
+        (void) getpeername(client->info->fd, (struct sockaddr *) &client->info->addr, &client_addr_len);
+        client->info->listener = &server->info;
+        client->info->cpu = -1;
+    }
+    else {
+
+        // The descriptor is created in non-blocking mode, no fcntl(2) calls are needed.
+        if (server_accept_nonblock(server->accepting, client->info) < 0) {
+            goto error_free;
+        }
+    }
+
+    // The connection options of the profile, a refused option does not fail the connection.
+    (void) socket_tune(client->info->fd, &server->config.sockets);
+
+    // Generations start at 1, so no connection matches the identifier 0 of posted callbacks.
+    client->id = ((uint64_t) ++server->generation << 32) | (uint32_t) client->info->fd;
+
+#ifdef AS_ZEROCOPY_SUPPORTED
+    // The io_uring engine sends from its own submissions, zero-copy is only used by the readiness backends.
+    const int zerocopy = 1;
+
+    if ((server->options & AS_OPT_ZEROCOPY) && server->uring == NULL) {
+
+        if (setsockopt(client->info->fd, SOL_SOCKET, SO_ZEROCOPY, &zerocopy, sizeof(zerocopy)) == 0) {
+            client->flags |= CLIENT_ZEROCOPY;
+        }
+        else {
+            LOG_ERROR("Error enabling SO_ZEROCOPY on client socket");
+        }
+    }
+#endif // AS_ZEROCOPY_SUPPORTED
+
+    // A listener that prefers the connections of its core reports whether the kernel managed to steer them.
+    if (client->info->listener->cpu >= 0) {
+        client->info->cpu = socket_incoming_cpu(client->info->fd);
+        metrics_add(&server->metrics, AS_COUNTER_FOREIGN_CPU, client->info->cpu != client->info->listener->cpu);
+    }
+
+    // Write interest is armed only once there is data to send, see as_sync_events().
+    client->events = POLLIN | POLLHUP;
+
+    if (add_event(server->polled, client->info->fd, client->events) < 0) {
+        LOG_ERROR("Error adding event to pollfds");
+        goto error_disconnect;
+    }
+
+    // Store the context next to the descriptor for the dispatch in as_poll().
+    (void) set_event_data(server->polled, client->info->fd, client);
+
+    if (client_table_insert(&server->contexts, client->info->fd, client) < 0) {
+        LOG_ERROR("Error inserting client context into hash table");
+        goto error_disconnect;
+    }
+
+    // The input and output buffers are part of the pooled context, no allocation is needed.
+
+    // Start receiving data into the input buffer with the io_uring engine.
+    if (server->uring != NULL && uring_attach(server, client) < 0) {
+        LOG_ERROR("Error attaching client to io_uring engine");
+        goto error_unregister;
+    }
+
+    metrics_add(&server->metrics, AS_COUNTER_ACCEPTS, 1);
+
+    return client;
+
+error_unregister: // GOTO: Unregister the client and continue to disconnect it.
+    remove_event(server->polled, client->info->fd);
+    (void) client_table_remove(&server->contexts, client->info->fd);
+
+error_disconnect: // GOTO: Disconnect the client and free resources.
+    client_close(client->info);
+
+error_free: // GOTO: Return the client context to the pool.
+    client_put(server, client);
+
+error: // GOTO: Return NULL on error.
+    return NULL;
+}
+
+size_t as_accept_batch (struct server_context *server, event_callback_t handler, size_t max) {
+
+    assert(server && handler);
+
+    const size_t limit = (max > 0) ? max : AS_ACCEPT_BATCH;
+    size_t accepted = 0;
+
+    // Drain the accept queue until it is empty or the cap is reached, so that other events are not starved.
+    while (accepted < limit && as_accept(server, handler) != NULL) {
+        accepted++;
+    }
+
+    return accepted;
+}
+
+/// @brief Process the state of the client connection.
+/// @param client The client struct.
+/// @return 0 on success, -1 on failure.
+void as_disconnect (struct server_context *server, struct client_context *client) {
+
+    assert(server && client);
+
+    // The client might be disconnected more than once during the same iteration.
+    if (client->flags & CLIENT_CLOSING) {
+        return;
+    }
+
+    client->flags |= CLIENT_CLOSING;
+    metrics_add(&server->metrics, AS_COUNTER_DISCONNECTS, 1);
+
+    // The deadlines must not fire for a released context.
+    for (size_t i = 0; i < AS_DEADLINES; i++) {
+        timer_cancel(&server->timers, &client->deadlines[i]);
+    }
+
+    // Zero-copy sends still reference the output ring, the socket lingers until the kernel released them.
+    if (zerocopy_inflight(client)) {
+        (void) shutdown(client->info->fd, SHUT_WR);
+        (void) add_event(server->polled, client->info->fd, 0);
+    }
+    else {
+        remove_event(server->polled, client->info->fd);
+    }
+
+    // Remove the client context from the hash table.
+    (void) client_table_remove(&server->contexts, client->info->fd);
+
+    // Requests of the io_uring engine still reference the client, release it once they complete.
+    if (server->uring != NULL) {
+        uring_detach(server, client);
+    }
+
+    // Handlers dispatched later in the same iteration, pending completions or watermark reports might still reference the client.
+    if (server->uring != NULL || server->dispatching || client->pending > 0 || (client->flags & CLIENT_PAUSE_QUEUED)
+        || zerocopy_inflight(client)) {
+        client->next = server->closing;
+        server->closing = client;
+        return;
+    }
+
+    // Close the client socket and destroy the client context.
+    client_free(client);
+}
+
+void as_sync_events (struct client_context *client) {
+
+    assert(client && client->server);
+
+    if (client->flags & CLIENT_CLOSING) {
+        return;
+    }
+
+    client_watermark(client);
+
+    // The io_uring engine has no readiness interest, sends are submitted directly.
+    if (client->server->uring != NULL) {
+        return;
+    }
+
+    // The flush at the end of the iteration arms the write interest if the data does not fit.
+    if (client->server->dispatching && (client->server->options & AS_OPT_DEFER_FLUSH) && output_pending(client)) {
+        client_mark_dirty(client);
+        return;
+    }
+
+    const short events = client_interest(client);
+
+    if (events == client->events) {
+        return;
+    }
+
+    if (add_event(client->server->polled, client->info->fd, events) < 0) {
+        LOG_ERROR("Error updating client events");
+        return;
+    }
+
+    client->events = events;
+}
+
+int as_set_watermarks (struct client_context *client, size_t high, size_t low) {
+
+    assert(client && client->server);
+
+    low = (low > 0) ? low : high / 2;
+
+    if (high > 0 && low >= high) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    client->output_high = high;
+    client->output_low = low;
+
+    // The client is paused or resumed right away if its output is already beyond the new watermarks.
+    as_sync_events(client);
+
+    return 0;
+}
+
+void as_complete (struct as_completion *completion) {
+
+    assert(completion && completion->client && completion->client->server);
+
+    struct server_context *server = completion->client->server;
+
+    mpsc_push(&server->completions, &completion->node);
+    as_notify(server);
+}
+
+/// @brief Expire a deadline of the client and call the handler with the matching AS_EVENT_TIMEOUT event.
+/// @param timer The deadline timer, embedded in client->deadlines.
+/// @param data User data passed to as_poll().
+static void client_expire (struct as_timer *timer, void *data) {
+
+    struct client_context *client = (struct client_context *) timer->arg;
+    struct server_context *server = client->server;
+    int event = 0;
+
+    switch ((enum as_deadline) (timer - client->deadlines)) {
+        case AS_DEADLINE_IDLE:
+            // Events only record their time, the idle timer is pushed back lazily once it expires.
+            if (client->active + client->idle_timeout > server->timers.now) {
+                timer_arm(&server->timers, timer, client->active + client->idle_timeout);
+                return;
+            }
+            event = AS_EVENT_IDLE;
+            break;
+        case AS_DEADLINE_READ:
+            event = AS_EVENT_READ_TIMEOUT;
+            break;
+        default:
+            // The output might have been drained without an event of the client, e.g. by iobuff_send().
+            if (!output_pending(client)) {
+                return;
+            }
+            event = AS_EVENT_WRITE_TIMEOUT;
+            break;
+    }
 
-error:
-    return retvalue;
+    client->event_handler(client, event, data);
+
+    if (client->flags & CLIENT_CLOSING) {
+        return;
+    }
+
+    if (server->uring != NULL) {
+        if (!iobuff_empty(client->output)) {
+            (void) iobuff_send(client, client->output);
+        }
+    }
+    else {
+        as_sync_events(client);
+    }
 }
 
-struct client_context *as_accept (struct server_context *server, event_callback_t handler) {
+/// @brief Queue the message and wake up the loop.
+/// @param server The server context.
+/// @param msg The message, freed if it cannot be queued.
+/// @return 0 on success, -1 if the queue is full.
+static int post_push (struct server_context *server, struct post_msg *msg) {
 
-    assert(server && handler);
-    
-    struct client_context *client;
+    if (!mpsc_ring_push(server->posts, msg)) {
+        free(msg);
+        errno = EAGAIN;
+        return -1;
+    }
 
-    if ((client = client_alloc()) == NULL) {
-        LOG_ERROR("Error allocating memory for client context");
-        goto error;
+    as_notify(server);
+
+    return 0;
+}
+
+/// @brief Process the messages posted by other threads, at most one queue capacity per wakeup.
+/// @param server The server context.
+static void post_drain (struct server_context *server) {
+
+    struct post_msg *msg = NULL;
+
+    for (size_t processed = 0; processed <= server->posts->mask; processed++) {
+
+        if ((msg = mpsc_ring_pop(server->posts)) == NULL) {
+            return;
+        }
+
+        if (msg->callback != NULL) {
+            msg->callback(server, msg->arg);
+            free(msg);
+            continue;
+        }
+
+        // The low bits of the identifier are the descriptor, the generation tells a reused one apart.
+        struct client_context *client = as_get_client(server, (int) (uint32_t) msg->id);
+
+        if (client != NULL && client->id == msg->id && !(client->flags & CLIENT_CLOSING)) {
+
+            if (iobuff_append(client->output, msg->data, msg->length, true) < msg->length) {
+                LOG_ERROR("Error appending posted data into output buffer");
+            }
+
+            // Flushed right away, the io_uring engine only queues the buffer for the batched submission.
+            (void) iobuff_send(client, client->output);
+        }
+
+        free(msg);
     }
 
-    client->event_handler = handler;
+    // Leave the rest for the next iteration, so that the other events are not starved.
+    as_notify(server);
+}
 
-    if (server_accept(&server->info, client->info) < 0) {
-        goto error_free;
+int as_post (struct server_context *server, uint64_t id, const void *data, size_t length) {
+
+    assert(server && (data || length == 0));
+
+    struct post_msg *msg = NULL;
+
+    if ((msg = malloc(sizeof(*msg) + length)) == NULL) {
+        LOG_ERROR("Error allocating memory for posted data");
+        return -1;
     }
 
-    // Get the file descriptor flags to avoid overwriting them.
-    int get_flags = 0;
+    msg->id = id;
+    msg->callback = NULL;
+    msg->arg = NULL;
+    msg->length = length;
 
-    if ((get_flags = fcntl(client->info->fd, F_GETFL, 0)) < 0) {
-        LOG_ERROR("Error getting file descriptor flags");
-        goto error_disconnect;
+    if (length > 0) {
+        memcpy(msg->data, data, length);
     }
 
-    // Update the file descriptor flags.
-    if (fcntl(client->info->fd, F_SETFL, get_flags | O_NONBLOCK) < 0) {
-        LOG_ERROR("Error setting file descriptor flags");
-        goto error_disconnect;
+    return post_push(server, msg);
+}
+
+int as_post_task (struct server_context *server, post_callback_t callback, void *arg) {
+
+    assert(server && callback);
+
+    struct post_msg *msg = NULL;
+
+    if ((msg = malloc(sizeof(*msg))) == NULL) {
+        LOG_ERROR("Error allocating memory for posted callback");
+        return -1;
     }
 
-    if (add_event(server->polled, client->info->fd, POLLIN | POLLOUT | POLLHUP) < 0) {
-        LOG_ERROR("Error adding event to pollfds");
-        goto error_disconnect;
+    msg->id = 0;
+    msg->callback = callback;
+    msg->arg = arg;
+    msg->length = 0;
+
+    return post_push(server, msg);
+}
+
+int as_set_deadline (struct client_context *client, enum as_deadline kind, int timeout) {
+
+    assert(client && client->server && kind < AS_DEADLINES);
+
+    struct timer_wheel *timers = &client->server->timers;
+    struct as_timer *timer = &client->deadlines[kind];
+
+    if (timeout < 0) {
+
+        if (kind == AS_DEADLINE_IDLE) {
+            client->idle_timeout = 0;
+        }
+
+        timer_cancel(timers, timer);
+        return 0;
     }
 
-    if (htable_insert(server->contexts, &client->info->fd, client) < 0) {
-        LOG_ERROR("Error inserting client context into hash table");
-        goto error_disconnect;
+    if (client->flags & CLIENT_CLOSING) {
+        errno = EINVAL;
+        return -1;
     }
 
-    // Initialize the input and output buffers.
-    if ((client->input = iobuff_alloc(BUFFER_SIZE)) == NULL) {
-        LOG_ERROR("Error allocating memory for input buffer");
-        goto error_in_buffer;
+    if (kind == AS_DEADLINE_IDLE) {
+        client->idle_timeout = (unsigned int) timeout;
+        client->active = timers->now;
+    }
+
+    timer->callback = client_expire;
+    timer->arg = client;
+    timer_arm(timers, timer, timers->now + (uint64_t) timeout);
+
+    return 0;
+}
+
+void as_add_timer (struct server_context *server, struct as_timer *timer, int delay, timer_callback_t callback, void *arg) {
+
+    assert(server && timer && callback && delay >= 0);
+
+    timer->callback = callback;
+    timer->arg = arg;
+    timer_arm(&server->timers, timer, server->timers.now + (uint64_t) delay);
+}
+
+void as_cancel_timer (struct server_context *server, struct as_timer *timer) {
+
+    assert(server && timer);
+
+    timer_cancel(&server->timers, timer);
+}
+
+int as_next_timeout (struct server_context *server) {
+
+    assert(server && server->polled);
+
+    // Watermark crossings of the last flush are reported without waiting.
+    if (server->paused != NULL) {
+        return 0;
     }
 
-    client->input->size = BUFFER_SIZE;
+    const int timeout = server->polled->timeout;
+    const int next = timer_next(&server->timers, timer_now());
 
-    if ((client->output = iobuff_alloc(BUFFER_SIZE)) == NULL) {
-        LOG_ERROR("Error allocating memory for output buffer");
-        goto error_out_buffer;
+    if (next >= 0 && (timeout < 0 || next < timeout)) {
+        return next;
     }
 
-    client->output->size = BUFFER_SIZE;
+    return timeout;
+}
 
-    return client;
+void as_touch (struct client_context *client, int events) {
 
-error_out_buffer: // GOTO: Free the output buffer and continue to free the input buffer.
-    iobuff_free(client->output);
+    assert(client && client->server);
 
-error_in_buffer: // GOTO: Free the input buffer and continue to free the client context.
-    iobuff_free(client->input);
+    struct timer_wheel *timers = &client->server->timers;
 
-error_disconnect: // GOTO: Disconnect the client and free resources.
-    client_close(client->info);
+    client->active = timers->now;
 
-error_free: // GOTO: Free memory allocated for the client context.
-    free(client);
+    if (events & POLLIN) {
+        timer_cancel(timers, &client->deadlines[AS_DEADLINE_READ]);
+    }
 
-error: // GOTO: Return NULL on error.
-    return NULL;
+    if (!output_pending(client)) {
+        timer_cancel(timers, &client->deadlines[AS_DEADLINE_WRITE]);
+    }
 }
 
-/// @brief Process the state of the client connection.
-/// @param client The client struct.
-/// @return 0 on success, -1 on failure.
-void as_disconnect (struct server_context *server, struct client_context *client) {
+void as_notify (struct server_context *server) {
 
-    assert(server && client);
+    assert(server);
 
-    // Remove the client from the polled file descriptors.
-    remove_event(server->polled, client->info->fd);
+    // Only the first notification since the last wakeup writes to the descriptor.
+    if (atomic_exchange_explicit(&server->notified, true, memory_order_acq_rel)) {
+        return;
+    }
 
-    // Remove the client context from the hash table.
-    (void) htable_remove(server->contexts, &client->info->fd);
+    const uint64_t value = 1;
 
-    // Close the client socket.
-    client_close(client->info);
+    if (write(server->notify_wfd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        LOG_ERROR("Error writing to wakeup descriptor");
+    }
+}
+
+void as_process_notify (struct server_context *server, void *data) {
+
+    assert(server);
+
+    const uint64_t start = metrics_clock(&server->metrics);
+
+    // Consume the wakeup before the queue is drained, so that later notifications wake the loop again.
+    uint64_t value = 0;
+
+    while (read(server->notify_fd, &value, sizeof(value)) > 0) {}
+
+    atomic_store_explicit(&server->notified, false, memory_order_release);
+
+    struct mpsc_node *node = NULL;
+
+    while ((node = mpsc_pop(&server->completions)) != NULL) {
+
+        struct as_completion *completion = (struct as_completion *) node;
+        struct client_context *client = completion->client;
+
+        client->pending--;
+        completion->done(completion, data);
+
+        // Arm the write interest for whatever the callback appended to the output buffer.
+        if (!(client->flags & CLIENT_CLOSING)) {
+
+            if (server->uring != NULL) {
+                (void) iobuff_send(client, client->output);
+            }
+            else {
+                as_sync_events(client);
+            }
+        }
+    }
+
+    post_drain(server);
 
-    // Destroy the client context.
-    free(client);
+    metrics_record(&server->metrics, AS_HANDLER_NOTIFY, start);
+}
+
+/// @brief Expire the timers due by the given time and record the expiry in the metrics.
+/// @param server The server context.
+/// @param now The current time in milliseconds.
+/// @param data User data propagated to the timer callbacks.
+static void advance_timers (struct server_context *server, uint64_t now, void *data) {
+
+    const uint64_t start = metrics_clock(&server->metrics);
+    const size_t expired = timer_advance(&server->timers, now, data);
+
+    // Iterations without expired timers would flood the histogram with the cost of reading the clock.
+    if (expired > 0) {
+        metrics_add(&server->metrics, AS_COUNTER_TIMERS, expired);
+        metrics_record(&server->metrics, AS_HANDLER_TIMERS, start);
+    }
+}
+
+/// @brief Dispatch the events of a descriptor without a client context, i.e. a listener or the wakeup descriptor.
+/// @param server The server context.
+/// @param event The ready event.
+/// @param data User data propagated to the event handlers.
+static void dispatch_server (struct server_context *server, const struct poll_event *event, void *data) {
+
+    // Another thread woke up the loop.
+    if (event->fd == server->notify_fd) {
+        as_process_notify(server, data);
+        return;
+    }
+
+    // Select the server's events, i.e. incoming connections.
+    if (event->fd == server->info.fd) {
+        const uint64_t start = metrics_clock(&server->metrics);
+        server->event_handler(server, event->revents, data);
+        metrics_record(&server->metrics, AS_HANDLER_SERVER, start);
+        return;
+    }
+
+    struct as_listener *listener = server->listeners;
+
+    while (listener != NULL && listener->info.fd != event->fd) {
+        listener = listener->next;
+    }
+
+    if (listener == NULL) {
+        LOG_ERROR("Error getting context of the polled descriptor");
+        return;
+    }
+
+    // The connections accepted by the handler belong to this listener.
+    server->accepting = &listener->info;
+
+    const uint64_t start = metrics_clock(&server->metrics);
+    listener->handler(server, event->revents, data);
+    metrics_record(&server->metrics, AS_HANDLER_SERVER, start);
+
+    server->accepting = &server->info;
+}
+
+/// @brief Make room for the events of the ready clients in the batch.
+/// @param server The server context.
+/// @param length The number of ready descriptors.
+/// @return The batch, NULL if it cannot be allocated (the handlers of the clients are called instead).
+static struct client_event *batch_reserve (struct server_context *server, size_t length) {
+
+    if (server->batch_length >= length) {
+        return server->batch;
+    }
+
+    struct client_event *batch = NULL;
+
+    if ((batch = realloc(server->batch, length * sizeof(*batch))) == NULL) {
+        LOG_ERROR("Error allocating memory for event batch");
+        return NULL;
+    }
+
+    server->batch = batch;
+    server->batch_length = length;
+
+    return batch;
+}
+
+/// @brief Call the handlers of the clients that crossed a watermark with AS_EVENT_PAUSE or AS_EVENT_RESUME.
+/// @note A client that was paused and resumed again since the last report is not called.
+/// @param server The server context.
+/// @param data User data propagated to the event handlers.
+static void report_watermarks (struct server_context *server, void *data) {
+
+    // The handlers may cross the watermarks again, e.g. by appending once resumed.
+    while (server->paused != NULL) {
+
+        struct client_context *client = server->paused;
+
+        server->paused = client->paused;
+        client->paused = NULL;
+        client->flags &= ~CLIENT_PAUSE_QUEUED;
+
+        if ((client->flags & CLIENT_CLOSING) || !(client->flags & CLIENT_PAUSED) == !(client->flags & CLIENT_PAUSE_REPORTED)) {
+            continue;
+        }
+
+        client->flags ^= CLIENT_PAUSE_REPORTED;
+
+        const uint64_t start = metrics_clock(&server->metrics);
+        client->event_handler(client, (client->flags & CLIENT_PAUSED) ? AS_EVENT_PAUSE : AS_EVENT_RESUME, data);
+        metrics_record(&server->metrics, AS_HANDLER_CLIENT, start);
+
+        if (client->flags & CLIENT_CLOSING) {
+            continue;
+        }
+
+        if (server->uring != NULL) {
+            if (!iobuff_empty(client->output)) {
+                (void) iobuff_send(client, client->output);
+            }
+        }
+        else {
+            as_sync_events(client);
+        }
+    }
 }
 
 int as_poll (struct server_context *server, void* data) {
 
     assert(server);
 
-    // Poll the server socket for incoming connections.
+    // The io_uring engine dispatches completions instead of readiness events.
+    if (server->uring != NULL) {
+        int uring_result = uring_poll(server, data);
+        advance_timers(server, timer_now(), data);
+        report_watermarks(server, data);
+        reap_clients(server);
+        return uring_result;
+    }
+
+    // Wake up in time for the nearest deadline, the configured timeout is restored afterwards.
+    const int timeout = server->polled->timeout;
     int poll_result;
 
-    if ((poll_result = poll_events(server->polled)) < 0) {
+    set_timeout(server->polled, as_next_timeout(server));
+    poll_result = poll_events(server->polled);
+    set_timeout(server->polled, timeout);
+
+    if (poll_result < 0) {
         LOG_ERROR("Error polling file descriptors");
         return -1;
     }
 
-    // Select the server's events, i.e. incoming connections.
-    int server_events = server->polled->fds[0].revents;
+    // The events of this iteration are stamped with the time the wait returned.
+    server->timers.now = timer_now();
 
-    if (server_events) {
-        server->event_handler(server, server_events, data);
-    }
+    metrics_add(&server->metrics, AS_COUNTER_WAKEUPS, 1);
+    metrics_add(&server->metrics, AS_COUNTER_READY, (uint64_t) poll_result);
 
-    // Poll the client sockets for incoming data.
-    for (unsigned int i = 1; i < server->polled->polled; i++) {
+    // Disconnected clients are released after the iteration, once no handler can reference them.
+    server->dispatching = true;
 
-        if (server->polled->fds[i].revents == 0) {
+    // Without a batch the handlers of the clients are called one by one.
+    struct client_event *batch = (server->batch_handler != NULL) ? batch_reserve(server, (size_t) poll_result) : NULL;
+    size_t count = 0;
+
+    // Only the ready descriptors are visited, regardless of the backend.
+    for (int i = 0; i < poll_result; i++) {
+
+        const struct poll_event *event = ready_event(server->polled, i);
+
+        // Skip descriptors removed by an earlier handler of the same iteration.
+        if (!is_polled(server->polled, event->fd)) {
             continue;
         }
 
-        // If there are events on the client socket, process the connection.
-        struct client_context *client = NULL;
-        
-        if ((client = htable_get(server->contexts, &server->polled->fds[i].fd)) == NULL) {
-            LOG_ERROR("Error getting client context from hash table");
+        // The client context is stored next to the descriptor, no hash table lookup is needed.
+        struct client_context *client = (struct client_context *) event->data;
+
+        // Only the clients carry a context, i.e. incoming connections or a wakeup by another thread.
+        if (client == NULL) {
+            dispatch_server(server, event, data);
+            continue;
+        }
+
+        int revents = event->revents;
+
+        // A disconnected client is only polled for the completions of its zero-copy sends, see as_disconnect().
+        if (client->flags & CLIENT_CLOSING) {
+
+            // A hang-up or an error ends the connection, the kernel purges the sends that were not completed.
+            if (zerocopy_complete(client) < 0 || (revents & POLLHUP) || !zerocopy_inflight(client)) {
+                client->zerocopy.acked = client->zerocopy.next;
+                client->zerocopy.pending = 0;
+                remove_event(server->polled, event->fd);
+            }
+
+            continue;
+        }
+
+        // Completions of zero-copy sends are queued on the error queue of the socket, which raises POLLERR.
+        if ((revents & POLLERR) && zerocopy_inflight(client) && zerocopy_complete(client) == 0) {
+
+            revents &= ~POLLERR;
+
+            // Like a drained send of the io_uring engine, the handler sees POLLOUT once nothing is left to hand over.
+            if (!output_pending(client)) {
+                revents |= POLLOUT;
+            }
+
+            if (revents == 0) {
+                as_sync_events(client);
+                continue;
+            }
+        }
+
+        // Receive the incoming data into the input buffer on behalf of the handler.
+        if ((server->options & AS_OPT_RECV) && (revents & POLLIN)) {
+
+            const ssize_t received = iobuff_recv(client, client->input);
+
+            if (received > 0 || (received < 0 && errno == ENOBUFS)) {
+                revents |= AS_EVENT_DATA;
+            }
+            else if (received == 0) {
+                revents |= POLLHUP;
+            }
+            else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                revents |= POLLERR;
+            }
+        }
+
+        // Continue the transmission of the queued entries, the handler only sees the drained state.
+        if ((revents & POLLOUT) && client->chunks != NULL && as_flush(client) < 0) {
+            revents |= POLLERR;
+        }
+
+        as_touch(client, revents);
+
+        // The batch handler is called once the events of all ready clients are collected.
+        if (batch != NULL) {
+            batch[count].client = client;
+            batch[count].events = revents;
+            count++;
             continue;
         }
 
+        const uint64_t start = metrics_clock(&server->metrics);
+
         // Call the client event handler to process the connection, no need to check for NULL.
-        client->event_handler(client, server->polled->fds[i].revents, data);
+        client->event_handler(client, revents, data);
+
+        metrics_record(&server->metrics, AS_HANDLER_CLIENT, start);
+
+        // Arm or disarm the write interest depending on what the handler left in the output buffer.
+        as_sync_events(client);
+
+        // Drained buffers hand their storage back to the pool, idle clients hold none.
+        iobuff_release(client->input);
+        iobuff_release(client->output);
+    }
+
+    if (count > 0) {
+
+        const uint64_t start = metrics_clock(&server->metrics);
+        server->batch_handler(server, batch, count, data);
+        metrics_record(&server->metrics, AS_HANDLER_BATCH, start);
+
+        // The clients disconnected by the batch are skipped by the synchronization.
+        for (size_t i = 0; i < count; i++) {
+            as_sync_events(batch[i].client);
+            iobuff_release(batch[i].client->input);
+            iobuff_release(batch[i].client->output);
+        }
+    }
+
+    // Expire the deadlines after the events, a client whose data just arrived is not timed out.
+    advance_timers(server, server->timers.now, data);
+
+    // Producers are throttled once the handlers of the iteration are done, crossings of the flush follow next time.
+    report_watermarks(server, data);
+
+    server->dispatching = false;
+    flush_dirty(server);
+    reap_clients(server);
+
+    // The wait timed out, write the pending log records while there is nothing else to do.
+    if (poll_result == 0) {
+        (void) log_flush();
     }
 
     return 0;
 }
 
+void as_metrics_snapshot (const struct server_context *server, struct as_metrics_snapshot *snapshot) {
+
+    assert(server && snapshot);
+
+    metrics_snapshot(&server->metrics, snapshot);
+}
+
+ssize_t as_metrics_send (struct client_context *client, const struct server_context *server) {
+
+    assert(client && server);
+
+    struct as_metrics_snapshot snapshot;
+    char text[4096];
+
+    metrics_snapshot(&server->metrics, &snapshot);
+
+    const size_t length = min(metrics_format(&snapshot, text, sizeof(text)), sizeof(text) - 1);
+
+    if (iobuff_append(client->output, text, length, true) < length) {
+        LOG_ERROR("Error appending metrics to output buffer");
+        return -1;
+    }
+
+    return iobuff_send(client, client->output);
+}
+
 void as_cleanup (struct server_context *server) {
 
     assert(server);
 
+    // Closing the io_uring instance cancels all requests still in flight.
+    uring_destroy(server);
+
+    // Zero-copy sends of lingering clients are not waited for, the sockets are closed now.
+    for (struct client_context *client = server->closing; client != NULL; client = client->next) {
+
+        if (zerocopy_inflight(client)) {
+            client->zerocopy.acked = client->zerocopy.next;
+            client->zerocopy.pending = 0;
+            remove_event(server->polled, client->info->fd);
+        }
+    }
+
+    reap_clients(server);
+
+    // The dirty and paused lists may still link clients freed by reap_clients(), they must not outlive them.
+    server->dirty = NULL;
+    server->paused = NULL;
+
     // Destroy the pollfds struct and close all file descriptors being polled.
     if (server->polled != NULL) {
 
@@ -632,5 +3382,20 @@ void as_cleanup (struct server_context *server) {
         destroy_pollfds(server->polled);
     }
 
-    htable_destroy(server->contexts);
+    // The readable end of the wakeup descriptor and the listeners were closed among the polled descriptors.
+    notify_close(server);
+
+    while (server->listeners != NULL) {
+        struct as_listener *next = server->listeners->next;
+        free(server->listeners);
+        server->listeners = next;
+    }
+
+    free(server->batch);
+    server->batch = NULL;
+    server->batch_length = 0;
+
+    client_table_destroy(&server->contexts);
+    client_pool_destroy(server);
+    pool_destroy(&server->buffers);
 }
\ No newline at end of file
@@ -0,0 +1,290 @@
+// ==============================================================================
+//                       Timer Wheel, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides a hierarchical hashed timer wheel with a
+// resolution of one millisecond. Arming and cancelling a timer is O(1), the
+// timers are intrusive and doubly linked into the slots of their level, timers
+// of the upper levels cascade down as the wheel turns. Empty stretches of the
+// wheel are skipped using the occupancy bitmaps of the levels, so the cost of
+// the wheel depends on the number of expiring timers, not on the elapsed time
+// or on the number of armed timers.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // For the monotonic clock, e.g. CLOCK_MONOTONIC.
+#endif // _GNU_SOURCE
+
+#include <time.h>       // For the monotonic clock, e.g. clock_gettime(2).
+#include <limits.h>     // For the INT_MAX limit of the timeout.
+#include <string.h>     // For memory operations, e.g. memset(3).
+#include <assert.h>     // For debugging, e.g. assert(3).
+
+#include "as_timer.h"
+
+// --- Static Function Definitions --- //
+
+/// @brief Get the distance to the first non-empty slot of a level, starting at the given slot.
+/// @param occupied The occupancy bitmap of the level, must not be zero.
+/// @param index The starting slot.
+/// @return The distance in slots, 0 to TIMER_SLOTS - 1.
+static inline unsigned int slot_distance (uint64_t occupied, unsigned int index) {
+
+    const uint64_t rotated = (index == 0) ? occupied : (occupied >> index) | (occupied << (TIMER_SLOTS - index));
+
+    return (unsigned int) __builtin_ctzll(rotated);
+}
+
+/// @brief Get the first millisecond at which the wheel has something to do, i.e. expire or cascade timers.
+/// @param wheel The timer wheel.
+/// @return The millisecond, UINT64_MAX if no timer is armed.
+static uint64_t wheel_next (const struct timer_wheel *wheel) {
+
+    uint64_t next = UINT64_MAX;
+
+    for (unsigned int level = 0; level < TIMER_LEVELS; level++) {
+
+        if (wheel->occupied[level] == 0) {
+            continue;
+        }
+
+        // The slots of the level are processed once the wheel turns to their first millisecond.
+        const unsigned int shift = level * TIMER_SLOT_BITS;
+        const uint64_t current = wheel->tick >> shift;
+        const uint64_t at = (current + slot_distance(wheel->occupied[level], (unsigned int) (current & TIMER_SLOT_MASK))) << shift;
+
+        if (at < next) {
+            next = at;
+        }
+    }
+
+    return next;
+}
+
+/// @brief Link the timer into the slot matching its expiry time.
+/// @param wheel The timer wheel.
+/// @param timer The timer, not linked.
+static void wheel_insert (struct timer_wheel *wheel, struct as_timer *timer) {
+
+    // Expired timers are placed into the slot processed next.
+    const uint64_t expires = (timer->expires < wheel->tick) ? wheel->tick : timer->expires;
+
+    // The lowest level whose slots can tell the expiry time apart from the current one.
+    unsigned int level = 0;
+
+    while (level < TIMER_LEVELS - 1 && (expires >> (level * TIMER_SLOT_BITS)) - (wheel->tick >> (level * TIMER_SLOT_BITS)) >= TIMER_SLOTS) {
+        level++;
+    }
+
+    uint64_t position = expires >> (level * TIMER_SLOT_BITS);
+
+    // Timers beyond the range of the wheel wait in the last slot of the top level and cascade again.
+    if (position - (wheel->tick >> (level * TIMER_SLOT_BITS)) >= TIMER_SLOTS) {
+        position = (wheel->tick >> (level * TIMER_SLOT_BITS)) + TIMER_SLOT_MASK;
+    }
+
+    const unsigned int index = (unsigned int) (position & TIMER_SLOT_MASK);
+    struct as_timer **slot = &wheel->slots[level][index];
+
+    timer->slot = level * TIMER_SLOTS + index;
+    timer->next = *slot;
+    timer->pprev = slot;
+
+    if (*slot != NULL) {
+        (*slot)->pprev = &timer->next;
+    }
+
+    *slot = timer;
+    wheel->occupied[level] |= 1ULL << index;
+}
+
+/// @brief Unlink the timer from its slot.
+/// @param wheel The timer wheel.
+/// @param timer The timer, linked.
+static void wheel_remove (struct timer_wheel *wheel, struct as_timer *timer) {
+
+    *timer->pprev = timer->next;
+
+    if (timer->next != NULL) {
+        timer->next->pprev = timer->pprev;
+    }
+
+    const unsigned int level = timer->slot / TIMER_SLOTS;
+    const unsigned int index = timer->slot % TIMER_SLOTS;
+
+    if (wheel->slots[level][index] == NULL) {
+        wheel->occupied[level] &= ~(1ULL << index);
+    }
+
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/// @brief Detach all timers of a slot.
+/// @param wheel The timer wheel.
+/// @param level The level of the slot.
+/// @param index The index of the slot.
+/// @return The detached list, linked by next.
+static struct as_timer *wheel_detach (struct timer_wheel *wheel, unsigned int level, unsigned int index) {
+
+    struct as_timer *list = wheel->slots[level][index];
+
+    wheel->slots[level][index] = NULL;
+    wheel->occupied[level] &= ~(1ULL << index);
+
+    return list;
+}
+
+// --- Function Definitions --- //
+
+/// @brief Get the current time of the monotonic clock in milliseconds.
+uint64_t timer_now (void) {
+
+    struct timespec now;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000ULL + (uint64_t) now.tv_nsec / 1000000ULL;
+}
+
+/// @brief Initialize an empty timer wheel.
+void timer_wheel_init (struct timer_wheel *wheel, uint64_t now) {
+
+    assert(wheel);
+
+    memset(wheel, 0, sizeof(*wheel));
+
+    wheel->tick = now;
+    wheel->now = now;
+}
+
+/// @brief Arm the timer, an already armed timer is re-armed.
+void timer_arm (struct timer_wheel *wheel, struct as_timer *timer, uint64_t expires) {
+
+    assert(wheel && timer && timer->callback);
+
+    if (timer_armed(timer)) {
+        wheel_remove(wheel, timer);
+        wheel->count--;
+    }
+
+    timer->expires = expires;
+    wheel_insert(wheel, timer);
+    wheel->count++;
+}
+
+/// @brief Cancel the timer, does nothing if the timer is not armed.
+void timer_cancel (struct timer_wheel *wheel, struct as_timer *timer) {
+
+    assert(wheel && timer);
+
+    if (!timer_armed(timer)) {
+        return;
+    }
+
+    wheel_remove(wheel, timer);
+    wheel->count--;
+}
+
+/// @brief Expire all timers due by the given time and call their callbacks.
+size_t timer_advance (struct timer_wheel *wheel, uint64_t now, void *data) {
+
+    assert(wheel);
+
+    size_t expired = 0;
+    uint64_t tick;
+
+    wheel->now = now;
+
+    // Jump straight to the next millisecond with work, nothing happens in between.
+    while ((tick = wheel_next(wheel)) <= now) {
+
+        wheel->tick = tick;
+
+        // Cascade the slots of the upper levels whose range starts at this millisecond.
+        for (unsigned int level = 1; level < TIMER_LEVELS && (tick & ((1ULL << (level * TIMER_SLOT_BITS)) - 1)) == 0; level++) {
+
+            struct as_timer *timer = wheel_detach(wheel, level, (unsigned int) ((tick >> (level * TIMER_SLOT_BITS)) & TIMER_SLOT_MASK));
+
+            while (timer != NULL) {
+                struct as_timer *next = timer->next;
+                wheel_insert(wheel, timer);
+                timer = next;
+            }
+        }
+
+        // The expiring timers stay linked in a local list, a callback may cancel the ones still in it.
+        struct as_timer *expiring = wheel_detach(wheel, 0, (unsigned int) (tick & TIMER_SLOT_MASK));
+        struct as_timer *timer = NULL;
+
+        if (expiring != NULL) {
+            expiring->pprev = &expiring;
+        }
+
+        // Timers armed by the callbacks expire at the next millisecond at the earliest.
+        wheel->tick = tick + 1;
+
+        while ((timer = expiring) != NULL) {
+
+            expiring = timer->next;
+
+            if (expiring != NULL) {
+                expiring->pprev = &expiring;
+            }
+
+            // Detached from the slot already, only the links are reset.
+            timer->next = NULL;
+            timer->pprev = NULL;
+            wheel->count--;
+
+            expired++;
+            timer->callback(timer, data);
+        }
+    }
+
+    if (wheel->tick <= now) {
+        wheel->tick = now + 1;
+    }
+
+    return expired;
+}
+
+/// @brief Get the time until the wheel has to be advanced next.
+int timer_next (const struct timer_wheel *wheel, uint64_t now) {
+
+    assert(wheel);
+
+    if (wheel->count == 0) {
+        return -1;
+    }
+
+    const uint64_t next = wheel_next(wheel);
+
+    if (next <= now) {
+        return 0;
+    }
+
+    return (next - now > (uint64_t) INT_MAX) ? INT_MAX : (int) (next - now);
+}
@@ -0,0 +1,899 @@
+// ==============================================================================
+//                       io_uring Engine, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides a completion-based I/O engine for the
+// asynchronous TCP server built on top of the Linux io_uring interface. The
+// listener is served by accept requests bounded by the free slots of the
+// accept queue, clients receive data through recv requests into a ring of
+// provided buffers, bounded by the free space of their input buffers, and the
+// output buffers are flushed with batched sendmsg submissions. Completions are
+// dispatched to the regular event handlers of the server and the clients.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // For Linux specific interfaces, e.g. syscall(2), MAP_POPULATE.
+#endif // _GNU_SOURCE
+
+#include "as_server.h"
+
+#ifdef __linux__
+
+// --- Linux Libraries --- //
+
+#include <errno.h>          // For error codes, e.g. EINTR, ENOBUFS.
+#include <time.h>           // For the timespec struct of the wait timeout.
+#include <sys/mman.h>       // For mapping the rings, e.g. mmap(2).
+#include <sys/syscall.h>    // For the raw io_uring system call numbers.
+#include <linux/io_uring.h> // For the io_uring interface definitions.
+
+// --- Constants and Macros --- //
+
+#define URING_BUFFER_GROUP  0U      // Buffer group identifier of the provided receive buffers.
+
+/// @brief Operation tags stored in the low bits of the submission user data.
+/// @note Client contexts are at least 8-byte aligned, so the low bits are free.
+#define URING_OP_ACCEPT     0ULL    // Accept on the listener.
+#define URING_OP_RECV       1ULL    // Recv of a client.
+#define URING_OP_SEND       2ULL    // Sendmsg of the client output buffer.
+#define URING_OP_IGNORE     3ULL    // Completion without a context, e.g. cancellation.
+#define URING_OP_NOTIFY     4ULL    // Multishot poll of the wakeup descriptor.
+#define URING_OP_MASK       7ULL
+
+// --- Type Definitions --- //
+
+/// @brief Submission queue ring mapped from the kernel.
+struct uring_sq {
+    unsigned int        *khead;     // Kernel consumer head.
+    unsigned int        *ktail;     // Producer tail.
+    unsigned int        mask;       // Ring mask.
+    unsigned int        entries;    // Number of entries.
+    struct io_uring_sqe *sqes;      // Submission queue entries.
+    unsigned int        tail;       // Local producer tail, published on submit.
+    unsigned int        submitted;  // Local tail of the last submission.
+    void                *ring;      // Mapped ring memory.
+    size_t              ring_size;  // Size of the mapped ring memory.
+    size_t              sqes_size;  // Size of the mapped submission entries.
+};
+
+/// @brief Completion queue ring mapped from the kernel.
+struct uring_cq {
+    unsigned int        *khead;     // Consumer head.
+    unsigned int        *ktail;     // Kernel producer tail.
+    unsigned int        mask;       // Ring mask.
+    struct io_uring_cqe *cqes;      // Completion queue entries.
+    void                *ring;      // Mapped ring memory, NULL if shared with the submission ring.
+    size_t              ring_size;  // Size of the mapped ring memory.
+};
+
+/// @brief State of the io_uring engine of a server context.
+struct as_uring {
+    int                     fd;             // io_uring instance.
+    unsigned int            features;       // Features reported by the kernel.
+    struct uring_sq         sq;             // Submission queue.
+    struct uring_cq         cq;             // Completion queue.
+    struct io_uring_buf_ring *bufs;         // Provided buffer ring.
+    char                    *buffers;       // Memory backing the provided buffers.
+    unsigned short          bufs_tail;      // Local tail of the provided buffer ring.
+    int                     accepted[URING_ACCEPT_QUEUE]; // Accepted, not yet claimed descriptors.
+    unsigned int            accept_head;    // Producer offset of the accept queue.
+    unsigned int            accept_tail;    // Consumer offset of the accept queue.
+    unsigned int            accept_inflight; // Accept requests in flight, each one owns a free slot of the queue.
+    bool                    notify_armed;   // Multishot poll of the wakeup descriptor is active.
+};
+
+// --- Static function definitions, system calls --- //
+
+static int sys_uring_setup (unsigned int entries, struct io_uring_params *params) {
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_uring_enter (int fd, unsigned int submit, unsigned int wait, unsigned int flags, void *arg, size_t size) {
+    return (int) syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, size);
+}
+
+static int sys_uring_register (int fd, unsigned int opcode, void *arg, unsigned int count) {
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+// --- Static function definitions, rings --- //
+
+/// @brief Map the submission and completion rings of the io_uring instance.
+/// @return 0 on success, -1 on failure.
+static int uring_map (struct as_uring *uring, const struct io_uring_params *params) {
+
+    struct uring_sq *sq = &uring->sq;
+    struct uring_cq *cq = &uring->cq;
+
+    sq->ring_size = params->sq_off.array + params->sq_entries * sizeof(unsigned int);
+    cq->ring_size = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+
+    // Both rings can share a single mapping on any recent kernel.
+    if (uring->features & IORING_FEAT_SINGLE_MMAP) {
+        sq->ring_size = (cq->ring_size > sq->ring_size) ? cq->ring_size : sq->ring_size;
+    }
+
+    sq->ring = mmap(NULL, sq->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING);
+
+    if (sq->ring == MAP_FAILED) {
+        LOG_ERROR("Error mapping io_uring submission ring");
+        sq->ring = NULL;
+        return -1;
+    }
+
+    char *cq_ring = (char *) sq->ring;
+
+    if (!(uring->features & IORING_FEAT_SINGLE_MMAP)) {
+
+        cq->ring = mmap(NULL, cq->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_CQ_RING);
+
+        if (cq->ring == MAP_FAILED) {
+            LOG_ERROR("Error mapping io_uring completion ring");
+            cq->ring = NULL;
+            return -1;
+        }
+
+        cq_ring = (char *) cq->ring;
+    }
+
+    sq->sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+    sq->sqes = mmap(NULL, sq->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQES);
+
+    if (sq->sqes == MAP_FAILED) {
+        LOG_ERROR("Error mapping io_uring submission entries");
+        sq->sqes = NULL;
+        return -1;
+    }
+
+    char *sq_ring = (char *) sq->ring;
+
+    sq->khead = (unsigned int *) (sq_ring + params->sq_off.head);
+    sq->ktail = (unsigned int *) (sq_ring + params->sq_off.tail);
+    sq->mask = *(unsigned int *) (sq_ring + params->sq_off.ring_mask);
+    sq->entries = params->sq_entries;
+    sq->tail = *sq->ktail;
+    sq->submitted = sq->tail;
+
+    // Submission entries are always used in ring order, so the indirection array is the identity.
+    unsigned int *array = (unsigned int *) (sq_ring + params->sq_off.array);
+
+    for (unsigned int idx = 0; idx < sq->entries; idx++) {
+        array[idx] = idx;
+    }
+
+    cq->khead = (unsigned int *) (cq_ring + params->cq_off.head);
+    cq->ktail = (unsigned int *) (cq_ring + params->cq_off.tail);
+    cq->mask = *(unsigned int *) (cq_ring + params->cq_off.ring_mask);
+    cq->cqes = (struct io_uring_cqe *) (cq_ring + params->cq_off.cqes);
+
+    return 0;
+}
+
+/// @brief Unmap the rings of the io_uring instance.
+static void uring_unmap (struct as_uring *uring) {
+
+    if (uring->sq.sqes != NULL) {
+        (void) munmap(uring->sq.sqes, uring->sq.sqes_size);
+    }
+
+    if (uring->cq.ring != NULL) {
+        (void) munmap(uring->cq.ring, uring->cq.ring_size);
+    }
+
+    if (uring->sq.ring != NULL) {
+        (void) munmap(uring->sq.ring, uring->sq.ring_size);
+    }
+}
+
+/// @brief Submit the prepared entries to the kernel and optionally wait for completions.
+/// @param uring The io_uring engine.
+/// @param wait Minimum number of completions to wait for.
+/// @param timeout Wait timeout in milliseconds, -1 to wait indefinitely.
+/// @return The number of submitted entries, -1 on failure.
+static int uring_submit (struct as_uring *uring, unsigned int wait, int timeout) {
+
+    struct uring_sq *sq = &uring->sq;
+
+    // Publish the prepared entries to the kernel.
+    __atomic_store_n(sq->ktail, sq->tail, __ATOMIC_RELEASE);
+
+    const unsigned int pending = sq->tail - sq->submitted;
+    unsigned int flags = (wait > 0) ? IORING_ENTER_GETEVENTS : 0;
+
+    struct __kernel_timespec ts = {
+        .tv_sec = timeout / 1000,
+        .tv_nsec = (timeout % 1000) * 1000000L
+    };
+
+    struct io_uring_getevents_arg arg = {
+        .ts = (unsigned long long) (uintptr_t) &ts
+    };
+
+    void *enter_arg = NULL;
+    size_t enter_size = 0;
+
+    if (wait > 0 && timeout >= 0 && (uring->features & IORING_FEAT_EXT_ARG)) {
+        flags |= IORING_ENTER_EXT_ARG;
+        enter_arg = &arg;
+        enter_size = sizeof(arg);
+    }
+
+    if (pending == 0 && flags == 0) {
+        return 0;
+    }
+
+    int submitted = sys_uring_enter(uring->fd, pending, wait, flags, enter_arg, enter_size);
+
+    if (submitted < 0) {
+
+        // Interrupted or timed out waits are not errors, completions are reaped on the next call.
+        if (errno == EINTR || errno == ETIME || errno == EAGAIN || errno == EBUSY) {
+            return 0;
+        }
+
+        LOG_ERROR("Error entering io_uring");
+        return -1;
+    }
+
+    sq->submitted += (unsigned int) submitted;
+
+    return submitted;
+}
+
+/// @brief Get a free submission queue entry, flushing the queue if it is full.
+/// @return Pointer to the zeroed submission entry, NULL on failure.
+static struct io_uring_sqe *uring_get_sqe (struct as_uring *uring) {
+
+    struct uring_sq *sq = &uring->sq;
+
+    if (sq->tail - __atomic_load_n(sq->khead, __ATOMIC_ACQUIRE) >= sq->entries) {
+
+        if (uring_submit(uring, 0, -1) < 0) {
+            return NULL;
+        }
+
+        if (sq->tail - __atomic_load_n(sq->khead, __ATOMIC_ACQUIRE) >= sq->entries) {
+            LOG_ERROR("Error getting io_uring submission entry: queue full");
+            return NULL;
+        }
+    }
+
+    struct io_uring_sqe *sqe = &sq->sqes[sq->tail & sq->mask];
+    sq->tail++;
+
+    memset(sqe, 0, sizeof(*sqe));
+
+    return sqe;
+}
+
+/// @brief Encode the operation and its context into the submission user data.
+static inline unsigned long long uring_tag (const void *context, unsigned long long op) {
+    return (unsigned long long) (uintptr_t) context | op;
+}
+
+// --- Static function definitions, provided buffers --- //
+
+/// @brief Return a provided buffer to the kernel.
+static void uring_recycle (struct as_uring *uring, unsigned short bid) {
+
+    struct io_uring_buf *buf = &uring->bufs->bufs[uring->bufs_tail & (URING_BUFFER_COUNT - 1)];
+
+    buf->addr = (unsigned long long) (uintptr_t) (uring->buffers + (size_t) bid * URING_BUFFER_SIZE);
+    buf->len = (unsigned int) URING_BUFFER_SIZE;
+    buf->bid = bid;
+
+    uring->bufs_tail++;
+
+    __atomic_store_n(&uring->bufs->tail, uring->bufs_tail, __ATOMIC_RELEASE);
+}
+
+/// @brief Allocate and register the ring of provided receive buffers.
+/// @return 0 on success, -1 on failure.
+static int uring_register_buffers (struct as_uring *uring) {
+
+    const size_t ring_size = URING_BUFFER_COUNT * sizeof(struct io_uring_buf);
+
+    // The buffer ring must be page aligned.
+    void *ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ring == MAP_FAILED) {
+        LOG_ERROR("Error allocating io_uring buffer ring");
+        return -1;
+    }
+
+    if ((uring->buffers = malloc(URING_BUFFER_COUNT * URING_BUFFER_SIZE)) == NULL) {
+        LOG_ERROR("Error allocating io_uring receive buffers");
+        (void) munmap(ring, ring_size);
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg = {
+        .ring_addr = (unsigned long long) (uintptr_t) ring,
+        .ring_entries = URING_BUFFER_COUNT,
+        .bgid = URING_BUFFER_GROUP
+    };
+
+    if (sys_uring_register(uring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        LOG_ERROR("Error registering io_uring buffer ring");
+        free(uring->buffers);
+        uring->buffers = NULL;
+        (void) munmap(ring, ring_size);
+        return -1;
+    }
+
+    uring->bufs = (struct io_uring_buf_ring *) ring;
+    uring->bufs_tail = 0;
+
+    for (unsigned short bid = 0; bid < URING_BUFFER_COUNT; bid++) {
+        uring_recycle(uring, bid);
+    }
+
+    return 0;
+}
+
+// --- Static function definitions, requests --- //
+
+/// @brief Arm accept requests on the listener socket for the free slots of the accept queue.
+/// @note A multishot accept would drain the whole kernel backlog into the queue, the single requests
+/// leave the connections that do not fit in the backlog until as_accept() claimed the queued ones.
+static int uring_arm_accept (struct server_context *server) {
+
+    struct as_uring *uring = server->uring;
+    struct io_uring_sqe *sqe = NULL;
+
+    while (uring->accept_inflight < URING_ACCEPT_BATCH &&
+           uring->accept_head - uring->accept_tail + uring->accept_inflight < URING_ACCEPT_QUEUE) {
+
+        if ((sqe = uring_get_sqe(uring)) == NULL) {
+            return -1;
+        }
+
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = server->info.fd;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = uring_tag(NULL, URING_OP_ACCEPT);
+
+        uring->accept_inflight++;
+    }
+
+    return 0;
+}
+
+/// @brief Arm the multishot poll of the wakeup descriptor of the server.
+static int uring_arm_notify (struct server_context *server) {
+
+    struct as_uring *uring = server->uring;
+    struct io_uring_sqe *sqe = NULL;
+
+    if ((sqe = uring_get_sqe(uring)) == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = server->notify_fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = uring_tag(NULL, URING_OP_NOTIFY);
+
+    uring->notify_armed = true;
+
+    return 0;
+}
+
+/// @brief Arm a recv of the client into the provided buffers, limited to the free space of the input buffer.
+/// @note Nothing is received into a full input buffer, the socket buffer fills up and throttles the peer
+/// until the handler consumed the input and the recv is re-armed.
+static int uring_arm_recv (struct as_uring *uring, struct client_context *client) {
+
+    const struct io_buffer *input = client->input;
+    const size_t size = (input->buffer != NULL) ? input->size : client->server->config.buffer_size;
+    const size_t room = size - (input->head - input->tail);
+
+    if (client->uring.receiving || client->uring.closing) {
+        return 0;
+    }
+
+    client->uring.throttled = (room == 0);
+
+    if (client->uring.throttled) {
+        return 0;
+    }
+
+    struct io_uring_sqe *sqe = NULL;
+
+    if ((sqe = uring_get_sqe(uring)) == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = client->info->fd;
+    sqe->len = (unsigned int) ((room < URING_BUFFER_SIZE) ? room : URING_BUFFER_SIZE);
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = uring_tag(client, URING_OP_RECV);
+
+    client->uring.receiving = true;
+    client->uring.inflight++;
+
+    return 0;
+}
+
+/// @brief Prepare a sendmsg of the pending output of the client.
+static int uring_arm_send (struct as_uring *uring, struct client_context *client) {
+
+    struct io_buffer *buffer = client->output;
+    const size_t length = buffer->head - buffer->tail;
+
+    if (length == 0 || client->uring.sending > 0) {
+        return 0;
+    }
+
+    struct io_uring_sqe *sqe = NULL;
+
+    if ((sqe = uring_get_sqe(uring)) == NULL) {
+        return -1;
+    }
+
+    // Describe both segments of the ring, the second one is empty unless the data wraps around.
+    memset(&client->uring.msg, 0, sizeof(client->uring.msg));
+    client->uring.msg.msg_iov = client->uring.iov;
+    client->uring.msg.msg_iovlen = (size_t) iobuff_data_iov(buffer, client->uring.iov);
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = client->info->fd;
+    sqe->addr = (unsigned long long) (uintptr_t) &client->uring.msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = uring_tag(client, URING_OP_SEND);
+
+    // The kernel may read the data asynchronously, the storage must not move until the send completes.
+    buffer->flags |= IOBUFF_PINNED;
+
+    client->uring.sending = length;
+    client->uring.inflight++;
+
+    return 0;
+}
+
+// --- Static function definitions, completions --- //
+
+/// @brief Process the completion of an accept request.
+static void uring_complete_accept (struct server_context *server, const struct io_uring_cqe *cqe) {
+
+    struct as_uring *uring = server->uring;
+
+    uring->accept_inflight--;
+
+    if (cqe->res < 0) {
+        errno = -cqe->res;
+        LOG_ERROR("Error accepting connection");
+        return;
+    }
+
+    // Keep the descriptor until the server handler claims it with as_accept(), the request owned a free slot.
+    assert(uring->accept_head - uring->accept_tail < URING_ACCEPT_QUEUE);
+
+    uring->accepted[uring->accept_head++ & (URING_ACCEPT_QUEUE - 1)] = cqe->res;
+}
+
+/// @brief Process the completion of a client recv and dispatch the data to the handler.
+static void uring_complete_recv (struct server_context *server, struct client_context *client, const struct io_uring_cqe *cqe, void *data) {
+
+    struct as_uring *uring = server->uring;
+
+    client->uring.inflight--;
+    client->uring.receiving = false;
+
+    // Copy the received data into the free space of the input buffer and hand the provided buffer back immediately.
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+
+        const unsigned short bid = (unsigned short) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+        if (cqe->res > 0 && !client->uring.closing) {
+
+            const char *chunk = uring->buffers + (size_t) bid * URING_BUFFER_SIZE;
+
+            metrics_add(&server->metrics, AS_COUNTER_BYTES_IN, (uint64_t) cqe->res);
+
+            if (iobuff_append(client->input, chunk, (size_t) cqe->res, true) < (size_t) cqe->res) {
+                LOG_ERROR("Error appending received data into input buffer");
+            }
+        }
+
+        uring_recycle(uring, bid);
+    }
+
+    if (client->uring.closing) {
+        return;
+    }
+
+    int events = 0;
+
+    if (cqe->res > 0) {
+        events = POLLIN | AS_EVENT_DATA;
+    }
+    else if (cqe->res == 0) {
+        events = POLLHUP;
+    }
+    else if (cqe->res != -ENOBUFS) {
+        events = POLLERR;
+    }
+
+    // Re-arm the recv unless the peer closed the connection or an error occurred.
+    if (cqe->res > 0 || cqe->res == -ENOBUFS) {
+        if (uring_arm_recv(uring, client) < 0) {
+            events |= POLLERR;
+        }
+    }
+
+    if (events != 0) {
+        as_touch(client, events);
+
+        const uint64_t start = metrics_clock(&server->metrics);
+        client->event_handler(client, events, data);
+        metrics_record(&server->metrics, AS_HANDLER_CLIENT, start);
+    }
+}
+
+/// @brief Process the completion of a client send.
+static void uring_complete_send (struct server_context *server, struct client_context *client, const struct io_uring_cqe *cqe, void *data) {
+
+    const size_t sending = client->uring.sending;
+
+    client->uring.inflight--;
+    client->uring.sending = 0;
+    iobuff_unpin(client->output);
+
+    if (client->uring.closing) {
+        return;
+    }
+
+    if (cqe->res < 0) {
+        errno = -cqe->res;
+        LOG_ERROR("Error sending data to client");
+        client->event_handler(client, POLLERR, data);
+        return;
+    }
+
+    client->output->tail += (size_t) cqe->res;
+
+    // The engine has no readiness interest, only the watermarks of the output are tracked.
+    as_sync_events(client);
+
+    metrics_add(&server->metrics, AS_COUNTER_BYTES_OUT, (uint64_t) cqe->res);
+    metrics_add(&server->metrics, AS_COUNTER_PARTIAL_SENDS, (size_t) cqe->res < sending);
+
+    // Continue with the remaining data, notify the handler once the output buffer is drained.
+    if (!iobuff_empty(client->output)) {
+        if (uring_arm_send(server->uring, client) < 0) {
+            client->event_handler(client, POLLERR, data);
+        }
+        return;
+    }
+
+    as_touch(client, POLLOUT);
+
+    const uint64_t start = metrics_clock(&server->metrics);
+    client->event_handler(client, POLLOUT, data);
+    metrics_record(&server->metrics, AS_HANDLER_CLIENT, start);
+}
+
+// --- Function definitions --- //
+
+/// @brief Set up the io_uring instance and arm the accept requests on the listener.
+int uring_create (struct server_context *server) {
+
+    assert(server && server->info.fd >= 0);
+
+    struct as_uring *uring = NULL;
+
+    if ((uring = calloc(1U, sizeof(*uring))) == NULL) {
+        LOG_ERROR("Error allocating memory for io_uring engine");
+        return -1;
+    }
+
+    // Multishot requests produce many completions per submission, so the completion queue is larger.
+    struct io_uring_params params;
+
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = URING_ENTRIES * 16U;
+
+    if ((uring->fd = sys_uring_setup(URING_ENTRIES, &params)) < 0 && errno == EINVAL) {
+
+        // Older kernels do not know the optional setup flags.
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = URING_ENTRIES * 16U;
+
+        uring->fd = sys_uring_setup(URING_ENTRIES, &params);
+    }
+
+    if (uring->fd < 0) {
+        LOG_ERROR("Error setting up io_uring instance");
+        free(uring);
+        return -1;
+    }
+
+    uring->features = params.features;
+
+    if (uring_map(uring, &params) < 0) {
+        goto error;
+    }
+
+    if (uring_register_buffers(uring) < 0) {
+        goto error;
+    }
+
+    server->uring = uring;
+
+    if (uring_arm_accept(server) < 0 || uring_arm_notify(server) < 0) {
+        server->uring = NULL;
+        goto error;
+    }
+
+    return 0;
+
+error: // GOTO: Release the partially initialized engine.
+    if (uring->bufs != NULL) {
+        (void) munmap(uring->bufs, URING_BUFFER_COUNT * sizeof(struct io_uring_buf));
+    }
+
+    free(uring->buffers);
+    uring_unmap(uring);
+    (void) close(uring->fd);
+    free(uring);
+
+    return -1;
+}
+
+/// @brief Tear down the io_uring instance and release the provided buffers.
+void uring_destroy (struct server_context *server) {
+
+    assert(server);
+
+    struct as_uring *uring = server->uring;
+
+    if (uring == NULL) {
+        return;
+    }
+
+    // Close the descriptors that were accepted but never claimed.
+    while (uring->accept_tail != uring->accept_head) {
+        (void) close(uring->accepted[uring->accept_tail++ & (URING_ACCEPT_QUEUE - 1)]);
+    }
+
+    // Closing the instance cancels every request still in flight.
+    uring_unmap(uring);
+    (void) close(uring->fd);
+
+    (void) munmap(uring->bufs, URING_BUFFER_COUNT * sizeof(struct io_uring_buf));
+    free(uring->buffers);
+    free(uring);
+
+    server->uring = NULL;
+}
+
+/// @brief Claim a descriptor accepted by the engine.
+int uring_accept (struct server_context *server) {
+
+    assert(server && server->uring);
+
+    struct as_uring *uring = server->uring;
+
+    if (uring->accept_tail == uring->accept_head) {
+        return -1;
+    }
+
+    return uring->accepted[uring->accept_tail++ & (URING_ACCEPT_QUEUE - 1)];
+}
+
+/// @brief Start receiving data for a newly accepted client.
+int uring_attach (struct server_context *server, struct client_context *client) {
+
+    assert(server && server->uring && client);
+
+    memset(&client->uring, 0, sizeof(client->uring));
+
+    return uring_arm_recv(server->uring, client);
+}
+
+/// @brief Cancel all requests of a client that is being disconnected, may be called again until it succeeded.
+void uring_detach (struct server_context *server, struct client_context *client) {
+
+    assert(server && server->uring && client);
+
+    client->uring.closing = true;
+
+    if (client->uring.inflight == 0 || client->uring.cancelled) {
+        return;
+    }
+
+    struct io_uring_sqe *sqe = NULL;
+
+    // The cancellation is retried when the disconnected clients are reaped.
+    if ((sqe = uring_get_sqe(server->uring)) == NULL) {
+        return;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = client->info->fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = uring_tag(NULL, URING_OP_IGNORE);
+
+    client->uring.cancelled = true;
+}
+
+/// @brief Queue the output buffer of the client for sending.
+ssize_t uring_send (struct client_context *client) {
+
+    assert(client && client->server && client->server->uring);
+
+    if (client->uring.closing) {
+        return -1;
+    }
+
+    as_sync_events(client);
+
+    // The handler may have consumed the input outside of a completion, e.g. in a timer.
+    if (client->uring.throttled && uring_arm_recv(client->server->uring, client) < 0) {
+        return -1;
+    }
+
+    return uring_arm_send(client->server->uring, client);
+}
+
+/// @brief Submit the queued requests, wait for completions and dispatch them to the handlers.
+int uring_poll (struct server_context *server, void *data) {
+
+    assert(server && server->uring);
+
+    struct as_uring *uring = server->uring;
+
+    // Re-arm the accept requests for the slots claimed by as_accept() and the failed ones, e.g. by EMFILE.
+    if (uring_arm_accept(server) < 0) {
+        return -1;
+    }
+
+    if (!uring->notify_armed && uring_arm_notify(server) < 0) {
+        return -1;
+    }
+
+    // Do not block while accepted descriptors are still waiting to be claimed.
+    const bool backlog = uring->accept_tail != uring->accept_head;
+    const int timeout = backlog ? 0 : as_next_timeout(server);
+
+    if (uring_submit(uring, (timeout == 0) ? 0 : 1, timeout) < 0) {
+        return -1;
+    }
+
+    // The completions of this iteration are stamped with the time the wait returned.
+    server->timers.now = timer_now();
+
+    struct uring_cq *cq = &uring->cq;
+    unsigned int head = *cq->khead;
+    bool accepted = false;
+
+    metrics_add(&server->metrics, AS_COUNTER_WAKEUPS, 1);
+    metrics_add(&server->metrics, AS_COUNTER_READY, __atomic_load_n(cq->ktail, __ATOMIC_ACQUIRE) - head);
+
+    while (head != __atomic_load_n(cq->ktail, __ATOMIC_ACQUIRE)) {
+
+        // Copy the entry and release the slot before dispatching, handlers may submit new requests.
+        const struct io_uring_cqe cqe = cq->cqes[head & cq->mask];
+        __atomic_store_n(cq->khead, ++head, __ATOMIC_RELEASE);
+
+        struct client_context *client = (struct client_context *) (uintptr_t) (cqe.user_data & ~URING_OP_MASK);
+
+        switch (cqe.user_data & URING_OP_MASK) {
+            case URING_OP_ACCEPT:
+                uring_complete_accept(server, &cqe);
+                accepted = true;
+                break;
+            case URING_OP_RECV:
+                uring_complete_recv(server, client, &cqe, data);
+                break;
+            case URING_OP_SEND:
+                uring_complete_send(server, client, &cqe, data);
+                break;
+            case URING_OP_NOTIFY:
+                uring->notify_armed = cqe.flags & IORING_CQE_F_MORE;
+                as_process_notify(server, data);
+                break;
+            default:
+                break;
+        }
+
+        // Flush whatever the handler appended to the output buffer, the sends are submitted in one batch.
+        if (client != NULL && !client->uring.closing && !iobuff_empty(client->output)) {
+            (void) uring_arm_send(uring, client);
+        }
+
+        // Resume the recv of a full input buffer once the handler consumed some of it.
+        if (client != NULL && client->uring.throttled && uring_arm_recv(uring, client) < 0) {
+            client->event_handler(client, POLLERR, data);
+        }
+
+        // Drained buffers hand their storage back to the pool of the server, see AS_OPT_LAZY_BUFFERS.
+        if (client != NULL && !client->uring.closing) {
+            iobuff_release(client->input);
+            iobuff_release(client->output);
+        }
+    }
+
+    // Let the server handler claim the accepted descriptors once per batch.
+    if (accepted || backlog) {
+        if (uring->accept_tail != uring->accept_head) {
+            const uint64_t start = metrics_clock(&server->metrics);
+            server->event_handler(server, POLLIN, data);
+            metrics_record(&server->metrics, AS_HANDLER_SERVER, start);
+        }
+    }
+
+    return 0;
+}
+
+#else
+
+// --- Function definitions, unsupported platforms --- //
+
+int uring_create (struct server_context *server) {
+    (void) server;
+    LOG_ERROR("Error setting up io_uring instance: not supported on this platform");
+    return -1;
+}
+
+void uring_destroy (struct server_context *server) {
+    (void) server;
+}
+
+int uring_accept (struct server_context *server) {
+    (void) server;
+    return -1;
+}
+
+int uring_attach (struct server_context *server, struct client_context *client) {
+    (void) server;
+    (void) client;
+    return -1;
+}
+
+void uring_detach (struct server_context *server, struct client_context *client) {
+    (void) server;
+    (void) client;
+}
+
+ssize_t uring_send (struct client_context *client) {
+    (void) client;
+    return -1;
+}
+
+int uring_poll (struct server_context *server, void *data) {
+    (void) server;
+    (void) data;
+    return -1;
+}
+
+#endif // __linux__
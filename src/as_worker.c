@@ -0,0 +1,259 @@
+// ==============================================================================
+//                       Worker Pool, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides a pool of worker threads for the CPU-heavy
+// work of the client handlers, e.g. compression, parsing or cryptography. The
+// loop submits a task tied to a client context, the task runs on one of the
+// workers (idle workers steal queued tasks from the busy ones) and the result is
+// handed back to the loop thread of the client through the lock-free completion
+// queue of its server context, so that the output is still appended to the
+// client's output buffer by the loop thread.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "as_worker.h"
+
+// --- Static Function Definitions --- //
+
+/// @brief Take the oldest task from the queue of the worker.
+/// @param worker The worker to take the task from.
+/// @return The task, NULL if the queue is empty.
+static struct as_task *worker_pop (struct worker *worker) {
+
+    pthread_mutex_lock(&worker->lock);
+
+    struct as_task *task = worker->head;
+
+    if (task != NULL) {
+        worker->head = task->next;
+
+        if (worker->head == NULL) {
+            worker->tail = NULL;
+        }
+    }
+
+    pthread_mutex_unlock(&worker->lock);
+
+    return task;
+}
+
+/// @brief Take a task from the queue of the worker, or steal one from the other workers.
+/// @param pool The worker pool.
+/// @param index The index of the worker.
+/// @return The task, NULL if all queues are empty.
+static struct as_task *worker_take (struct as_worker_pool *pool, size_t index) {
+
+    for (size_t i = 0; i < pool->count; i++) {
+
+        struct as_task *task = worker_pop(&pool->workers[(index + i) % pool->count]);
+
+        if (task != NULL) {
+            atomic_fetch_sub_explicit(&pool->queued, 1, memory_order_relaxed);
+            return task;
+        }
+    }
+
+    return NULL;
+}
+
+/// @brief Thread routine of a worker.
+static void *worker_main (void *arg) {
+
+    struct worker *worker = (struct worker *) arg;
+    struct as_worker_pool *pool = worker->pool;
+    const size_t index = (size_t) (worker - pool->workers);
+
+    for (;;) {
+
+        struct as_task *task = NULL;
+
+        if ((task = worker_take(pool, index)) != NULL) {
+
+            task->work(task);
+
+            // Hand the task back to the loop thread of the client.
+            as_complete(&task->completion);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->idle_lock);
+
+        // The counter is incremented before the submitter checks for sleeping workers, no wakeup is lost.
+        while (atomic_load(&pool->queued) == 0 && atomic_load(&pool->running)) {
+            pool->sleeping++;
+            pthread_cond_wait(&pool->idle, &pool->idle_lock);
+            pool->sleeping--;
+        }
+
+        const bool done = atomic_load(&pool->queued) == 0 && !atomic_load(&pool->running);
+
+        pthread_mutex_unlock(&pool->idle_lock);
+
+        if (done) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+// --- Function Definitions --- //
+
+/// @brief Start the worker threads.
+int as_workers_start (struct as_worker_pool *pool, size_t count) {
+
+    assert(pool);
+
+    memset(pool, 0, sizeof(*pool));
+
+    if (count == 0) {
+        const long online = sysconf(_SC_NPROCESSORS_ONLN);
+        count = (online > 0) ? (size_t) online : 1U;
+    }
+
+    if ((pool->workers = calloc(count, sizeof(*pool->workers))) == NULL) {
+        LOG_ERROR("Error allocating memory for workers");
+        return -1;
+    }
+
+    atomic_init(&pool->next, 0);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->running, true);
+
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    // The workers steal from each other, all queues are set up before the first thread starts.
+    pool->count = count;
+
+    for (size_t i = 0; i < count; i++) {
+        pool->workers[i].pool = pool;
+        pthread_mutex_init(&pool->workers[i].lock, NULL);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+
+        if (pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]) != 0) {
+            LOG_ERROR("Error creating worker thread");
+
+            // Stop the workers started so far, the remaining ones were never created.
+            pthread_mutex_lock(&pool->idle_lock);
+            atomic_store(&pool->running, false);
+            pthread_cond_broadcast(&pool->idle);
+            pthread_mutex_unlock(&pool->idle_lock);
+
+            for (size_t j = 0; j < i; j++) {
+                (void) pthread_join(pool->workers[j].thread, NULL);
+            }
+
+            for (size_t j = 0; j < count; j++) {
+                pthread_mutex_destroy(&pool->workers[j].lock);
+            }
+
+            pthread_cond_destroy(&pool->idle);
+            pthread_mutex_destroy(&pool->idle_lock);
+
+            free(pool->workers);
+
+            pool->workers = NULL;
+            pool->count = 0;
+
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/// @brief Stop the worker threads once the queued tasks are done.
+void as_workers_stop (struct as_worker_pool *pool) {
+
+    assert(pool);
+
+    if (pool->workers == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->idle_lock);
+    atomic_store(&pool->running, false);
+    pthread_cond_broadcast(&pool->idle);
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    for (size_t i = 0; i < pool->count; i++) {
+        (void) pthread_join(pool->workers[i].thread, NULL);
+        pthread_mutex_destroy(&pool->workers[i].lock);
+    }
+
+    pthread_cond_destroy(&pool->idle);
+    pthread_mutex_destroy(&pool->idle_lock);
+
+    free(pool->workers);
+
+    pool->workers = NULL;
+    pool->count = 0;
+}
+
+/// @brief Submit a task tied to the client, must be called on the loop thread of the client.
+int as_submit (struct as_worker_pool *pool, struct client_context *client, struct as_task *task) {
+
+    assert(pool && client && task && task->work && task->completion.done);
+
+    if (pool->count == 0 || !atomic_load(&pool->running)) {
+        return -1;
+    }
+
+    // The client context is kept alive until the completion is processed by the loop.
+    task->completion.client = client;
+    task->next = NULL;
+    client->pending++;
+
+    struct worker *worker = &pool->workers[atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed) % pool->count];
+
+    // Counted before it is published, a worker taking the task right away must not drive the counter below zero.
+    atomic_fetch_add(&pool->queued, 1);
+
+    pthread_mutex_lock(&worker->lock);
+
+    if (worker->tail != NULL) {
+        worker->tail->next = task;
+    }
+    else {
+        worker->head = task;
+    }
+
+    worker->tail = task;
+
+    pthread_mutex_unlock(&worker->lock);
+
+    // Wake up a sleeping worker, busy workers pick up the task when they are done.
+    pthread_mutex_lock(&pool->idle_lock);
+
+    if (pool->sleeping > 0) {
+        pthread_cond_signal(&pool->idle);
+    }
+
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    return 0;
+}
@@ -3,9 +3,11 @@
 // ==============================================================================
 //
 // Description: This library provides basic implementation of a generic hash table
-// using a linked list for collision resolution. To use this library, user must
-// provide a hash function and a comparison function for the keys and optionally
-// a wrapper function for the retrieval of the hash value for type safety.
+// using a linked list for collision resolution, or alternatively open addressing
+// with linear probing in a power-of-two table that grows incrementally. To use
+// this library, user must provide a hash function and a comparison function for
+// the keys and optionally a wrapper function for the retrieval of the hash value
+// for type safety.
 //
 // MIT License
 //
@@ -32,6 +34,15 @@
 
 #include "htable.h"
 
+// --- Constants and Macros --- //
+
+#define HTABLE_MIGRATE_STEP 8U  // Number of slots migrated per operation during a resize.
+
+// --- Static Variables --- //
+
+/// @brief Marker of a removed slot in a table being migrated.
+static char htable_tombstone;
+
 // --- Static Function Definitions --- //
 
 /// @brief Retrieve the hash value for the key.
@@ -51,10 +62,304 @@ static void htable_default_free (void *src) {
     return;
 }
 
+/// @brief Round up the size to the next power of two.
+static size_t htable_roundup (size_t size) {
+
+    size_t new_size = 1;
+
+    while (new_size < size) {
+        new_size <<= 1;
+    }
+
+    return new_size;
+}
+
+// --- Static Function Definitions, node pool --- //
+
+/// @brief Allocate a new slab and push its nodes to the freelist of the pool.
+/// @return 0 on success, -1 on memory allocation failure.
+static int pool_grow (struct htable_pool *pool) {
+
+    struct htable_slab *slab = NULL;
+
+    if ((slab = malloc(sizeof(*slab) + pool->chunk * sizeof(slab->nodes[0]))) == NULL) {
+        return -1;
+    }
+
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+
+    for (size_t idx = 0; idx < pool->chunk; idx++) {
+        slab->nodes[idx].next = pool->free;
+        pool->free = &slab->nodes[idx];
+    }
+
+    return 0;
+}
+
+/// @brief Allocate a hash node, from the pool if the table has one.
+/// @return Pointer to the hash node, NULL on memory allocation failure.
+static struct htable_node *node_alloc (htable_t *table) {
+
+    struct htable_pool *pool = &table->pool;
+
+    if (pool->chunk == 0) {
+        return malloc(sizeof(struct htable_node));
+    }
+
+    if (pool->free == NULL && pool_grow(pool) < 0) {
+        return NULL;
+    }
+
+    struct htable_node *node = pool->free;
+    pool->free = node->next;
+
+    return node;
+}
+
+/// @brief Release a hash node, back to the pool if the table has one.
+static void node_free (htable_t *table, struct htable_node *node) {
+
+    if (table->pool.chunk == 0) {
+        free(node);
+        return;
+    }
+
+    node->next = table->pool.free;
+    table->pool.free = node;
+}
+
+// --- Static Function Definitions, open addressing --- //
+
+/// @brief Check whether the slot holds a key-value pair.
+static inline int slot_live (const struct htable_slot *slot) {
+    return slot->value != NULL && slot->value != (void *) &htable_tombstone;
+}
+
+/// @brief Find the slot of the key in the slot array.
+/// @param slots The slot array.
+/// @param size The size of the slot array, power of two.
+/// @return The index of the slot, or size if the key is not present.
+static size_t slot_find (const htable_t *table, const struct htable_slot *slots, size_t size, unsigned long hash, const void *key) {
+
+    const size_t mask = size - 1;
+
+    // Probe until an empty slot, tombstones only exist in the table being migrated.
+    for (size_t idx = hash & mask; slots[idx].value != NULL; idx = (idx + 1) & mask) {
+        if (slots[idx].hash == hash && slot_live(&slots[idx]) && table->keq(slots[idx].key, key)) {
+            return idx;
+        }
+    }
+
+    return size;
+}
+
+/// @brief Place a key-value pair into the first empty slot of its probe sequence.
+/// @note The key must not be present in the slot array.
+static void slot_place (struct htable_slot *slots, size_t size, const struct htable_slot *entry) {
+
+    const size_t mask = size - 1;
+    size_t idx = entry->hash & mask;
+
+    while (slots[idx].value != NULL) {
+        idx = (idx + 1) & mask;
+    }
+
+    slots[idx] = *entry;
+}
+
+/// @brief Remove the slot and shift the following entries back, keeping the table free of tombstones.
+static void slot_erase (struct htable_slot *slots, size_t size, size_t idx) {
+
+    const size_t mask = size - 1;
+    size_t next = (idx + 1) & mask;
+
+    while (slots[next].value != NULL) {
+
+        const size_t ideal = slots[next].hash & mask;
+
+        // Move the entry if the freed slot lies between its ideal slot and its current slot.
+        if (((next - ideal) & mask) >= ((next - idx) & mask)) {
+            slots[idx] = slots[next];
+            idx = next;
+        }
+
+        next = (next + 1) & mask;
+    }
+
+    slots[idx].key = NULL;
+    slots[idx].value = NULL;
+    slots[idx].hash = 0;
+}
+
+/// @brief Move a few slots of the table being migrated into the current table.
+/// @param table The hash table.
+/// @param steps The maximum number of slots to migrate, 0 to finish the migration.
+static void open_migrate (htable_t *table, size_t steps) {
+
+    if (table->old_slots == NULL) {
+        return;
+    }
+
+    const size_t end = (steps == 0) ? table->old_size : table->migrated + steps;
+
+    for (; table->migrated < table->old_size && table->migrated < end; table->migrated++) {
+
+        struct htable_slot *slot = &table->old_slots[table->migrated];
+
+        // Mark the migrated slot as removed, lookups still probe the table being migrated.
+        if (slot_live(slot)) {
+            slot_place(table->slots, table->size, slot);
+            slot->value = (void *) &htable_tombstone;
+        }
+    }
+
+    if (table->migrated == table->old_size) {
+        free(table->old_slots);
+        table->old_slots = NULL;
+        table->old_size = 0;
+        table->migrated = 0;
+    }
+}
+
+/// @brief Double the capacity of the table, the slots are migrated incrementally.
+/// @return 0 on success, -2 on memory allocation failure.
+static int open_grow (htable_t *table) {
+
+    // Only one migration can be in progress.
+    open_migrate(table, 0);
+
+    struct htable_slot *slots = NULL;
+
+    if ((slots = calloc(table->size * 2, sizeof(*slots))) == NULL) {
+        return -2;
+    }
+
+    table->old_slots = table->slots;
+    table->old_size = table->size;
+    table->migrated = 0;
+
+    table->slots = slots;
+    table->size *= 2;
+
+    return 0;
+}
+
+/// @brief Locate the key in the current table or the table being migrated.
+/// @return Pointer to the slot, NULL if the key is not present.
+static struct htable_slot *open_lookup (const htable_t *table, unsigned long hash, const void *key) {
+
+    size_t idx = slot_find(table, table->slots, table->size, hash, key);
+
+    if (idx != table->size) {
+        return &table->slots[idx];
+    }
+
+    if (table->old_slots != NULL) {
+
+        idx = slot_find(table, table->old_slots, table->old_size, hash, key);
+
+        if (idx != table->old_size) {
+            return &table->old_slots[idx];
+        }
+    }
+
+    return NULL;
+}
+
+static int open_insert (htable_t *table, const void *key, const void *value) {
+
+    open_migrate(table, HTABLE_MIGRATE_STEP);
+
+    const unsigned long hash = table->hash(key);
+    struct htable_slot *slot = open_lookup(table, hash, key);
+
+    // Update the value of an existing key.
+    if (slot != NULL) {
+        table->cbs.vfree(slot->value);
+        slot->value = table->cbs.vcpy(value);
+        return 0;
+    }
+
+    // Keep the load factor below three quarters.
+    if ((table->count + 1) * 4 > table->size * 3) {
+        if (open_grow(table) < 0) {
+            return -2;
+        }
+    }
+
+    struct htable_slot entry = {
+        .key = table->cbs.kcpy(key),
+        .value = table->cbs.vcpy(value),
+        .hash = hash
+    };
+
+    slot_place(table->slots, table->size, &entry);
+    table->count++;
+
+    return 0;
+}
+
+static int open_remove (htable_t *table, const void *key) {
+
+    open_migrate(table, HTABLE_MIGRATE_STEP);
+
+    const unsigned long hash = table->hash(key);
+    size_t idx = slot_find(table, table->slots, table->size, hash, key);
+
+    if (idx != table->size) {
+        table->cbs.kfree(table->slots[idx].key);
+        table->cbs.vfree(table->slots[idx].value);
+        slot_erase(table->slots, table->size, idx);
+        table->count--;
+        return 0;
+    }
+
+    if (table->old_slots == NULL) {
+        return -1;
+    }
+
+    // Slots of the table being migrated are only marked, the probe sequences must stay intact.
+    idx = slot_find(table, table->old_slots, table->old_size, hash, key);
+
+    if (idx == table->old_size) {
+        return -1;
+    }
+
+    table->cbs.kfree(table->old_slots[idx].key);
+    table->cbs.vfree(table->old_slots[idx].value);
+    table->old_slots[idx].value = (void *) &htable_tombstone;
+    table->count--;
+
+    return 0;
+}
+
+/// @brief Free the key-value pairs of a slot array and the array itself.
+static void open_free_slots (htable_t *table, struct htable_slot *slots, size_t size) {
+
+    if (slots == NULL) {
+        return;
+    }
+
+    for (size_t idx = 0; idx < size; idx++) {
+        if (slot_live(&slots[idx])) {
+            table->cbs.kfree(slots[idx].key);
+            table->cbs.vfree(slots[idx].value);
+        }
+    }
+
+    free(slots);
+}
+
 // --- Function Definitions --- //
 
 /// @brief Create a hash table with the specified size.
 htable_t *htable_create (size_t size, htable_hash_t hash, htable_keq_t keq, const struct callbacks *cbs) {
+    return htable_create_mode(size, hash, keq, cbs, HTABLE_CHAINED);
+}
+
+/// @brief Create a hash table with the specified size and collision resolution strategy.
+htable_t *htable_create_mode (size_t size, htable_hash_t hash, htable_keq_t keq, const struct callbacks *cbs, enum htable_mode mode) {
 
     if (size == 0 || hash == NULL || keq == NULL) {
         return NULL;
@@ -67,14 +372,25 @@ htable_t *htable_create (size_t size, htable_hash_t hash, htable_keq_t keq, cons
         return NULL;
     }
 
-    // Allocate memory for the hash table.;
-    if ((table->table = calloc(size, sizeof(*table->table))) == NULL) {
+    if (mode == HTABLE_OPEN) {
+
+        // The capacity is a power of two, so that the slot index is a mask of the hash value.
+        size = htable_roundup(size);
+
+        if ((table->slots = calloc(size, sizeof(*table->slots))) == NULL) {
+            free(table);
+            return NULL;
+        }
+    }
+    // Allocate memory for the hash table.
+    else if ((table->table = calloc(size, sizeof(*table->table))) == NULL) {
         free(table);
         return NULL;
     }
 
     // Initialize the remaining fields of the hash table.
     table->size = size;
+    table->mode = mode;
 
     // Callbacks.
     table->hash = hash;
@@ -96,10 +412,45 @@ htable_t *htable_create (size_t size, htable_hash_t hash, htable_keq_t keq, cons
     return table;
 }
 
+/// @brief Create a chained hash table that allocates its nodes from a pool of slabs.
+htable_t *htable_create_pooled (size_t size, htable_hash_t hash, htable_keq_t keq, const struct callbacks *cbs, size_t chunk) {
+
+    if (chunk == 0) {
+        return NULL;
+    }
+
+    htable_t *table = NULL;
+
+    if ((table = htable_create_mode(size, hash, keq, cbs, HTABLE_CHAINED)) == NULL) {
+        return NULL;
+    }
+
+    table->pool.chunk = chunk;
+
+    // Preallocate the first slab, so that the table does not allocate until it holds more than a chunk.
+    if (pool_grow(&table->pool) < 0) {
+        htable_destroy(table);
+        return NULL;
+    }
+
+    return table;
+}
+
 /// @brief Destroy the hash table and free resources.
 void htable_destroy (htable_t *table) {
 
-    if (table == NULL || table->table == NULL) {
+    if (table == NULL) {
+        return;
+    }
+
+    if (table->mode == HTABLE_OPEN) {
+        open_free_slots(table, table->slots, table->size);
+        open_free_slots(table, table->old_slots, table->old_size);
+        free(table);
+        return;
+    }
+
+    if (table->table == NULL) {
         return;
     }
 
@@ -109,7 +460,7 @@ void htable_destroy (htable_t *table) {
         struct htable_node *current = table->table[idx];
 
         // Traverse the linked list.
-        do {
+        while (current != NULL) {
             struct htable_node *next = current->next;
 
             // Free the key and value.
@@ -117,10 +468,17 @@ void htable_destroy (htable_t *table) {
             table->cbs.vfree(current->value);
 
             // Free the hash node.
-            free(current);
+            node_free(table, current);
 
             current = next;
-        } while (current != NULL);
+        }
+    }
+
+    // Free the slabs of the node pool, the nodes are released with them.
+    while (table->pool.slabs != NULL) {
+        struct htable_slab *next = table->pool.slabs->next;
+        free(table->pool.slabs);
+        table->pool.slabs = next;
     }
 
     // Free the hash table array.
@@ -133,7 +491,15 @@ void htable_destroy (htable_t *table) {
 /// @brief Insert a key-value pair into the hash table.
 int htable_insert (htable_t *table, const void *key, const void *value) {
 
-    if (table == NULL || table->table == NULL || value == NULL) {
+    if (table == NULL || value == NULL) {
+        return -1;
+    }
+
+    if (table->mode == HTABLE_OPEN) {
+        return open_insert(table, key, value);
+    }
+
+    if (table->table == NULL) {
         return -1;
     }
 
@@ -147,7 +513,7 @@ int htable_insert (htable_t *table, const void *key, const void *value) {
     if (current == NULL) {
         struct htable_node *new_node = NULL;
 
-        if ((new_node = malloc(sizeof(*new_node))) == NULL) {
+        if ((new_node = node_alloc(table)) == NULL) {
             return -2;
         }
 
@@ -176,22 +542,33 @@ int htable_insert (htable_t *table, const void *key, const void *value) {
         // If the key does not exist in the linked list, create a new hash node.
         struct htable_node *new_node = NULL;
 
-        if ((new_node = malloc(sizeof(*new_node))) == NULL) {
+        if ((new_node = node_alloc(table)) == NULL) {
             return -2;
         }
 
         new_node->key = table->cbs.kcpy(key);
         new_node->value = table->cbs.vcpy(value);
+        new_node->next = NULL;
         prev->next = new_node;
     }
 
+    table->count++;
+
     return 0;
 }
 
 /// @brief Remove a key-value pair from the hash table.
 int htable_remove (htable_t *table, const void *key) {
 
-    if (table == NULL || table->table == NULL) {
+    if (table == NULL) {
+        return -1;
+    }
+
+    if (table->mode == HTABLE_OPEN) {
+        return open_remove(table, key);
+    }
+
+    if (table->table == NULL) {
         return -1;
     }
 
@@ -217,7 +594,9 @@ int htable_remove (htable_t *table, const void *key) {
             table->cbs.vfree(current->value);
 
             // Free the hash node.
-            free(current);
+            node_free(table, current);
+
+            table->count--;
 
             return 0;
         }
@@ -233,7 +612,16 @@ int htable_remove (htable_t *table, const void *key) {
 /// @brief Get the hash node for the specified key.
 void *htable_get (htable_t *table, const void *key) {
 
-    if (table == NULL || table->table == NULL) {
+    if (table == NULL) {
+        return NULL;
+    }
+
+    if (table->mode == HTABLE_OPEN) {
+        const struct htable_slot *slot = open_lookup(table, table->hash(key), key);
+        return (slot != NULL) ? slot->value : NULL;
+    }
+
+    if (table->table == NULL) {
         return NULL;
     }
 
@@ -29,8 +29,92 @@
 // SOFTWARE.
 // ==============================================================================
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE         // For Linux specific interfaces, e.g. accept4(2), sched_getcpu(3).
+#endif // _GNU_SOURCE
+
 #include "tcpserver.h"
 
+#include <errno.h>          // For error codes, e.g. EAGAIN.
+
+#ifdef __linux__
+#include <sched.h>          // For the core of the calling thread, e.g. sched_getcpu(3).
+#endif // __linux__
+
+// --- External Definitions, inline functions --- //
+
+// The inline functions of the header are emitted here for the calls the compiler does not inline.
+extern inline unsigned short get_port (const struct server_info *server);
+extern inline const char* get_addr (const struct server_info *server);
+
+// --- Static Function Definitions --- //
+
+/// @brief Set an integer socket option, zero values keep the system default.
+/// @param fd The socket.
+/// @param level The protocol level, e.g. IPPROTO_TCP.
+/// @param name The option name, e.g. TCP_NODELAY.
+/// @param value The value of the option.
+/// @return 0 on success, -1 on failure.
+static int set_option (int fd, int level, int name, int value) {
+
+    if (value == 0) {
+        return 0;
+    }
+
+    return setsockopt(fd, level, name, &value, sizeof(value));
+
+} // set_option
+
+/// @brief Apply the listener options of the profile, before the socket is bound.
+/// @param server The server struct, its socket must be open.
+/// @param opts The socket options profile.
+/// @return 0 on success, -1 on failure.
+static int listener_tune (struct server_info *server, const struct socket_options *opts) {
+
+    // Accepted sockets inherit the buffer sizes, set before listen(2) they also determine the window scale.
+    if (set_option(server->fd, SOL_SOCKET, SO_SNDBUF, opts->send_buffer) < 0
+        || set_option(server->fd, SOL_SOCKET, SO_RCVBUF, opts->recv_buffer) < 0) {
+        LOG_ERROR("Error setting server socket buffer sizes");
+        return -1;
+    }
+
+#ifdef TCP_DEFER_ACCEPT
+    // The listener only becomes readable once the request arrived, a wakeup per connection is saved.
+    if (set_option(server->fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, opts->defer_accept) < 0) {
+        LOG_ERROR("Error setting TCP_DEFER_ACCEPT on server socket");
+        return -1;
+    }
+#endif // TCP_DEFER_ACCEPT
+
+#ifdef TCP_FASTOPEN
+    // The data of the SYN is delivered with the connection, a round trip is saved for returning clients.
+    if (set_option(server->fd, IPPROTO_TCP, TCP_FASTOPEN, opts->fast_open) < 0) {
+        LOG_ERROR("Error setting TCP_FASTOPEN on server socket");
+        return -1;
+    }
+#endif // TCP_FASTOPEN
+
+    server->cpu = -1;
+
+#if defined(SO_INCOMING_CPU) && defined(__linux__)
+    // Among listeners sharing the address, the kernel prefers the one bound to the core that processed the SYN.
+    if (opts->incoming_cpu) {
+
+        const int cpu = sched_getcpu();
+
+        if (cpu < 0 || setsockopt(server->fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) < 0) {
+            LOG_ERROR("Error setting SO_INCOMING_CPU on server socket");
+            return -1;
+        }
+
+        server->cpu = cpu;
+    }
+#endif // SO_INCOMING_CPU && __linux__
+
+    return 0;
+
+} // listener_tune
+
 // --- Function Definitions --- //
 
 /// @brief Parse the IPv4 address and port from a string and store it in a sockaddr_in->sin_addr.
@@ -64,9 +148,20 @@ static int parse_address (const char *ipv4, struct sockaddr_in *saddr) {
 
 /// @brief Create a listener socket on the specified port, TCP/IPv4 protocol.
 int server_bind (struct server_info *server, const char* ipv4) {
+    return server_bind_opts(server, ipv4, NULL);
+}
+
+/// @brief Create a listener socket on the specified port with the specified socket options.
+int server_bind_opts (struct server_info *server, const char* ipv4, const struct socket_options *opts) {
 
     assert(server);
 
+    const struct socket_options defaults = { 0 };
+
+    if (opts == NULL) {
+        opts = &defaults;
+    }
+
     int retval = 0;
 
     // Create a socket file descriptor for the TCP listener.
@@ -85,6 +180,22 @@ int server_bind (struct server_info *server, const char* ipv4) {
         goto close_socket;
     }
 
+#ifdef SO_REUSEPORT
+    // Allow other listeners to bind the same address, the connections are load-balanced by the kernel.
+    int reuse_port = 1;
+
+    if (opts->reuse_port && setsockopt(server->fd, SOL_SOCKET, SO_REUSEPORT, &reuse_port, sizeof(reuse_port)) < 0) {
+        LOG_ERROR("Error setting server socket options");
+        retval = -1;
+        goto close_socket;
+    }
+#endif // SO_REUSEPORT
+
+    if (listener_tune(server, opts) < 0) {
+        retval = -1;
+        goto close_socket;
+    }
+
     // Bind the socket to an address (possibly overwritable) and port.
 
     struct sockaddr_in server_addr;
@@ -105,7 +216,7 @@ int server_bind (struct server_info *server, const char* ipv4) {
     server->addr = server_addr;
 
     // Listen on the socket.
-    if (listen(server->fd, MAX_CLIENTS) < 0) {
+    if (listen(server->fd, (opts->backlog > 0) ? opts->backlog : (int) MAX_CLIENTS) < 0) {
         LOG_ERROR("Error listening on server socket");
         retval = -1;
         goto close_socket;
@@ -136,6 +247,55 @@ void server_close (struct server_info *server) {
 
 } // close_server
 
+/// @brief Apply the connection options of the profile to an accepted socket.
+int socket_tune (int fd, const struct socket_options *opts) {
+
+    assert(fd >= 0 && opts);
+
+    int retval = 0;
+
+    // Small writes of request/response protocols are not delayed until the previous segment is acknowledged.
+    if (set_option(fd, IPPROTO_TCP, TCP_NODELAY, opts->no_delay) < 0) {
+        LOG_ERROR("Error setting TCP_NODELAY on client socket");
+        retval = -1;
+    }
+
+#ifdef SO_BUSY_POLL
+    // Spinning on the device queue trades CPU time for the latency of the interrupt, raising it needs CAP_NET_ADMIN.
+    if (set_option(fd, SOL_SOCKET, SO_BUSY_POLL, opts->busy_poll) < 0) {
+        LOG_ERROR("Error setting SO_BUSY_POLL on client socket");
+        retval = -1;
+    }
+#endif // SO_BUSY_POLL
+
+    return retval;
+
+} // socket_tune
+
+/// @brief Get the core that processed the last packets of a connection.
+int socket_incoming_cpu (int fd) {
+
+#ifdef SO_INCOMING_CPU
+
+    int cpu = -1;
+    socklen_t length = sizeof(cpu);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &length) < 0) {
+        return -1;
+    }
+
+    return cpu;
+
+#else
+
+    (void) fd;
+
+    return -1;
+
+#endif // SO_INCOMING_CPU
+
+} // socket_incoming_cpu
+
 /// @brief Accept a connection from a client for the listener socket.
 int server_accept (const struct server_info *server, struct client_info *client) {
 
@@ -151,11 +311,56 @@ int server_accept (const struct server_info *server, struct client_info *client)
 
     // Store the server information in the client struct for reference.
     client->listener = server;
+    client->cpu = -1;
 
     return 0;
 
 } // accept_connection
 
+/// @brief Accept a connection from a client in non-blocking, close-on-exec mode.
+int server_accept_nonblock (const struct server_info *server, struct client_info *client) {
+
+    assert(server && client);
+
+    socklen_t client_addr_len = sizeof(client->addr);
+
+#ifdef __linux__
+    // A single system call instead of accept(2) followed by two fcntl(2) calls.
+    client->fd = accept4(server->fd, (struct sockaddr*) &client->addr, &client_addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    client->fd = accept(server->fd, (struct sockaddr*) &client->addr, &client_addr_len);
+#endif // __linux__
+
+    if (client->fd < 0) {
+
+        // An empty accept queue is the regular end of a batch, not an error.
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_ERROR("Error accepting connection");
+        }
+
+        return -1;
+    }
+
+#ifndef __linux__
+    int get_flags = 0;
+
+    if ((get_flags = fcntl(client->fd, F_GETFL, 0)) < 0 || fcntl(client->fd, F_SETFL, get_flags | O_NONBLOCK) < 0
+        || fcntl(client->fd, F_SETFD, FD_CLOEXEC) < 0) {
+        LOG_ERROR("Error setting file descriptor flags");
+        (void) close(client->fd);
+        client->fd = INVALID_FD;
+        return -1;
+    }
+#endif // __linux__
+
+    // Store the server information in the client struct for reference.
+    client->listener = server;
+    client->cpu = -1;
+
+    return 0;
+
+} // accept_connection_nonblock
+
 /// @brief Close the client socket.
 void client_close (struct client_info *client) {
 
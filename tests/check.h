@@ -0,0 +1,80 @@
+// ==============================================================================
+//                       Test Checks, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This header provides the checks shared by the test programs.
+// A failed check prints its location and condition and the test continues, so
+// that a single run reports every failure. The main function of a test returns
+// check_status() as its exit status, which make test reports.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#ifndef CHECK_H_
+#define CHECK_H_
+
+    // --- Standard Libraries --- //
+
+    #include <stdio.h>      // For reporting the failures, e.g. fprintf(3).
+    #include <stdlib.h>     // For the exit status, e.g. EXIT_FAILURE.
+
+    // --- Constants and Macros --- //
+
+    #define CHECK_REPORTED  20  // Number of failures printed, the rest is only counted.
+
+    /// @brief Check a condition, a failure is reported and counted without stopping the test.
+    #define CHECK(condition) check_report((condition), __FILE__, __LINE__, #condition)
+
+    // --- Static Variables --- //
+
+    static unsigned long check_failures = 0;    // Number of failed checks.
+
+    // --- Function Definitions --- //
+
+    /// @brief Count and report a failed check.
+    /// @return The result of the check.
+    static inline int check_report (int passed, const char *file, int line, const char *condition) {
+
+        if (!passed && check_failures++ < CHECK_REPORTED) {
+            fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+        }
+
+        return passed;
+    }
+
+    /// @brief Report the result of the test.
+    /// @param name The name of the test.
+    /// @return The exit status of the test.
+    static inline int check_status (const char *name) {
+
+        if (check_failures > 0) {
+            fprintf(stderr, "%s: %lu checks failed\n", name, check_failures);
+            return EXIT_FAILURE;
+        }
+
+        printf("%s: ok\n", name);
+
+        return EXIT_SUCCESS;
+    }
+
+#endif // CHECK_H_
@@ -0,0 +1,236 @@
+// ==============================================================================
+//                        Framing Test, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This program tests the framing stage. The SIMD search of
+// frame_scan() is compared with memchr(3) for every length and alignment of a
+// window, with the byte before and after the window set to the searched one,
+// then messages of every framing mode are written into a small ring at every
+// offset, so that prefixes, messages and delimiters are split by the wrap, and
+// framed at once and byte by byte.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#include <string.h>     // For the reference search, e.g. memchr(3).
+
+#include "as_server.h"
+#include "as_frame.h"
+#include "check.h"
+
+// --- Constants and Macros --- //
+
+#define SCAN_ALIGNMENTS     64UL    // Alignments of the searched window, a multiple of the widest vector.
+#define SCAN_LENGTH         160UL   // Longest searched window, several vectors and a scalar rest.
+#define RING_SIZE           64UL    // Size of the framed ring, small enough for every message to wrap.
+#define STREAM_MAX          256UL   // Maximum size of an encoded stream of messages.
+
+// --- Type Definitions --- //
+
+/// @brief Framing mode under test.
+struct frame_case {
+    enum frame_mode     mode;       // The framing mode.
+    unsigned int        param;      // The delimiter or the prefix size.
+};
+
+// --- Static Variables --- //
+
+/// @brief Messages of the streams, without the bytes that delimit them.
+static const char *const messages[] = { "", "a", "hello", "a\rb c", "0123456789abcdefghijkl" };
+
+static const struct frame_case cases[] = {
+    { FRAME_LINE, 0 },
+    { FRAME_CRLF, 0 },
+    { FRAME_DELIMITER, ';' },
+    { FRAME_LENGTH, 1 },
+    { FRAME_LENGTH, 2 },
+    { FRAME_LENGTH, 4 },
+    { FRAME_LENGTH, 8 },
+};
+
+// --- Static Function Definitions --- //
+
+/// @brief Compare frame_scan() with memchr(3) for every length and alignment and every position of the byte.
+static void test_scan (void) {
+
+    static char data[SCAN_ALIGNMENTS + SCAN_LENGTH + 2];
+
+    for (size_t align = 1; align <= SCAN_ALIGNMENTS; align++) {
+        for (size_t length = 0; length <= SCAN_LENGTH; length++) {
+
+            char *window = data + align;
+
+            // The bytes around the window match as well, a search reading beyond it would find them.
+            memset(data, 'x', sizeof(data));
+            window[-1] = '\n';
+            window[length] = '\n';
+
+            CHECK(frame_scan(window, length, '\n') == memchr(window, '\n', length));
+
+            for (size_t position = 0; position < length; position++) {
+
+                window[position] = '\n';
+
+                CHECK(frame_scan(window, length, '\n') == memchr(window, '\n', length));
+
+                // A second match behind the first one must not be reported instead.
+                if (position + 1 < length) {
+                    window[length - 1] = '\n';
+                    CHECK(frame_scan(window, length, '\n') == window + position);
+                    window[length - 1] = 'x';
+                }
+
+                window[position] = 'x';
+            }
+
+            // Bytes with the high bit set must not match by sign extension.
+            memset(window, 0x8a, length);
+            CHECK(frame_scan(window, length, 0x0a) == NULL);
+            CHECK(frame_scan(window, length, 0x8a) == memchr(window, 0x8a, length));
+        }
+    }
+}
+
+/// @brief Encode the messages of the stream with the framing of the case.
+/// @return The length of the stream.
+static size_t encode (const struct frame_case *test, char *stream) {
+
+    size_t length = 0;
+
+    for (size_t i = 0; i < sizeof(messages) / sizeof(messages[0]); i++) {
+
+        const size_t size = strlen(messages[i]);
+
+        if (test->mode == FRAME_LENGTH) {
+            for (unsigned int byte = 0; byte < test->param; byte++) {
+                stream[length++] = (char) ((unsigned long long) size >> (8U * (test->param - 1U - byte)));
+            }
+        }
+
+        memcpy(stream + length, messages[i], size);
+        length += size;
+
+        switch (test->mode) {
+            case FRAME_LINE:
+                // Every other line ends with CRLF, the CR is stripped as well.
+                if (i % 2) {
+                    stream[length++] = '\r';
+                }
+                stream[length++] = '\n';
+                break;
+            case FRAME_CRLF:
+                stream[length++] = '\r';
+                stream[length++] = '\n';
+                break;
+            case FRAME_DELIMITER:
+                stream[length++] = (char) test->param;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return length;
+}
+
+/// @brief Frame the messages of the buffer and compare them with the expected ones.
+/// @param next Index of the next expected message, advanced past the framed ones.
+static void expect_frames (struct framer *framer, struct io_buffer *buffer, size_t *next) {
+
+    struct frame frame;
+    char copy[STREAM_MAX];
+    int result;
+
+    while ((result = frame_next(framer, buffer, &frame)) == 1) {
+
+        if (!CHECK(*next < sizeof(messages) / sizeof(messages[0]))) {
+            return;
+        }
+
+        const size_t size = strlen(messages[*next]);
+
+        CHECK(frame.length == size);
+        CHECK(frame_copy(&frame, copy, sizeof(copy)) == size && memcmp(copy, messages[*next], size) == 0);
+
+        frame_consume(framer, buffer, &frame);
+        (*next)++;
+    }
+
+    CHECK(result == 0);
+}
+
+/// @brief Frame the stream of every case written at every offset of the ring, at once and byte by byte.
+static void test_wrap (void) {
+
+    char stream[STREAM_MAX];
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+
+        const size_t length = encode(&cases[c], stream);
+
+        for (size_t offset = 0; offset < RING_SIZE; offset++) {
+            for (int bytewise = 0; bytewise <= 1; bytewise++) {
+
+                struct io_buffer *buffer = iobuff_alloc(RING_SIZE);
+                struct framer framer;
+                size_t next = 0;
+
+                if (!CHECK(buffer != NULL) || !CHECK(frame_init(&framer, cases[c].mode, cases[c].param, 0) == 0)) {
+                    iobuff_free(buffer);
+                    return;
+                }
+
+                // The stream is longer than the ring, so the consumed messages make room for the rest.
+                buffer->head = buffer->tail = offset;
+
+                for (size_t sent = 0; sent < length;) {
+
+                    // A full ring is grown by frame_next() to hold an incomplete message, a chunk is at least a byte.
+                    const size_t free_space = buffer->size - (buffer->head - buffer->tail);
+                    const size_t room = (free_space > 0) ? free_space : 1;
+                    const size_t chunk = bytewise ? 1 : ((length - sent < room) ? length - sent : room);
+
+                    CHECK(iobuff_append(buffer, stream + sent, chunk, true) == chunk);
+                    sent += chunk;
+
+                    expect_frames(&framer, buffer, &next);
+                }
+
+                CHECK(next == sizeof(messages) / sizeof(messages[0]));
+                CHECK(buffer->head == buffer->tail);
+
+                iobuff_free(buffer);
+            }
+        }
+    }
+}
+
+// --- Main --- //
+
+int main (void) {
+
+    test_scan();
+    test_wrap();
+
+    return check_status("frame_test");
+}
@@ -0,0 +1,284 @@
+// ==============================================================================
+//                         MPSC Queue Test, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This program tests the multi-producer single-consumer queues of
+// mpsc.h. The order of a single thread is checked first, including the
+// placeholder of the intrusive queue being put back behind the last node and
+// the full bounded ring over many laps, then several producer threads push
+// numbered messages while the consumer pops them, every message must arrive
+// exactly once and in the order of its producer.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#include <stddef.h>     // For the offsetof macro.
+#include <pthread.h>    // For the producer threads, e.g. pthread_create(3).
+#include <sched.h>      // For waiting on the other threads, e.g. sched_yield(2).
+
+#include "mpsc.h"
+#include "check.h"
+
+// --- Constants and Macros --- //
+
+#define TEST_PRODUCERS  4U          // Number of producer threads.
+#define TEST_MESSAGES   200000U     // Number of messages per producer.
+#define TEST_RING       64U         // Capacity of the bounded ring, small so that the producers fill it.
+
+/// @brief Get the message of a queue node.
+#define MESSAGE_OF(node) ((struct message *) ((char *) (node) - offsetof(struct message, node)))
+
+// --- Type Definitions --- //
+
+/// @brief Message pushed by a producer.
+struct message {
+    struct mpsc_node    node;       // The link of the queue.
+    unsigned int        producer;   // Index of the producer.
+    unsigned int        seq;        // Number of the message of its producer.
+};
+
+/// @brief Producer thread and its messages.
+struct producer {
+    pthread_t           thread;     // The producer thread.
+    unsigned int        index;      // Index of the producer.
+    struct message      *messages;  // The messages, TEST_MESSAGES of them.
+};
+
+// --- Static Variables --- //
+
+static struct mpsc_queue queue;
+static struct mpsc_ring *ring;
+
+// --- Static Function Definitions --- //
+
+/// @brief Push the messages of the producer to the queue.
+static void *produce_queue (void *arg) {
+
+    struct producer *producer = (struct producer *) arg;
+
+    for (unsigned int seq = 0; seq < TEST_MESSAGES; seq++) {
+        producer->messages[seq].producer = producer->index;
+        producer->messages[seq].seq = seq;
+        mpsc_push(&queue, &producer->messages[seq].node);
+    }
+
+    return NULL;
+}
+
+/// @brief Push the messages of the producer to the bounded ring, retrying while it is full.
+static void *produce_ring (void *arg) {
+
+    struct producer *producer = (struct producer *) arg;
+
+    for (unsigned int seq = 0; seq < TEST_MESSAGES; seq++) {
+
+        producer->messages[seq].producer = producer->index;
+        producer->messages[seq].seq = seq;
+
+        while (!mpsc_ring_push(ring, &producer->messages[seq])) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+/// @brief Check the order of a single thread and the reuse of the placeholder.
+static void test_queue_order (void) {
+
+    static struct message messages[3];
+
+    mpsc_init(&queue);
+
+    CHECK(mpsc_pop(&queue) == NULL);
+
+    // A single node is detached by putting the placeholder back behind it, several times in a row.
+    for (unsigned int round = 0; round < 3; round++) {
+        mpsc_push(&queue, &messages[round].node);
+        CHECK(mpsc_pop(&queue) == &messages[round].node);
+        CHECK(mpsc_pop(&queue) == NULL);
+    }
+
+    for (unsigned int i = 0; i < 3; i++) {
+        mpsc_push(&queue, &messages[i].node);
+    }
+
+    for (unsigned int i = 0; i < 3; i++) {
+        CHECK(mpsc_pop(&queue) == &messages[i].node);
+    }
+
+    CHECK(mpsc_pop(&queue) == NULL);
+}
+
+/// @brief Check the capacity and the order of the bounded ring on a single thread, over many laps.
+static void test_ring_order (void) {
+
+    static unsigned int values[TEST_RING + 1];
+
+    CHECK(mpsc_ring_create(TEST_RING + 1) == NULL);
+
+    if (!CHECK((ring = mpsc_ring_create(TEST_RING)) != NULL)) {
+        return;
+    }
+
+    CHECK(mpsc_ring_pop(ring) == NULL);
+
+    // Exactly the capacity fits, the next push fails until a cell is consumed.
+    for (unsigned int i = 0; i < TEST_RING; i++) {
+        CHECK(mpsc_ring_push(ring, &values[i]));
+    }
+
+    CHECK(!mpsc_ring_push(ring, &values[TEST_RING]));
+    CHECK(mpsc_ring_pop(ring) == &values[0]);
+    CHECK(mpsc_ring_push(ring, &values[TEST_RING]));
+    CHECK(!mpsc_ring_push(ring, &values[0]));
+
+    for (unsigned int i = 1; i <= TEST_RING; i++) {
+        CHECK(mpsc_ring_pop(ring) == &values[i]);
+    }
+
+    CHECK(mpsc_ring_pop(ring) == NULL);
+
+    // The sequence numbers of the cells advance by one capacity per lap.
+    for (unsigned int lap = 0; lap < 100; lap++) {
+        for (unsigned int i = 0; i < TEST_RING / 2 + 1; i++) {
+            CHECK(mpsc_ring_push(ring, &values[i]));
+        }
+        for (unsigned int i = 0; i < TEST_RING / 2 + 1; i++) {
+            CHECK(mpsc_ring_pop(ring) == &values[i]);
+        }
+    }
+
+    CHECK(mpsc_ring_pop(ring) == NULL);
+
+    free(ring);
+    ring = NULL;
+}
+
+/// @brief Pop the messages of concurrent producers, each one exactly once and in the order of its producer.
+static void test_queue_threads (void) {
+
+    static struct producer producers[TEST_PRODUCERS];
+    unsigned int expected[TEST_PRODUCERS] = { 0 };
+
+    mpsc_init(&queue);
+
+    for (unsigned int i = 0; i < TEST_PRODUCERS; i++) {
+
+        producers[i].index = i;
+
+        if (!CHECK((producers[i].messages = calloc(TEST_MESSAGES, sizeof(struct message))) != NULL)
+            || !CHECK(pthread_create(&producers[i].thread, NULL, produce_queue, &producers[i]) == 0)) {
+            return;
+        }
+    }
+
+    // NULL is returned while a producer is linking its node, the consumer retries.
+    for (size_t received = 0; received < (size_t) TEST_PRODUCERS * TEST_MESSAGES;) {
+
+        struct mpsc_node *node = mpsc_pop(&queue);
+
+        if (node == NULL) {
+            sched_yield();
+            continue;
+        }
+
+        const struct message *message = MESSAGE_OF(node);
+
+        if (CHECK(message->producer < TEST_PRODUCERS)) {
+            CHECK(message->seq == expected[message->producer]);
+            expected[message->producer] = message->seq + 1;
+        }
+
+        received++;
+    }
+
+    for (unsigned int i = 0; i < TEST_PRODUCERS; i++) {
+        (void) pthread_join(producers[i].thread, NULL);
+        CHECK(expected[i] == TEST_MESSAGES);
+        free(producers[i].messages);
+    }
+
+    CHECK(mpsc_pop(&queue) == NULL);
+}
+
+/// @brief Pop the messages of concurrent producers from the bounded ring, which is full most of the time.
+static void test_ring_threads (void) {
+
+    static struct producer producers[TEST_PRODUCERS];
+    unsigned int expected[TEST_PRODUCERS] = { 0 };
+
+    if (!CHECK((ring = mpsc_ring_create(TEST_RING)) != NULL)) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < TEST_PRODUCERS; i++) {
+
+        producers[i].index = i;
+
+        if (!CHECK((producers[i].messages = calloc(TEST_MESSAGES, sizeof(struct message))) != NULL)
+            || !CHECK(pthread_create(&producers[i].thread, NULL, produce_ring, &producers[i]) == 0)) {
+            return;
+        }
+    }
+
+    for (size_t received = 0; received < (size_t) TEST_PRODUCERS * TEST_MESSAGES;) {
+
+        const struct message *message = mpsc_ring_pop(ring);
+
+        if (message == NULL) {
+            sched_yield();
+            continue;
+        }
+
+        if (CHECK(message->producer < TEST_PRODUCERS)) {
+            CHECK(message->seq == expected[message->producer]);
+            expected[message->producer] = message->seq + 1;
+        }
+
+        received++;
+    }
+
+    for (unsigned int i = 0; i < TEST_PRODUCERS; i++) {
+        (void) pthread_join(producers[i].thread, NULL);
+        CHECK(expected[i] == TEST_MESSAGES);
+        free(producers[i].messages);
+    }
+
+    CHECK(mpsc_ring_pop(ring) == NULL);
+
+    free(ring);
+    ring = NULL;
+}
+
+// --- Main --- //
+
+int main (void) {
+
+    test_queue_order();
+    test_ring_order();
+    test_queue_threads();
+    test_ring_threads();
+
+    return check_status("mpsc_test");
+}
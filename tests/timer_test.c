@@ -0,0 +1,286 @@
+// ==============================================================================
+//                       Timer Wheel Test, Asynchronous TCP Server
+// ==============================================================================
+//
+// Description: This program tests the hierarchical timer wheel. Timers around
+// the range boundaries of every level are expired one millisecond at a time,
+// so that each of them cascades down through the levels, then a pseudo-random
+// set of timers over the whole range and beyond is expired with random steps
+// and compared with their expiry times. A timer must expire in the first
+// timer_advance() that reaches it, never earlier, and timer_next() must never
+// sleep past an armed timer. Timers cancelled and re-armed by the callbacks of
+// the same slot are covered as well.
+//
+// MIT License
+//
+// Copyright (c) 2024 Erik A. Rapp
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// ==============================================================================
+
+#include <string.h>     // For memory operations, e.g. memset(3).
+
+#include "as_timer.h"
+#include "check.h"
+
+// --- Constants and Macros --- //
+
+#define TEST_START          1000003ULL  // Start of the clock, not aligned to any level.
+#define TEST_TIMERS         4096U       // Number of pseudo-random timers.
+#define TEST_STEPS          20000U      // Number of pseudo-random advances.
+#define TEST_RANGE_BITS     (TIMER_LEVELS * TIMER_SLOT_BITS + 2U) // Delays reach beyond the range of the wheel.
+
+// --- Type Definitions --- //
+
+/// @brief Timer under test and the advance that expired it.
+struct test_timer {
+    struct as_timer     timer;      // The timer, the first member.
+    uint64_t            fired;      // Time of the advance that expired the timer, 0 if it did not.
+    unsigned int        calls;      // Number of callback calls.
+    struct test_timer   *cancel;    // Timer cancelled by the callback, NULL for none.
+    bool                rearm;      // The callback re-arms the timer at the current time.
+};
+
+// --- Static Variables --- //
+
+static struct timer_wheel wheel;
+static uint64_t previous;   // Time of the previous advance, a timer expiring after it is not late.
+static uint64_t random_state = 0x9e3779b97f4a7c15ULL;
+
+// --- Static Function Definitions --- //
+
+/// @brief Get the next pseudo-random number, xorshift64.
+static uint64_t random_next (void) {
+
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+
+    return random_state;
+}
+
+/// @brief Record the expiry of the timer.
+static void on_expired (struct as_timer *timer, void *data) {
+
+    struct test_timer *test = (struct test_timer *) timer;
+
+    (void) data;
+
+    // Due by now and not by the previous advance, i.e. neither early nor late.
+    CHECK(timer->expires <= wheel.now && (timer->expires > previous || test->calls > 0));
+
+    test->fired = wheel.now;
+    test->calls++;
+
+    if (test->cancel != NULL) {
+        timer_cancel(&wheel, &test->cancel->timer);
+    }
+
+    if (test->rearm) {
+        test->rearm = false;
+        timer_arm(&wheel, timer, wheel.now);
+    }
+}
+
+/// @brief Arm the timer under test.
+static void arm (struct test_timer *test, uint64_t expires) {
+
+    memset(test, 0, sizeof(*test));
+    test->timer.callback = on_expired;
+    timer_arm(&wheel, &test->timer, expires);
+}
+
+/// @brief Check the earliest armed expiry against timer_next(), the wheel may only wake up early.
+static void check_next (const struct test_timer *timers, size_t count, uint64_t now) {
+
+    uint64_t earliest = UINT64_MAX;
+
+    for (size_t i = 0; i < count; i++) {
+        if (timer_armed(&timers[i].timer) && timers[i].timer.expires < earliest) {
+            earliest = timers[i].timer.expires;
+        }
+    }
+
+    const int timeout = timer_next(&wheel, now);
+
+    CHECK((earliest == UINT64_MAX) == (timeout < 0));
+    CHECK(timeout < 0 || earliest <= now || now + (uint64_t) timeout <= earliest);
+}
+
+/// @brief Advance the wheel and check that each timer expired exactly in the first advance reaching it.
+static void advance (struct test_timer *timers, size_t count, uint64_t now) {
+
+    (void) timer_advance(&wheel, now, NULL);
+
+    for (size_t i = 0; i < count; i++) {
+
+        const struct test_timer *test = &timers[i];
+
+        if (test->calls > 0) {
+            continue;
+        }
+
+        // Not expired yet, the timer must still be armed and not due.
+        CHECK(timer_armed(&test->timer) && test->timer.expires > now);
+    }
+
+    previous = now;
+}
+
+/// @brief Expire timers around the range boundaries of every level one millisecond at a time.
+static void test_cascade (void) {
+
+    static struct test_timer timers[TIMER_LEVELS * 3];
+    size_t count = 0;
+
+    timer_wheel_init(&wheel, TEST_START);
+    previous = TEST_START;
+
+    // The last level is covered by the random test, stepping through its range would take too long.
+    for (unsigned int level = 1; level < TIMER_LEVELS - 1; level++) {
+
+        const uint64_t range = 1ULL << (level * TIMER_SLOT_BITS);
+        const uint64_t boundary = (TEST_START + range) & ~(range - 1);
+
+        arm(&timers[count++], boundary - 1);
+        arm(&timers[count++], boundary);
+        arm(&timers[count++], boundary + 1);
+    }
+
+    const uint64_t end = timers[count - 1].timer.expires + 1;
+
+    for (uint64_t now = TEST_START + 1; now <= end; now++) {
+        advance(timers, count, now);
+
+        // Sampled, the scan of the timers costs more than the advance.
+        if (now % 61 == 0) {
+            check_next(timers, count, now);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        CHECK(timers[i].calls == 1 && timers[i].fired == timers[i].timer.expires);
+    }
+
+    CHECK(wheel.count == 0);
+    CHECK(timer_next(&wheel, end) == -1);
+}
+
+/// @brief Expire pseudo-random timers over the whole range of the wheel and beyond with random steps.
+static void test_random (void) {
+
+    static struct test_timer timers[TEST_TIMERS];
+
+    timer_wheel_init(&wheel, TEST_START);
+    previous = TEST_START;
+
+    for (size_t i = 0; i < TEST_TIMERS; i++) {
+
+        // Delays of every magnitude, so that every level and the overflow slot are used.
+        const unsigned int bits = (unsigned int) (random_next() % TEST_RANGE_BITS);
+        const uint64_t delay = random_next() & ((1ULL << bits) - 1);
+
+        arm(&timers[i], TEST_START + 1 + delay);
+    }
+
+    CHECK(wheel.count == TEST_TIMERS);
+
+    uint64_t now = TEST_START;
+
+    for (unsigned int step = 0; step < TEST_STEPS && wheel.count > 0; step++) {
+
+        // Mostly short steps, with jumps to the next armed timer and far beyond it in between.
+        const int timeout = timer_next(&wheel, now);
+        const uint64_t choice = random_next() % 8;
+
+        if (choice == 0) {
+            now += random_next() & ((1ULL << (random_next() % TEST_RANGE_BITS)) - 1);
+        }
+        else if (choice == 1 && timeout > 0) {
+            now += (uint64_t) timeout;
+        }
+        else {
+            now += 1 + random_next() % 97;
+        }
+
+        advance(timers, TEST_TIMERS, now);
+
+        if (step % 256 == 0) {
+            check_next(timers, TEST_TIMERS, now);
+        }
+    }
+
+    advance(timers, TEST_TIMERS, UINT64_MAX - 1);
+
+    for (size_t i = 0; i < TEST_TIMERS; i++) {
+        CHECK(timers[i].calls == 1);
+    }
+
+    CHECK(wheel.count == 0);
+}
+
+/// @brief Cancel and re-arm timers of the same slot from their callbacks.
+static void test_callbacks (void) {
+
+    static struct test_timer timers[4];
+
+    timer_wheel_init(&wheel, TEST_START);
+    previous = 0;
+
+    for (size_t i = 0; i < 4; i++) {
+        arm(&timers[i], TEST_START + 10);
+    }
+
+    // The timers cancel each other in pairs, whichever of a pair is called first, the other one must not expire.
+    for (size_t i = 0; i < 4; i++) {
+        timers[i].cancel = &timers[i ^ 1];
+    }
+
+    (void) timer_advance(&wheel, TEST_START + 10, NULL);
+
+    unsigned int calls = 0;
+
+    for (size_t i = 0; i < 4; i++) {
+        calls += timers[i].calls;
+    }
+
+    CHECK(calls == 2);
+    CHECK(wheel.count == 0);
+
+    // A timer re-armed at the current time by its callback expires in the next millisecond, not in a loop.
+    arm(&timers[0], TEST_START + 20);
+    timers[0].rearm = true;
+
+    CHECK(timer_advance(&wheel, TEST_START + 20, NULL) == 1);
+    CHECK(timer_armed(&timers[0].timer) && wheel.count == 1);
+    CHECK(timer_next(&wheel, TEST_START + 20) == 1);
+    CHECK(timer_advance(&wheel, TEST_START + 21, NULL) == 1);
+    CHECK(timers[0].calls == 2 && wheel.count == 0);
+}
+
+// --- Main --- //
+
+int main (void) {
+
+    test_cascade();
+    test_random();
+    test_callbacks();
+
+    return check_status("timer_test");
+}